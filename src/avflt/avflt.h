@@ -161,6 +161,8 @@ struct avflt_inode_data {
 };
 
 struct avflt_inode_data *avflt_get_inode_data_inode(struct inode *inode);
+struct avflt_inode_data *avflt_get_inode_data_ctx(redirfs_context context,
+        struct inode *inode);
 struct avflt_inode_data *avflt_get_inode_data(struct avflt_inode_data *data);
 void avflt_put_inode_data(struct avflt_inode_data *data);
 struct avflt_inode_data *avflt_attach_inode_data(struct inode *inode);
@@ -168,6 +168,19 @@ struct avflt_inode_data *avflt_get_inode_data_inode(struct inode *inode)
     return rfs_to_inode_data(rfs_data);
 }
 
+/* uses the rfs inode resolved by the hook if the context has it */
+struct avflt_inode_data *avflt_get_inode_data_ctx(redirfs_context context,
+        struct inode *inode)
+{
+    struct redirfs_data *rfs_data;
+
+    rfs_data = redirfs_ctx_get_data_inode(context, avflt, inode);
+    if (!rfs_data)
+        return NULL;
+
+    return rfs_to_inode_data(rfs_data);
+}
+
 struct avflt_inode_data *avflt_get_inode_data(struct avflt_inode_data *data)
 {
     struct redirfs_data *rfs_data;
@@ -46,7 +46,8 @@ static int avflt_should_check(struct file *file, int type)
     return 1;
 }
 
-static int avflt_check_cache(struct file *file, int type)
+static int avflt_check_cache(redirfs_context context, struct file *file,
+        int type)
 {
     struct avflt_root_data *root_data;
     struct avflt_inode_data *inode_data;
@@ -65,7 +66,7 @@ static int avflt_check_cache(struct file *file, int type)
         return 0;
     }
 
-    inode_data = avflt_get_inode_data_inode(file->f_dentry->d_inode);
+    inode_data = avflt_get_inode_data_ctx(context, file->f_dentry->d_inode);
     if (!inode_data) {
         avflt_put_root_data(root_data);
         return 0;
@@ -117,15 +118,15 @@ static enum redirfs_rv avflt_eval_res(int rv, struct redirfs_args *args)
     return REDIRFS_CONTINUE;
 }
 
-static enum redirfs_rv avflt_check_file(struct file *file, int type,
-        struct redirfs_args *args)
+static enum redirfs_rv avflt_check_file(redirfs_context context,
+        struct file *file, int type, struct redirfs_args *args)
 {
     int rv;
 
     if (!avflt_should_check(file, type))
         return REDIRFS_CONTINUE;
 
-    rv = avflt_check_cache(file, type);
+    rv = avflt_check_cache(context, file, type);
     if (rv)
         return avflt_eval_res(rv, args);
 
@@ -141,7 +142,7 @@ static enum redirfs_rv avflt_pre_open(redirfs_context context,
 {
     struct file *file = args->args.f_open.file;
 
-    return avflt_check_file(file, AVFLT_EVENT_OPEN, args);
+    return avflt_check_file(context, file, AVFLT_EVENT_OPEN, args);
 }
 
 static enum redirfs_rv avflt_post_release(redirfs_context context,
@@ -149,7 +150,7 @@ static enum redirfs_rv avflt_post_release(redirfs_context context,
 {
     struct file *file = args->args.f_release.file;
 
-    return avflt_check_file(file, AVFLT_EVENT_CLOSE, args);
+    return avflt_check_file(context, file, AVFLT_EVENT_CLOSE, args);
 }
 
 static int avflt_activate(void)
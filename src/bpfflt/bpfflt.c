@@ -0,0 +1,274 @@
+/*
+ * BPFFlt: BPF programs as filter callbacks
+ *
+ * This file is part of RedirFS.
+ *
+ * RedirFS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * RedirFS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with RedirFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The filter is registered like any other filter, with the priority module
+ * parameter, and subscribes to the op idcs given in the idcs parameter. Its
+ * callbacks call bpfflt_pre() and bpfflt_post() which are the attach points
+ * of the BPF programs. A policy is an fmod_ret program on bpfflt_pre()
+ * returning 0 to continue or a negative errno to stop the operation, an
+ * audit tap is an fentry program on either function, e.g.
+ *
+ *  SEC("fmod_ret/bpfflt_pre")
+ *  int BPF_PROG(deny_open, struct bpfflt_ctx *ctx, int err)
+ *  {
+ *      if (ctx->idc != REDIRFS_REG_FOP_OPEN)
+ *          return 0;
+ *      ...
+ *      return -EACCES;
+ *  }
+ *
+ * The programs see the struct redirfs_args of the operation through the
+ * module's BTF. They are not sleepable, so the callbacks are registered with
+ * REDIRFS_OP_NONBLOCK. The paths are set through the filter's sysfs paths
+ * file as for the other filters. fmod_ret needs a kernel with
+ * CONFIG_FUNCTION_ERROR_INJECTION and module BTF. Build it with "make bpf"
+ * in the src directory. An idc with an invalid inode type or op_id fails
+ * the module load with -EINVAL.
+ */
+
+#include <redirfs.h>
+#include <linux/module.h>
+#include <linux/err.h>
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4,16,0))
+    #include <linux/error-injection.h>
+#endif
+
+#define BPFFLT_VERSION "0.1"
+#define BPFFLT_MAX_IDCS 64
+
+static redirfs_filter bpfflt;
+
+static int priority = 650000000;
+module_param(priority, int, 0444);
+MODULE_PARM_DESC(priority, "the filter's priority");
+
+static unsigned int idcs[BPFFLT_MAX_IDCS];
+static int idcs_nr;
+module_param_array(idcs, uint, &idcs_nr, 0444);
+MODULE_PARM_DESC(idcs, "the op idcs the BPF programs are called for, "
+        "the modifying operations and open by default");
+
+static const enum redirfs_op_idc bpfflt_default_idcs[] = {
+    REDIRFS_REG_FOP_OPEN,
+    REDIRFS_DIR_IOP_CREATE,
+    REDIRFS_DIR_IOP_LINK,
+    REDIRFS_DIR_IOP_UNLINK,
+    REDIRFS_DIR_IOP_SYMLINK,
+    REDIRFS_DIR_IOP_MKDIR,
+    REDIRFS_DIR_IOP_RMDIR,
+    REDIRFS_DIR_IOP_MKNOD,
+    REDIRFS_DIR_IOP_RENAME,
+    REDIRFS_REG_IOP_SETATTR,
+    REDIRFS_DIR_IOP_SETATTR,
+};
+
+static struct redirfs_op_info bpfflt_op_info[BPFFLT_MAX_IDCS + 1];
+
+static struct redirfs_filter_info bpfflt_info = {
+    .owner = THIS_MODULE,
+    .name = "bpfflt",
+    .active = 1
+};
+
+struct bpfflt_ctx {
+    /* enum redirfs_op_idc */
+    u32 idc;
+    /* REDIRFS_PRECALL or REDIRFS_POSTCALL */
+    u32 call;
+    struct redirfs_args *args;
+    /* returned by bpfflt_pre() unless a program overrides it */
+    int err;
+};
+
+int bpfflt_pre(struct bpfflt_ctx *ctx);
+void bpfflt_post(struct bpfflt_ctx *ctx);
+
+/*
+ * the attach points, noinline and reading the context so the calls are not
+ * optimized out
+ */
+noinline int bpfflt_pre(struct bpfflt_ctx *ctx)
+{
+    return READ_ONCE(ctx->err);
+}
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4,16,0))
+ALLOW_ERROR_INJECTION(bpfflt_pre, ERRNO);
+#endif
+
+noinline void bpfflt_post(struct bpfflt_ctx *ctx)
+{
+    barrier();
+}
+
+/* the return value of a stopped operation has the operation's type */
+static void bpfflt_set_rv(struct redirfs_args *args, int err)
+{
+    switch (RFS_IDC_TO_OP_ID(args->type.id)) {
+    case RFS_OP_f_read:
+    case RFS_OP_f_write:
+    case RFS_OP_f_read_iter:
+    case RFS_OP_f_write_iter:
+        args->rv.rv_ssize = err;
+        break;
+    case RFS_OP_f_llseek:
+        args->rv.rv_loff = err;
+        break;
+    case RFS_OP_f_unlocked_ioctl:
+    case RFS_OP_f_compat_ioctl:
+    case RFS_OP_f_fallocate:
+        args->rv.rv_long = err;
+        break;
+    case RFS_OP_f_get_unmapped_area:
+        args->rv.rv_ulong = err;
+        break;
+    case RFS_OP_i_lookup:
+        args->rv.rv_dentry = ERR_PTR(err);
+        break;
+    default:
+        args->rv.rv_int = err;
+    }
+}
+
+static enum redirfs_rv bpfflt_pre_cb(redirfs_context context,
+        struct redirfs_args *args)
+{
+    struct bpfflt_ctx ctx = {
+        .idc = args->type.id,
+        .call = args->type.call,
+        .args = args,
+        .err = 0
+    };
+    int err;
+
+    err = bpfflt_pre(&ctx);
+    if (!err)
+        return REDIRFS_CONTINUE;
+
+    if (err > 0 || err < -MAX_ERRNO)
+        err = -EPERM;
+
+    bpfflt_set_rv(args, err);
+    return REDIRFS_STOP;
+}
+
+static enum redirfs_rv bpfflt_post_cb(redirfs_context context,
+        struct redirfs_args *args)
+{
+    struct bpfflt_ctx ctx = {
+        .idc = args->type.id,
+        .call = args->type.call,
+        .args = args,
+        .err = 0
+    };
+
+    bpfflt_post(&ctx);
+    return REDIRFS_CONTINUE;
+}
+
+static int bpfflt_set_op_info(void)
+{
+    int i;
+
+    if (!idcs_nr) {
+        for (i = 0; i < ARRAY_SIZE(bpfflt_default_idcs); i++)
+            idcs[i] = bpfflt_default_idcs[i];
+        idcs_nr = ARRAY_SIZE(bpfflt_default_idcs);
+    }
+
+    /* redirfs_set_operations hits a BUG_ON for an invalid type or op_id */
+    for (i = 0; i < idcs_nr; i++) {
+        if (RFS_IDC_TO_ITYPE(idcs[i]) >= RFS_INODE_MAX ||
+            RFS_IDC_TO_OP_ID(idcs[i]) >= RFS_OP_MAX) {
+            printk(KERN_ERR "bpfflt: invalid operation id 0x%x\n", idcs[i]);
+            return -EINVAL;
+        }
+
+        /* a stopped operation returning bool cannot return an error */
+        switch (RFS_IDC_TO_OP_ID(idcs[i])) {
+        case RFS_OP_a_dirty_folio:
+        case RFS_OP_a_release_folio:
+            printk(KERN_ERR "bpfflt: unsupported operation id 0x%x\n",
+                    idcs[i]);
+            return -EINVAL;
+        default:
+            break;
+        }
+
+        bpfflt_op_info[i].op_id = idcs[i];
+        bpfflt_op_info[i].pre_cb = bpfflt_pre_cb;
+        bpfflt_op_info[i].post_cb = bpfflt_post_cb;
+        bpfflt_op_info[i].flags = REDIRFS_OP_NONBLOCK;
+    }
+
+    bpfflt_op_info[idcs_nr].op_id = REDIRFS_OP_END;
+
+    return 0;
+}
+
+static int __init bpfflt_init(void)
+{
+    int err;
+    int rv;
+
+    bpfflt_info.priority = priority;
+
+    rv = bpfflt_set_op_info();
+    if (rv)
+        return rv;
+
+    bpfflt = redirfs_register_filter(&bpfflt_info);
+    if (IS_ERR(bpfflt)) {
+        rv = PTR_ERR(bpfflt);
+        printk(KERN_ERR "bpfflt: register filter failed(%d)\n", rv);
+        return rv;
+    }
+
+    rv = redirfs_set_operations(bpfflt, bpfflt_op_info);
+    if (rv) {
+        printk(KERN_ERR "bpfflt: set operations failed(%d)\n", rv);
+        goto error;
+    }
+
+    printk(KERN_INFO "BPF Filter Version " BPFFLT_VERSION
+            " <www.redirfs.org>\n");
+    return 0;
+
+error:
+    err = redirfs_unregister_filter(bpfflt);
+    if (err) {
+        printk(KERN_ERR "bpfflt: unregister filter failed(%d)\n", err);
+        return 0;
+    }
+
+    redirfs_delete_filter(bpfflt);
+
+    return rv;
+}
+
+static void __exit bpfflt_exit(void)
+{
+    redirfs_delete_filter(bpfflt);
+}
+
+module_init(bpfflt_init);
+module_exit(bpfflt_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("BPF Filter for the RedirFS Framework");
@@ -39,11 +39,25 @@
 #include <linux/types.h>
 #include <linux/aio.h>
 #include <linux/version.h>
+#include <linux/rcupdate.h>
 
 #define REDIRFS_VERSION "0.14.0.2 EXPERIMENTAL"
 
 #define REDIRFS_PATH_INCLUDE        1
 #define REDIRFS_PATH_EXCLUDE        2
+/*
+ * with REDIRFS_PATH_INCLUDE only the path is hooked when it is added, the
+ * cached dentries below it are attached when their directory is accessed
+ */
+#define REDIRFS_PATH_LAZY           4
+
+/*
+ * redirfs_op_info flags, REDIRFS_OP_NONBLOCK declares that the callbacks never
+ * sleep so d_revalidate and permission can call them in RCU path walk, without
+ * it the hooks return -ECHILD there and the walk is retried with references,
+ * d_compare callbacks are always called under rcu_read_lock and must not sleep
+ */
+#define REDIRFS_OP_NONBLOCK         0x1
 
 #define REDIRFS_FILTER_ATTRIBUTE(__name, __mode, __show, __store) \
     __ATTR(__name, __mode, __show, __store)
@@ -183,6 +197,11 @@ enum rfs_op_id {
     RFS_OP_a_error_remove_page,
     RFS_OP_a_swap_activate,
     RFS_OP_a_swap_deactivate,
+    RFS_OP_a_read_folio,
+    RFS_OP_a_readahead,
+    RFS_OP_a_dirty_folio,
+    RFS_OP_a_invalidate_folio,
+    RFS_OP_a_release_folio,
     RFS_OP_a_end, /* end of the range */
 
     // the last entry
@@ -377,6 +396,11 @@ enum redirfs_op_idc {
     /* REDIRFS_REG_AOP_GET_XIP_PAGE, */
     /* REDIRFS_REG_AOP_MIGRATEPAGE, */
     /* REDIRFS_REG_AOP_LAUNDER_PAGE, */
+    REDIRFS_REG_AOP_READ_FOLIO       = RFS_OP_IDC(RFS_INODE_REG, RFS_OP_a_read_folio),
+    REDIRFS_REG_AOP_READAHEAD        = RFS_OP_IDC(RFS_INODE_REG, RFS_OP_a_readahead),
+    REDIRFS_REG_AOP_DIRTY_FOLIO      = RFS_OP_IDC(RFS_INODE_REG, RFS_OP_a_dirty_folio),
+    REDIRFS_REG_AOP_INVALIDATE_FOLIO = RFS_OP_IDC(RFS_INODE_REG, RFS_OP_a_invalidate_folio),
+    REDIRFS_REG_AOP_RELEASE_FOLIO    = RFS_OP_IDC(RFS_INODE_REG, RFS_OP_a_release_folio),
 
     REDIRFS_OP_MAX = RFS_OP_IDC(RFS_INODE_MAX, RFS_OP_MAX),
     REDIRFS_OP_INVALID = REDIRFS_OP_MAX,
@@ -411,6 +435,7 @@ union redirfs_op_rv {
     sector_t         rv_sector;
     struct page        *rv_page;
     ssize_t          rv_ssize;
+    bool             rv_bool;
 };
 
 union redirfs_op_args {
@@ -665,6 +690,18 @@ union redirfs_op_args {
     } f_write;
 
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(3,14,0))
+    /*
+     * post callbacks for an asynchronous kiocb are called when the I/O
+     * completes with the final result, iov_iter is NULL then as the
+     * caller's iterator is already consumed or gone, a pre callback which
+     * needs the buffers has to save them in the context data, see
+     * redirfs_attach_data_context
+     *
+     * if redirfs cannot allocate the completion state the post callbacks
+     * are called when the operation returns, with -EIOCBQUEUED and the
+     * original iov_iter, this is counted as "iocb fallbacks" in
+     * /sys/fs/redirfs/info/stat
+     */
     struct {
         struct kiocb *kiocb;
         struct iov_iter *iov_iter;
@@ -919,6 +956,37 @@ union redirfs_op_args {
         struct page *page;
     } a_freepage;
 
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5,8,0))
+    struct {
+        struct readahead_control *rac;
+    } a_readahead;
+#endif
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5,18,0))
+    struct {
+        struct address_space *mapping;
+        struct folio *folio;
+    } a_dirty_folio;
+
+    struct {
+        struct folio *folio;
+        size_t offset;
+        size_t length;
+    } a_invalidate_folio;
+#endif
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5,19,0))
+    struct {
+        struct file *file;
+        struct folio *folio;
+    } a_read_folio;
+
+    struct {
+        struct folio *folio;
+        gfp_t gfp;
+    } a_release_folio;
+#endif
+
     /*
     struct {
         struct page *page;
@@ -1017,6 +1085,7 @@ struct redirfs_op_info {
     enum redirfs_op_idc op_id;
     enum redirfs_rv (*pre_cb)(redirfs_context, struct redirfs_args *);
     enum redirfs_rv (*post_cb)(redirfs_context, struct redirfs_args *);
+    unsigned int flags;
 };
 
 struct redirfs_filter_operations {
@@ -1057,6 +1126,8 @@ struct redirfs_data {
     redirfs_filter filter;
     void (*free)(struct redirfs_data *);
     void (*detach)(struct redirfs_data *);
+    /* the free is called after the RCU grace period */
+    struct rcu_head rcu;
 };
 
 int redirfs_create_attribute(redirfs_filter filter,
@@ -1074,6 +1145,20 @@ void redirfs_put_path(redirfs_path path);
 redirfs_path* redirfs_get_paths_root(redirfs_filter filter, redirfs_root root);
 redirfs_path* redirfs_get_paths(redirfs_filter filter);
 void redirfs_put_paths(redirfs_path *paths);
+redirfs_path redirfs_next_path(redirfs_filter filter, redirfs_path prev);
+redirfs_path redirfs_next_path_root(redirfs_filter filter, redirfs_root root,
+        redirfs_path prev);
+
+/* breaking out of the loops needs redirfs_put_path(path) */
+#define redirfs_for_each_path(filter, path) \
+    for (path = redirfs_next_path(filter, NULL); \
+         path && !IS_ERR(path); \
+         path = redirfs_next_path(filter, path))
+
+#define redirfs_for_each_path_root(filter, root, path) \
+    for (path = redirfs_next_path_root(filter, root, NULL); \
+         path && !IS_ERR(path); \
+         path = redirfs_next_path_root(filter, root, path))
 struct redirfs_path_info *redirfs_get_path_info(redirfs_filter filter,
         redirfs_path path);
 void redirfs_put_path_info(struct redirfs_path_info *info);
@@ -1128,5 +1213,11 @@ struct redirfs_data *redirfs_detach_data_root(redirfs_filter filter,
         redirfs_root root);
 struct redirfs_data *redirfs_get_data_root(redirfs_filter filter,
         redirfs_root root);
+struct redirfs_data *redirfs_ctx_get_data_file(redirfs_context context,
+        redirfs_filter filter, struct file *file);
+struct redirfs_data *redirfs_ctx_get_data_dentry(redirfs_context context,
+        redirfs_filter filter, struct dentry *dentry);
+struct redirfs_data *redirfs_ctx_get_data_inode(redirfs_context context,
+        redirfs_filter filter, struct inode *inode);
 #endif
 
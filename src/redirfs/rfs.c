@@ -25,6 +25,31 @@
  */
 
 #include "rfs.h"
+#include "rfs_hooked_ops.h"
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,32))
+/* the inode of the hooked operation, NULL if the hook resolved none */
+static inline struct inode *rfs_context_inode(struct rfs_context *rcont)
+{
+    if (rcont->rinode)
+        return rcont->rinode->inode;
+    if (rcont->rdentry)
+        return rcont->rdentry->dentry->d_inode;
+    if (rcont->rfile)
+        return rcont->rfile->file->f_path.dentry->d_inode;
+    return NULL;
+}
+
+#define CREATE_TRACE_POINTS
+#include "rfs_trace.h"
+#else
+static inline void trace_redirfs_hook(unsigned int idc,
+        struct rfs_context *rcont) {}
+static inline void trace_redirfs_filter(const char *name, unsigned int idc,
+        bool pre, bool stop) {}
+static inline void trace_redirfs_op_exit(unsigned int idc, long rv,
+        int rv_int) {}
+#endif
 
 #ifdef RFS_DBG
     #pragma GCC push_options
@@ -33,13 +58,38 @@
 
 struct rfs_info *rfs_info_none;
 
+/*
+ * the callbacks are latched in the context so the post call walks the same
+ * vector as the pre call even if the chain was recompiled meanwhile, the
+ * vector is released by rfs_context_deinit
+ */
+static struct rfs_chain_cbs *rfs_context_get_cbs(struct rfs_context *rcont,
+        struct rfs_chain *rchain)
+{
+    if (rcont->rcbs)
+        return rcont->rcbs;
+
+#ifdef RFS_INFO_SRCU
+    rcont->rcbs_idx = srcu_read_lock(&rfs_info_srcu);
+    rcont->rcbs = srcu_dereference(rchain->cbs, &rfs_info_srcu);
+#else
+    rcont->rcbs = rcu_dereference_raw(rchain->cbs);
+#endif
+
+    return rcont->rcbs;
+}
+
 int rfs_precall_flts(struct rfs_chain *rchain, struct rfs_context *rcont,
         struct redirfs_args *rargs)
 {
-    enum redirfs_rv      (*rop)(redirfs_context, struct redirfs_args *);
+    struct rfs_chain_cbs *rcbs;
+    struct rfs_chain_cb  *cbs;
     enum redirfs_rv      rv;
     enum rfs_inode_type  it;
     enum rfs_op_id       op_id;
+    u64                  start;
+    int                  n;
+    int                  nr;
 
     if (!rchain)
         return 0;
@@ -52,32 +102,48 @@ int rfs_precall_flts(struct rfs_chain *rchain, struct rfs_context *rcont,
 
     rargs->type.call = REDIRFS_PRECALL;
 
-    rcont->idx = rcont->idx_start;
+    trace_redirfs_hook(rargs->type.id, rcont);
 
-    for (; rcont->idx < rchain->rflts_nr; rcont->idx++) {
-        if (!atomic_read(&rchain->rflts[rcont->idx]->active))
-            continue;
+    rcbs = rfs_context_get_cbs(rcont, rchain);
+    n = it * RFS_OP_MAX + op_id;
+    cbs = &rcbs->cbs[rcbs->start[n]];
+    nr = rcbs->start[n + 1] - rcbs->start[n];
 
-        rop = rchain->rflts[rcont->idx]->cbs[it][op_id].pre_cb;
-        if (!rop)
+    for (rcont->idx = rcont->idx_start; rcont->idx < nr; rcont->idx++) {
+        if (!cbs[rcont->idx].pre_cb)
             continue;
 
-        rv = rop(rcont, rargs);
+        start = rfs_lat_start();
+        rv = cbs[rcont->idx].pre_cb(rcont, rargs);
+        if (start)
+            rfs_lat_flt_record(cbs[rcont->idx].rflt, it, op_id, RFS_LAT_PRE,
+                    start);
+
+        trace_redirfs_filter(cbs[rcont->idx].rflt->name, rargs->type.id,
+                true, rv == REDIRFS_STOP);
+
         if (rv == REDIRFS_STOP)
             return -1;
     }
 
     rcont->idx--;
 
+    /* the original operation is timed until rfs_postcall_flts */
+    rcont->lat_start = rfs_lat_start();
+
     return 0;
 }
 
 void rfs_postcall_flts(struct rfs_chain *rchain, struct rfs_context *rcont,
         struct redirfs_args *rargs)
 {
-    enum redirfs_rv      (*rop)(redirfs_context, struct redirfs_args *);
+    struct rfs_chain_cbs *rcbs;
+    struct rfs_chain_cb  *cbs;
+    enum redirfs_rv      rv;
     enum rfs_inode_type  it;
     enum rfs_op_id       op_id;
+    u64                  start;
+    int                  n;
 
     if (!rchain)
         return;
@@ -90,18 +156,52 @@ void rfs_postcall_flts(struct rfs_chain *rchain, struct rfs_context *rcont,
 
     rargs->type.call = REDIRFS_POSTCALL;
 
+    trace_redirfs_op_exit(rargs->type.id, rargs->rv.rv_long,
+            rargs->rv.rv_int);
+
+    if (rcont->lat_start) {
+        rfs_lat_op_record(it, op_id, rcont->lat_start);
+        rcont->lat_start = 0;
+    }
+
+    rcbs = rfs_context_get_cbs(rcont, rchain);
+    n = it * RFS_OP_MAX + op_id;
+    cbs = &rcbs->cbs[rcbs->start[n]];
+
     for (; rcont->idx >= rcont->idx_start; rcont->idx--) {
-        if (!atomic_read(&rchain->rflts[rcont->idx]->active))
+        if (!cbs[rcont->idx].post_cb)
             continue;
 
-        rop = rchain->rflts[rcont->idx]->cbs[it][op_id].post_cb;
-        if (rop) 
-            rop(rcont, rargs);
+        start = rfs_lat_start();
+        rv = cbs[rcont->idx].post_cb(rcont, rargs);
+        if (start)
+            rfs_lat_flt_record(cbs[rcont->idx].rflt, it, op_id, RFS_LAT_POST,
+                    start);
+
+        trace_redirfs_filter(cbs[rcont->idx].rflt->name, rargs->type.id,
+                false, rv == REDIRFS_STOP);
     }
 
     rcont->idx++;
 }
 
+/*
+ * true if a callback for the operation is not flagged REDIRFS_OP_NONBLOCK,
+ * checked against the latched vector so the calls see the same callbacks
+ */
+bool rfs_chain_may_block(struct rfs_chain *rchain, struct rfs_context *rcont,
+        enum redirfs_op_idc idc)
+{
+    struct rfs_chain_cbs *rcbs;
+
+    if (!rchain)
+        return false;
+
+    rcbs = rfs_context_get_cbs(rcont, rchain);
+    return test_bit(RFS_IDC_TO_ITYPE(idc) * RFS_OP_MAX +
+            RFS_IDC_TO_OP_ID(idc), rcbs->may_block);
+}
+
 enum rfs_inode_type  rfs_imode_to_type(umode_t i_mode, bool is_dentry)
 {
     if (likely(!is_dentry)) {
@@ -152,9 +252,21 @@ static int __init rfs_init(void)
 
     rfs_object_susbsystem_init();
 
+#ifdef RFS_INFO_SRCU
+    rv = init_srcu_struct(&rfs_info_srcu);
+    if (rv)
+        return rv;
+#endif
+
+    rv = rfs_hoperations_init();
+    if (rv)
+        goto err_hoperations;
+
     rfs_info_none = rfs_info_alloc(NULL, NULL);
-    if (IS_ERR(rfs_info_none))
-        return PTR_ERR(rfs_info_none);
+    if (IS_ERR(rfs_info_none)) {
+        rv = PTR_ERR(rfs_info_none);
+        goto err_info_none;
+    }
 
     rv = rfs_dentry_cache_create();
     if (rv)
@@ -168,6 +280,10 @@ static int __init rfs_init(void)
     if (rv)
         goto err_file_cache;
 
+    rv = rfs_dcache_walk_init();
+    if (rv)
+        goto err_walk;
+
     rv = rfs_sysfs_create();
     if (rv)
         goto err_sysfs;
@@ -178,6 +294,8 @@ static int __init rfs_init(void)
     return 0;
 
 err_sysfs:
+    rfs_dcache_walk_exit();
+err_walk:
     rfs_file_cache_destory();
 err_file_cache:
     rfs_inode_cache_destroy();
@@ -185,6 +303,13 @@ err_inode_cache:
     rfs_dentry_cache_destory();
 err_dentry_cache:
     rfs_info_put(rfs_info_none);
+err_info_none:
+    rfs_hoperations_destroy();
+err_hoperations:
+#ifdef RFS_INFO_SRCU
+    srcu_barrier(&rfs_info_srcu);
+    cleanup_srcu_struct(&rfs_info_srcu);
+#endif
     return rv;
 }
 
@@ -37,9 +37,24 @@
 #include <linux/sched.h>
 #include <linux/quotaops.h>
 #include <linux/slab.h>
+#include <linux/srcu.h>
+#include <linux/workqueue.h>
+#include <linux/completion.h>
+#include <linux/ktime.h>
 #include "redirfs.h"
 #include "rfs_object.h"
 #include "rfs_dbg.h"
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(3,18,0))
+#include <linux/percpu-refcount.h>
+#endif
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4,3,0))
+#include <linux/jump_label.h>
+#endif
+
+/* call_srcu() is used to release rfs_info, see struct rfs_info */
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(3,11,0))
+#define RFS_INFO_SRCU
+#endif
 
 #ifndef f_dentry
     #define f_dentry    f_path.dentry
@@ -73,10 +88,11 @@
     (ops_new.op = (ops_old ? ops_old->op : NULL))
 
 /*
- * if there is a filter registered for this operation then hook it
+ * if there is a filter registered for this operation then hook it, the ops
+ * of the object's rinfo are immutable and cover the root's slot
  */
-#define RFS_SET_OP(arr, idc, ops_new, ops_old, op, f) \
-    ((arr[RFS_IDC_TO_ITYPE(idc)][RFS_IDC_TO_OP_ID(idc)]) ? \
+#define RFS_SET_OP(rops, idc, ops_new, ops_old, op, f) \
+    (RFS_OPS_IS_SET(rops, idc) ? \
          RFS_ADD_OP(ops_new, ops_old, op, f) : \
          RFS_REM_OP(ops_new, ops_old, op) \
     )
@@ -89,7 +105,7 @@
 
     #define RFS_SET_FOP(rf, idc, op, f) \
         (rf->rdentry->rinfo->rops ? \
-            RFS_SET_OP(rf->rdentry->rinfo->rops->arr, idc, rf->op_new, \
+            RFS_SET_OP(rf->rdentry->rinfo->rops, idc, rf->op_new, \
                 rf->op_old, op, f) : \
             RFS_REM_OP(rf->op_new, rf->op_old, op) \
         )
@@ -110,7 +126,7 @@
         do { \
             int nr = RFS_FOP_BIT(idc); \
             if (rf->rdentry->rinfo->rops && \
-                rf->rdentry->rinfo->rops->arr[RFS_IDC_TO_ITYPE(idc)][RFS_IDC_TO_OP_ID(idc)]) { \
+                RFS_OPS_IS_SET(rf->rdentry->rinfo->rops, idc)) { \
                 if (!test_bit(nr, rf->f_rhops->f_op_bitfield) && \
                     !test_and_set_bit(nr, rf->f_rhops->f_op_bitfield)) { \
                     RFS_ADD_OP((*rf->f_rhops->new.f_op), rf->f_rhops->old.f_op, op, f); \
@@ -142,7 +158,7 @@
 
     #define RFS_SET_DOP(rd, idc, op, f) \
         (rd->rinfo->rops ? \
-            RFS_SET_OP(rd->rinfo->rops->arr, idc, rd->op_new,\
+            RFS_SET_OP(rd->rinfo->rops, idc, rd->op_new,\
                 rd->op_old, op, f) : \
             RFS_REM_OP(rd->op_new, rd->op_old, op) \
         )
@@ -163,7 +179,7 @@
         do { \
             int nr = RFS_DOP_BIT(idc); \
             if (rd->rinfo->rops && \
-                rd->rinfo->rops->arr[RFS_IDC_TO_ITYPE(idc)][RFS_IDC_TO_OP_ID(idc)]) { \
+                RFS_OPS_IS_SET(rd->rinfo->rops, idc)) { \
                 if (!test_bit(nr, rd->d_rhops->d_op_bitfield) && \
                     !test_and_set_bit(nr, rd->d_rhops->d_op_bitfield)) { \
                     RFS_ADD_OP((*rd->d_rhops->new.d_op), rd->d_rhops->old.d_op, op, f); \
@@ -201,7 +217,7 @@
 
     #define RFS_SET_IOP(ri, idc, op, f) \
         (ri->rinfo->rops ? \
-            RFS_SET_OP(ri->rinfo->rops->arr, idc, ri->op_new, \
+            RFS_SET_OP(ri->rinfo->rops, idc, ri->op_new, \
                 ri->op_old, op, f) : \
             RFS_REM_OP(ri->op_new, ri->op_old, op) \
         )
@@ -222,7 +238,7 @@
         do { \
             int nr = RFS_IOP_BIT(idc); \
             if (ri->rinfo->rops && \
-                ri->rinfo->rops->arr[RFS_IDC_TO_ITYPE(idc)][RFS_IDC_TO_OP_ID(idc)]) { \
+                RFS_OPS_IS_SET(ri->rinfo->rops, idc)) { \
                 if (!test_bit(nr, ri->i_rhops->i_op_bitfield) && \
                     !test_and_set_bit(nr, ri->i_rhops->i_op_bitfield)) { \
                     RFS_ADD_OP((*ri->i_rhops->new.i_op), ri->i_rhops->old.i_op, op, f); \
@@ -254,7 +270,7 @@
 
     #define RFS_SET_AOP(ri, idc, op, f) \
         (ri->rinfo->rops ? \
-            RFS_SET_OP(ri->rinfo->rops->arr, idc, ri->a_op_new, \
+            RFS_SET_OP(ri->rinfo->rops, idc, ri->a_op_new, \
                 ri->a_op_old, op, f) : \
             RFS_REM_OP(ri->a_op_new, ri->a_op_old, op) \
         )
@@ -272,7 +288,7 @@
         do { \
             int nr = RFS_AOP_BIT(idc); \
             if (ri->rinfo->rops && \
-                ri->rinfo->rops->arr[RFS_IDC_TO_ITYPE(idc)][RFS_IDC_TO_OP_ID(idc)]) { \
+                RFS_OPS_IS_SET(ri->rinfo->rops, idc)) { \
                 if (!test_bit(nr, ri->a_rhops->a_op_bitfield) && \
                     !test_and_set_bit(nr, ri->a_rhops->a_op_bitfield)) { \
                     RFS_ADD_OP((*ri->a_rhops->new.a_op), ri->a_rhops->old.a_op, op, f); \
@@ -289,12 +305,15 @@ struct rfs_file;
 
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(2,6,16))
     #define rfs_for_each_d_child(pos, head) list_for_each_entry(pos, head, d_child)
+    #define rfs_for_each_d_child_continue(pos, head) list_for_each_entry_continue(pos, head, d_child)
     #define rfs_d_child_entry(pos) list_entry(pos, struct dentry, d_child)
 #elif (LINUX_VERSION_CODE < KERNEL_VERSION(3,12,0))
     #define rfs_for_each_d_child(pos, head) list_for_each_entry(pos, head, d_u.d_child)
+    #define rfs_for_each_d_child_continue(pos, head) list_for_each_entry_continue(pos, head, d_u.d_child)
     #define rfs_d_child_entry(pos) list_entry(pos, struct dentry, d_u.d_child)
 #else
     #define rfs_for_each_d_child(pos, head) list_for_each_entry(pos, head, d_child)
+    #define rfs_for_each_d_child_continue(pos, head) list_for_each_entry_continue(pos, head, d_child)
     #define rfs_d_child_entry(pos) list_entry(pos, struct dentry, d_child)
 #endif
 
@@ -359,8 +378,19 @@ struct rfs_file;
 struct rfs_op_info {
     enum redirfs_rv (*pre_cb)(redirfs_context, struct redirfs_args *);
     enum redirfs_rv (*post_cb)(redirfs_context, struct redirfs_args *);
+    unsigned int flags;
 };
 
+/*
+ * References held by filters' private data (struct redirfs_data) are taken
+ * for every attached object, so they are counted per-CPU in data_ref. The
+ * data_ref is killed when the last reference in count is dropped and the
+ * filter is freed when the last data reference goes away.
+ */
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(3,18,0))
+#define RFS_FLT_PERCPU_REF
+#endif
+
 struct rfs_flt {
     struct list_head list;
     struct rfs_op_info cbs[RFS_INODE_MAX][RFS_OP_MAX];
@@ -372,15 +402,114 @@ struct rfs_flt {
     spinlock_t lock;
     atomic_t active;
     atomic_t count;
+#ifdef RFS_FLT_PERCPU_REF
+    struct percpu_ref data_ref;
+#endif
     struct redirfs_filter_operations *ops;
+    int slot; /* in rfs_data_slots, -1 if all slots are taken */
+    /* callback latencies per inode type, allocated when collection is on */
+    struct rfs_lat_flt __percpu *lat[RFS_INODE_MAX];
 };
 
 void rfs_flt_put(struct rfs_flt *rflt);
 struct rfs_flt *rfs_flt_get(struct rfs_flt *rflt);
+struct rfs_flt *rfs_flt_data_get(struct rfs_flt *rflt);
+void rfs_flt_data_put(struct rfs_flt *rflt);
 void rfs_flt_release(struct kobject *kobj);
+int rfs_flt_set_lat(bool on);
+
+/*
+ * Latency histograms of the filters' callbacks and of the original operations.
+ * The counters are per CPU, bucket n counts the calls which took
+ * [2^(n+5), 2^(n+6)) ns, the first bucket everything under 64 ns and the last
+ * bucket everything from 2^24 ns up. The collection is off by default and the
+ * hooks only test a static key then.
+ */
+#define RFS_LAT_BUCKETS 20
+#define RFS_LAT_SHIFT 6
+
+enum {
+    RFS_LAT_PRE,
+    RFS_LAT_POST,
+    RFS_LAT_CALLS
+};
+
+struct rfs_lat_hist {
+    u32 buckets[RFS_LAT_BUCKETS];
+};
+
+struct rfs_lat_flt {
+    struct rfs_lat_hist hist[RFS_OP_MAX][RFS_LAT_CALLS];
+};
+
+struct rfs_lat_ops {
+    struct rfs_lat_hist hist[RFS_OP_MAX];
+};
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4,3,0))
+#define RFS_LAT_STATIC_KEY
+DECLARE_STATIC_KEY_FALSE(rfs_lat_key);
+#define rfs_lat_enabled() static_branch_unlikely(&rfs_lat_key)
+#else
+extern bool rfs_lat_on;
+#define rfs_lat_enabled() unlikely(rfs_lat_on)
+#endif
+
+/* the start of a timed call, 0 if the collection is off */
+static inline u64 rfs_lat_start(void)
+{
+    if (rfs_lat_enabled())
+        return ktime_to_ns(ktime_get()) ? : 1;
+    return 0;
+}
+
+int rfs_lat_flt_alloc(struct rfs_flt *rflt);
+void rfs_lat_flt_free(struct rfs_flt *rflt);
+void rfs_lat_switch(bool on);
+bool rfs_lat_active(void);
+void rfs_lat_flt_record(struct rfs_flt *rflt, enum rfs_inode_type it,
+        enum rfs_op_id op_id, int call, u64 start);
+void rfs_lat_op_record(enum rfs_inode_type it, enum rfs_op_id op_id,
+        u64 start);
+ssize_t rfs_lat_flt_show(struct rfs_flt *rflt, char *buf, ssize_t size);
+ssize_t rfs_lat_ops_show(char *buf, ssize_t size);
+
+/*
+ * The filters' private data attached to an object are kept in a list. The
+ * first RFS_DATA_SLOTS filters also get a slot in an array which is read
+ * under RCU without the object's lock. The array is allocated with the first
+ * data attached and changed under the object's lock. A slot is released when
+ * the filter is freed, so it is not reused while the filter's data exist.
+ */
+#define RFS_DATA_SLOTS 8
+
+struct rfs_data_slots {
+    struct redirfs_data __rcu *data[RFS_DATA_SLOTS];
+};
+
+struct rfs_data_head {
+    struct list_head list;
+    struct rfs_data_slots __rcu *slots;
+};
+
+void rfs_data_head_init(struct rfs_data_head *head);
+void rfs_data_head_remove(struct rfs_data_head *head);
+
+/*
+ * the number of active filters with a callback for an operation,
+ * hooks check it before any object lookup
+ */
+extern atomic_t rfs_flt_subscribers[RFS_INODE_MAX][RFS_OP_MAX];
+
+static inline int rfs_op_subscribed(enum redirfs_op_idc idc)
+{
+    return atomic_read(&rfs_flt_subscribers[RFS_IDC_TO_ITYPE(idc)]
+                                           [RFS_IDC_TO_OP_ID(idc)]);
+}
 
 struct rfs_path {
     struct list_head list;
+    struct hlist_node hnode;
     struct list_head rfst_list;
     struct list_head rroot_list;
     struct rfs_root *rroot;
@@ -405,16 +534,26 @@ int rfs_path_get_info(struct rfs_flt *rflt, char *buf, int size);
 int rfs_fsrename(struct inode *old_dir, struct dentry *old_dentry,
         struct inode *new_dir, struct dentry *new_dentry);
 
+/* the lazy attachment relies on permission being called for each directory */
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(3,1,0))
+    #define RFS_LAZY_ATTACH
+#endif
+
+#define RFS_ROOT_LAZY 0x1
+
 struct rfs_root {
     struct list_head list;
+    struct hlist_node hnode;
     struct list_head walk_list;
     struct list_head rpaths;
-    struct list_head data;
+    struct rfs_data_head data;
     struct rfs_chain *rinch;
     struct rfs_chain *rexch;
     struct rfs_info *rinfo;
+    struct rfs_info *rslot; /* the info the objects below see, lock */
     struct dentry *dentry;
     int paths_nr;
+    int flags; /* RFS_ROOT_*, rfs_path_mutex */
     spinlock_t lock;
     atomic_t count;
 };
@@ -435,6 +574,7 @@ int rfs_root_add_flt(struct rfs_root *rroot, void *data);
 int rfs_root_rem_flt(struct rfs_root *rroot, void *data);
 int rfs_root_walk(int (*cb)(struct rfs_root*, void *), void *data);
 void rfs_root_add_walk(struct dentry *dentry);
+void rfs_root_add_walk_subroots(struct dentry *dentry);
 void rfs_root_set_rinfo(struct rfs_root *rroot, struct rfs_info *rinfo);
 
 struct rfs_ops {
@@ -444,25 +584,64 @@ struct rfs_ops {
     //
     atomic_t count;
 
-    int flags;
+    int flags; /* RFS_OPS_* */
 
     //
-    // arr[][] counts the number of registered filters for each operations,
-    // see redirfs_op_id for the full list of operations indexed by this
-    // array, this allows register up to 127 filters ( pre and post callbacks
-    // are accounted separatelly ) for each inode type
+    // bits[it] has a bit set for each operation a filter in the chain has
+    // a pre or post callback for, see redirfs_op_id for the full list of
+    // operations indexed by the bitmaps, the number of the callbacks is
+    // not kept as the hooks only check for any, it can be counted from
+    // the chain, see rfs_chain_ops
     //
-    unsigned char arr[RFS_INODE_MAX][RFS_OP_MAX];
+    DECLARE_BITMAP(bits[RFS_INODE_MAX], RFS_OP_MAX);
 };
 
+#define RFS_OPS_IS_SET(rops, idc) \
+    test_bit(RFS_IDC_TO_OP_ID(idc), (rops)->bits[RFS_IDC_TO_ITYPE(idc)])
+
+/* a filter has a callback for negative dentries, see rfs_dcache_rdentry_add_lookup */
+#define RFS_OPS_DNONE 0x1
+
 struct rfs_ops *rfs_ops_alloc(void);
 struct rfs_ops *rfs_ops_get(struct rfs_ops *rops);
 void rfs_ops_put(struct rfs_ops *rops);
 
+struct rfs_chain_cb {
+    enum redirfs_rv (*pre_cb)(redirfs_context, struct redirfs_args *);
+    enum redirfs_rv (*post_cb)(redirfs_context, struct redirfs_args *);
+    struct rfs_flt *rflt;
+};
+
+/*
+ * callbacks of the active filters compiled for each operation, the callbacks
+ * for the (it, op_id) operation are cbs[start[n]] .. cbs[start[n + 1] - 1]
+ * where n = it * RFS_OP_MAX + op_id, the order is the chain's priority order
+ */
+struct rfs_chain_cbs {
+    union {
+        struct rcu_head rcu;
+        struct list_head list;
+    };
+    /* the chain's reference and those of the queued kiocbs */
+    atomic_t count;
+    unsigned short start[RFS_INODE_MAX * RFS_OP_MAX + 1];
+    /* operations with a callback not flagged REDIRFS_OP_NONBLOCK */
+    DECLARE_BITMAP(may_block, RFS_INODE_MAX * RFS_OP_MAX);
+    struct rfs_chain_cb cbs[];
+};
+
 struct rfs_chain {
     struct rfs_flt **rflts;
     int rflts_nr;
     atomic_t count;
+    struct rfs_chain_cbs *cbs; /* never NULL for a published chain */
+    struct list_head list;
+    struct hlist_node hnode; /* the interned chains */
+    u32 hash;
+    int cbs_stale;
+#ifndef RFS_INFO_SRCU
+    struct list_head cbs_retired;
+#endif
 };
 
 struct rfs_chain *rfs_chain_get(struct rfs_chain *rchain);
@@ -476,20 +655,54 @@ struct rfs_chain *rfs_chain_join(struct rfs_chain *rch1,
         struct rfs_chain *rch2);
 struct rfs_chain *rfs_chain_diff(struct rfs_chain *rch1,
         struct rfs_chain *rch2);
+int rfs_chain_unique_nr(void);
+int rfs_chain_update_flt(struct rfs_flt *rflt);
+#ifdef RFS_INFO_SRCU
+struct rfs_chain_cbs *rfs_chain_cbs_get(struct rfs_chain_cbs *rcbs);
+void rfs_chain_cbs_put(struct rfs_chain_cbs *rcbs);
+#endif
+
+/*
+ * rdentry->rinfo and rinode->rinfo are published with rcu_assign_pointer()
+ * and the last reference to rfs_info is dropped through call_srcu(), so the
+ * hooks can use the rinfo inside an SRCU read side section without taking
+ * the object spinlock and without touching rinfo->count. SRCU is used
+ * instead of RCU as filters' callbacks are allowed to sleep.
+ *
+ * The infos are immutable. The infos of a root point to the root's slot,
+ * rroot->rslot, and the hooks use the info published in the slot instead,
+ * see rfs_info_slot(). A filter added to the root publishes a switched
+ * info in the slot if the ops already hooked cover it, see
+ * rfs_info_switch(), a filter removed from the base chain needs a walk. A switched info stands for the root's info it was
+ * published over, rbase, which is what the objects are attached with.
+ */
 
 struct rfs_info {
     struct rfs_chain *rchain;
     struct rfs_ops *rops;
     struct rfs_root *rroot;
+    struct rfs_info **rslot;
+    struct rfs_info *rbase;
     atomic_t count;
+    struct hlist_node hnode; /* the interned infos */
+#ifdef RFS_INFO_SRCU
+    struct rcu_head rcu;
+#endif
 };
 
 extern struct rfs_info *rfs_info_none;
+#ifdef RFS_INFO_SRCU
+extern struct srcu_struct rfs_info_srcu;
+#endif
 
 struct rfs_info *rfs_info_alloc(struct rfs_root *rroot,
         struct rfs_chain *rchain);
 struct rfs_info *rfs_info_get(struct rfs_info *rinfo);
 void rfs_info_put(struct rfs_info *rinfo);
+void rfs_info_retire_flt(struct rfs_flt *rflt);
+struct rfs_info *rfs_info_get_slot(struct rfs_info *rinfo);
+int rfs_info_switch(struct rfs_root *rroot, struct rfs_chain *rchain);
+int rfs_info_unique_nr(void);
 struct rfs_info *rfs_info_parent(struct dentry *dentry);
 int rfs_info_add_include(struct rfs_root *rroot, struct rfs_flt *rflt);
 int rfs_info_add_exclude(struct rfs_root *rroot, struct rfs_flt *rflt);
@@ -503,6 +716,54 @@ int rfs_info_set(struct dentry *dentry, struct rfs_info *rinfo,
         struct rfs_flt *rflt);
 int rfs_info_reset(struct dentry *dentry, struct rfs_info *rinfo);
 
+/*
+ * the info the hooks see for an object's rinfo, called in an SRCU read side
+ * section or with rfs_path_mutex which serialises the slot changes
+ */
+static inline struct rfs_info *rfs_info_slot(struct rfs_info *rinfo)
+{
+#ifdef RFS_INFO_SRCU
+    struct rfs_info *rinfo_slot;
+
+    if (!rinfo || !rinfo->rslot)
+        return rinfo;
+
+    rinfo_slot = srcu_dereference_check(*rinfo->rslot, &rfs_info_srcu,
+            lockdep_is_held(&rfs_path_mutex));
+
+    return rinfo_slot ? rinfo_slot : rinfo;
+#else
+    return rinfo;
+#endif
+}
+
+/* the info to attach an object with, see struct rfs_info */
+static inline struct rfs_info *rfs_info_base(struct rfs_info *rinfo)
+{
+    if (rinfo && rinfo->rbase)
+        return rinfo->rbase;
+
+    return rinfo;
+}
+
+/* checks the filter against the chain the hooks see, any context */
+static inline int rfs_info_find_flt(struct rfs_info *rinfo,
+        struct rfs_flt *rflt)
+{
+#ifdef RFS_INFO_SRCU
+    int idx;
+    int rv;
+
+    idx = srcu_read_lock(&rfs_info_srcu);
+    rv = rfs_chain_find(rfs_info_slot(rinfo)->rchain, rflt);
+    srcu_read_unlock(&rfs_info_srcu, idx);
+
+    return rv;
+#else
+    return rfs_chain_find(rinfo->rchain, rflt);
+#endif
+}
+
 struct rfs_dentry {
 #ifdef RFS_DBG
     #define RFS_DENTRY_SIGNATURE  0xABCD0005
@@ -511,7 +772,7 @@ struct rfs_dentry {
     struct rfs_object robject;
     struct list_head rinode_list;
     struct list_head rfiles;
-    struct list_head data;
+    struct rfs_data_head data;
     struct dentry *dentry;
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,30))
     const struct dentry_operations *op_old;
@@ -531,6 +792,7 @@ struct rfs_dentry {
 }; 
 
 struct rfs_dentry* rfs_dentry_find(const struct dentry *dentry);
+struct rfs_dentry* rfs_dentry_find_rcu(const struct dentry *dentry);
 
 void rfs_d_iput(struct dentry *dentry, struct inode *inode);
 struct rfs_dentry *rfs_dentry_get(struct rfs_dentry *rdentry);
@@ -559,9 +821,9 @@ struct rfs_inode {
 #endif // RFS_DBG
     struct rfs_object robject;
     struct list_head rdentries; /* mutex */
-    struct list_head data;
+    struct list_head links_list; /* rfs_inode_joined_lock */
+    struct rfs_data_head data;
     struct inode *inode;
-    struct file_operations f_op_new;
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,17))
     const struct inode_operations           *op_old;
     const struct file_operations            *f_op_old;
@@ -572,11 +834,14 @@ struct rfs_inode {
     struct address_space_operations *a_op_old;
 #endif
 #ifdef RFS_PER_OBJECT_OPS
+    struct file_operations          f_op_new;
     struct inode_operations         op_new;
     struct address_space_operations a_op_new;
 #else
     struct rfs_hoperations *i_rhops;
     struct rfs_hoperations *a_rhops;
+    /* the default i_fop, shared with the inodes and files of the same f_op_old */
+    struct rfs_hoperations *f_rhops;
     /* a mask of hooked operations for an inode */
     unsigned long   i_op_bitfield[BIT_WORD(RFS_OP_i_end-RFS_OP_i_start) + 1];
     unsigned long   a_op_bitfield[BIT_WORD(RFS_OP_a_end-RFS_OP_a_start) + 1];
@@ -586,9 +851,14 @@ struct rfs_inode {
     spinlock_t lock;
     atomic_t nlink;
     int rdentries_nr; /* mutex */
+    unsigned long flags; /* RFS_INODE_* bits */
 };
 
+/* the cached children of the directory are not attached yet */
+#define RFS_INODE_EXPAND 0
+
 struct rfs_inode* rfs_inode_find(struct inode *inode);
+struct rfs_inode* rfs_inode_find_rcu(struct inode *inode);
 
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(4,9,0))
 int rfs_rename(struct inode *old_dir, struct dentry *old_dentry,
@@ -609,10 +879,48 @@ void rfs_inode_rem_rdentry(struct rfs_inode *rinode,
         struct rfs_dentry *rdentry);
 struct rfs_info *rfs_inode_get_rinfo(struct rfs_inode *rinode);
 int rfs_inode_set_rinfo(struct rfs_inode *rinode);
+int rfs_inode_set_rinfo_links(struct rfs_root *rroot);
 void rfs_inode_set_ops(struct rfs_inode *rinode);
 int rfs_inode_cache_create(void);
 void rfs_inode_cache_destroy(void);
 
+/*
+ * fast path rinfo access for hooks, the returned rinfo is valid until
+ * rfs_info_read_done() is called with the same idx
+ */
+static inline struct rfs_info *rfs_dentry_read_rinfo(
+        struct rfs_dentry *rdentry, int *idx)
+{
+#ifdef RFS_INFO_SRCU
+    *idx = srcu_read_lock(&rfs_info_srcu);
+    return rfs_info_slot(srcu_dereference(rdentry->rinfo, &rfs_info_srcu));
+#else
+    *idx = 0;
+    return rfs_dentry_get_rinfo(rdentry);
+#endif
+}
+
+static inline struct rfs_info *rfs_inode_read_rinfo(
+        struct rfs_inode *rinode, int *idx)
+{
+#ifdef RFS_INFO_SRCU
+    *idx = srcu_read_lock(&rfs_info_srcu);
+    return rfs_info_slot(srcu_dereference(rinode->rinfo, &rfs_info_srcu));
+#else
+    *idx = 0;
+    return rfs_inode_get_rinfo(rinode);
+#endif
+}
+
+static inline void rfs_info_read_done(struct rfs_info *rinfo, int idx)
+{
+#ifdef RFS_INFO_SRCU
+    srcu_read_unlock(&rfs_info_srcu, idx);
+#else
+    rfs_info_put(rinfo);
+#endif
+}
+
 struct rfs_file {
 
 #ifdef RFS_DBG
@@ -622,7 +930,7 @@ struct rfs_file {
 
     struct rfs_object robject;
     struct list_head rdentry_list;
-    struct list_head data;
+    struct rfs_data_head data;
     struct file *file;
     struct rfs_dentry *rdentry;
 #ifndef RFS_PER_OBJECT_OPS 
@@ -656,6 +964,9 @@ struct rfs_file* rfs_file_find_with_open_flts(struct file *file);
 extern struct file_operations rfs_file_ops;
 extern struct file_operations rfs_reg_file_ops;
 
+long rfs_iocb_fallback_nr(void);
+void rfs_iocb_drain(void);
+
 int rfs_open(struct inode *inode, struct file *file);
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(3,6,0))
 struct dentry *rfs_lookup(struct inode *dir, struct dentry *dentry,
@@ -685,16 +996,27 @@ void rfs_dcache_data_free(struct rfs_dcache_data *rdata);
 struct rfs_dcache_entry {
     struct list_head list;
     struct dentry *dentry;
+    struct dentry *cursor; /* a walk continues after it, or NULL */
 };
 
 int rfs_dcache_walk(struct dentry *root, int (*cb)(struct dentry *, void *),
         void *data);
+int rfs_dcache_walk_parallel(struct dentry *root,
+        int (*cb)(struct dentry *, void *), void *data);
+int rfs_dcache_walk_init(void);
+void rfs_dcache_walk_exit(void);
+ssize_t rfs_dcache_walk_show(char *buf, ssize_t size);
 int rfs_dcache_add_dir(struct dentry *dentry, void *data);
 int rfs_dcache_add(struct dentry *dentry, void *data);
+int rfs_dcache_add_lazy(struct dentry *dentry, void *data);
+int rfs_dcache_walk_add(struct rfs_dcache_data *rdata);
+int rfs_dcache_add_dir_lazy(struct dentry *dentry);
+int rfs_dcache_expand(struct rfs_inode *rinode);
 int rfs_dcache_rem(struct dentry *dentry, void *data);
 int rfs_dcache_set(struct dentry *dentry, void *data);
 int rfs_dcache_reset(struct dentry *dentry, void *data);
 int rfs_dcache_rdentry_add(struct dentry *dentry, struct rfs_info *rinfo);
+int rfs_dcache_rdentry_add_lookup(struct dentry *dentry, struct rfs_info *rinfo);
 int rfs_dcache_rinode_del(struct rfs_dentry *rdentry, struct inode *inode);
 
 int rfs_dcache_get_subs(
@@ -710,8 +1032,22 @@ rfs_get_first_cached_dir_entry(
 
 struct rfs_context {
     struct list_head data;
+    /*
+     * the objects resolved by the hook, not referenced by the context,
+     * the hook holds them until the context is released
+     */
+    struct rfs_inode *rinode;
+    struct rfs_dentry *rdentry;
+    struct rfs_file *rfile;
     int idx;
     int idx_start;
+    /* callbacks latched by rfs_precall_flts for rfs_postcall_flts */
+    struct rfs_chain_cbs *rcbs;
+#ifdef RFS_INFO_SRCU
+    int rcbs_idx;
+#endif
+    /* start of the original operation if its latency is collected */
+    u64 lat_start;
 };
 
 void rfs_context_init(struct rfs_context *rcont, int start);
@@ -721,6 +1057,8 @@ int rfs_precall_flts(struct rfs_chain *rchain, struct rfs_context *rcont,
         struct redirfs_args *rargs);
 void rfs_postcall_flts(struct rfs_chain *rchain, struct rfs_context *rcont,
         struct redirfs_args *rargs);
+bool rfs_chain_may_block(struct rfs_chain *rchain, struct rfs_context *rcont,
+        enum redirfs_op_idc idc);
 
 enum rfs_inode_type rfs_imode_to_type(umode_t i_mode, bool is_dentry);
 enum redirfs_op_idc rfs_inode_to_idc(struct inode* inode, enum rfs_op_id id);
@@ -778,18 +1116,25 @@ void rfs_data_remove(struct list_head *head);
 
 #endif /* ! LINUX_VERSION_CODE <= KERNEL_VERSION(2,6,16)) */
 
+/* the objects are charged to the memory cgroup of the allocating task */
+#ifdef SLAB_ACCOUNT
+    #define RFS_SLAB_FLAGS (SLAB_RECLAIM_ACCOUNT | SLAB_ACCOUNT)
+#else
+    #define RFS_SLAB_FLAGS SLAB_RECLAIM_ACCOUNT
+#endif
+
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,23))
 
     static inline rfs_kmem_cache_t *rfs_kmem_cache_create(const char *n, size_t s)
     {
-        return kmem_cache_create(n, s, 0, SLAB_RECLAIM_ACCOUNT, NULL);
+        return kmem_cache_create(n, s, 0, RFS_SLAB_FLAGS, NULL);
     }
 
 #else
 
     static inline rfs_kmem_cache_t *rfs_kmem_cache_create(const char *n, size_t s)
     {
-        return kmem_cache_create(n, s, 0, SLAB_RECLAIM_ACCOUNT, NULL, NULL);
+        return kmem_cache_create(n, s, 0, RFS_SLAB_FLAGS, NULL, NULL);
     }
 
 #endif
@@ -22,6 +22,7 @@
 
 #include "rfs.h"
 #include <linux/mm.h>
+#include <linux/pagemap.h>
 
 #ifdef RFS_DBG
     #pragma GCC push_options
@@ -58,11 +59,13 @@ static struct address_space *rfs_page_mapping(struct page *page)
 }
 #endif //(LINUX_VERSION_CODE < KERNEL_VERSION(4,8,0))
 
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(5,19,0))
 int rfs_readpage(struct file *file,
                  struct page *page)
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_inode *rinode;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
@@ -71,13 +74,15 @@ int rfs_readpage(struct file *file,
     
     rfile = rfs_file_find(file);
     if (rfile) {
-        rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+        rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
         rinode = rfs_inode_get(rfile->rdentry->rinode);
     } else {
         rinode = rfs_inode_find(file->f_inode);
-        rinfo = rfs_inode_get_rinfo(rinode);
+        rinfo = rfs_inode_read_rinfo(rinode, &rinfo_idx);
     }
     BUG_ON(!rinfo || !rinode);
+    rcont.rfile = rfile;
+    rcont.rinode = rinode;
 
     rargs.type.id = REDIRFS_REG_AOP_READPAGE;
     rargs.args.a_readpage.file = file;
@@ -99,10 +104,12 @@ int rfs_readpage(struct file *file,
 
     rfs_file_put(rfile);
     rfs_inode_put(rinode);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
+#endif
 
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(5,18,0))
 int rfs_readpages(struct file *file,
                   struct address_space *mapping,
                   struct list_head *pages,
@@ -110,6 +117,7 @@ int rfs_readpages(struct file *file,
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_inode *rinode;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
@@ -118,13 +126,15 @@ int rfs_readpages(struct file *file,
 
     rfile = rfs_file_find(file);
     if (rfile) {
-        rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+        rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
         rinode = rfs_inode_get(rfile->rdentry->rinode);
     } else {
         rinode = rfs_inode_find(file->f_inode);
-        rinfo = rfs_inode_get_rinfo(rinode);
+        rinfo = rfs_inode_read_rinfo(rinode, &rinfo_idx);
     }
     BUG_ON(!rinfo || !rinode);
+    rcont.rfile = rfile;
+    rcont.rinode = rinode;
 
     rargs.type.id = REDIRFS_REG_AOP_READPAGES;
     rargs.args.a_readpages.file = file;
@@ -150,21 +160,24 @@ int rfs_readpages(struct file *file,
 
     rfs_file_put(rfile);
     rfs_inode_put(rinode);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
+#endif
 
 int rfs_writepages(struct address_space *mapping,
                    struct writeback_control *wbc)
 {
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_inode *rinode;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
     rinode = rfs_inode_find(mapping->host);
-    rinfo = rfs_inode_get_rinfo(rinode);
+    rinfo = rfs_inode_read_rinfo(rinode, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
 
     BUG_ON(!rinfo);
 
@@ -186,14 +199,16 @@ int rfs_writepages(struct address_space *mapping,
 
     rfs_context_deinit(&rcont);
 
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     rfs_inode_put(rinode);
     return rargs.rv.rv_int;
 }
 
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(5,18,0))
 int rfs_set_page_dirty(struct page *page)
 {
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_inode *rinode;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
@@ -206,8 +221,9 @@ int rfs_set_page_dirty(struct page *page)
         return set_page_dirty(page);
 
     rinode = rfs_inode_find(mapping->host);
-    rinfo = rfs_inode_get_rinfo(rinode);
+    rinfo = rfs_inode_read_rinfo(rinode, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
 
     BUG_ON(!rinfo);
 
@@ -227,10 +243,11 @@ int rfs_set_page_dirty(struct page *page)
 
     rfs_context_deinit(&rcont);
 
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     rfs_inode_put(rinode);
     return rargs.rv.rv_int;
 }
+#endif
 
 int rfs_write_begin(struct file *file,
                     struct address_space *mapping,
@@ -242,6 +259,7 @@ int rfs_write_begin(struct file *file,
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_inode *rinode;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
@@ -250,13 +268,15 @@ int rfs_write_begin(struct file *file,
 
     rfile = rfs_file_find(file);
     if (rfile) {
-        rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+        rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
         rinode = rfs_inode_get(rfile->rdentry->rinode);
     } else {
         rinode = rfs_inode_find(file->f_inode);
-        rinfo = rfs_inode_get_rinfo(rinode);
+        rinfo = rfs_inode_read_rinfo(rinode, &rinfo_idx);
     }
     BUG_ON(!rinfo || !rinode);
+    rcont.rfile = rfile;
+    rcont.rinode = rinode;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_a_write_begin);
     rargs.args.a_write_begin.file = file;
@@ -288,7 +308,7 @@ int rfs_write_begin(struct file *file,
 
     rfs_file_put(rfile);
     rfs_inode_put(rinode);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 
@@ -302,6 +322,7 @@ int rfs_write_end(struct file *file,
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_inode *rinode;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
@@ -310,13 +331,15 @@ int rfs_write_end(struct file *file,
 
     rfile = rfs_file_find(file);
     if (rfile) {
-        rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+        rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
         rinode = rfs_inode_get(rfile->rdentry->rinode);
     } else {
         rinode = rfs_inode_find(file->f_inode);
-        rinfo = rfs_inode_get_rinfo(rinode);
+        rinfo = rfs_inode_read_rinfo(rinode, &rinfo_idx);
     }
     BUG_ON(!rinfo || !rinode);
+    rcont.rfile = rfile;
+    rcont.rinode = rinode;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_a_write_end);
     rargs.args.a_write_end.file = file;
@@ -348,7 +371,7 @@ int rfs_write_end(struct file *file,
 
     rfs_file_put(rfile);
     rfs_inode_put(rinode);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 
@@ -356,13 +379,15 @@ sector_t rfs_bmap(struct address_space *mapping,
                   sector_t block)
 {
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_inode *rinode;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
     rinode = rfs_inode_find(mapping->host);
-    rinfo = rfs_inode_get_rinfo(rinode);
+    rinfo = rfs_inode_read_rinfo(rinode, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
 
     BUG_ON(!rinfo);
 
@@ -384,7 +409,7 @@ sector_t rfs_bmap(struct address_space *mapping,
 
     rfs_context_deinit(&rcont);
 
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     rfs_inode_put(rinode);
     return rargs.rv.rv_int;
 }
@@ -394,6 +419,7 @@ void rfs_invalidatepage(struct page *page,
                         unsigned int offset)
 {
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_inode *rinode;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
@@ -406,8 +432,9 @@ void rfs_invalidatepage(struct page *page,
         return;
 
     rinode = rfs_inode_find(mapping->host);
-    rinfo = rfs_inode_get_rinfo(rinode);
+    rinfo = rfs_inode_read_rinfo(rinode, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
 
     BUG_ON(!rinfo);
 
@@ -428,16 +455,17 @@ void rfs_invalidatepage(struct page *page,
 
     rfs_context_deinit(&rcont);
 
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     rfs_inode_put(rinode);
 }
 
-#else
+#elif (LINUX_VERSION_CODE < KERNEL_VERSION(5,18,0))
 void rfs_invalidatepage(struct page *page,
                         unsigned int offset,
                         unsigned int length)
 {
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_inode *rinode;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
@@ -450,8 +478,9 @@ void rfs_invalidatepage(struct page *page,
         return;
 
     rinode = rfs_inode_find(mapping->host);
-    rinfo = rfs_inode_get_rinfo(rinode);
+    rinfo = rfs_inode_read_rinfo(rinode, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
 
     BUG_ON(!rinfo);
 
@@ -474,15 +503,17 @@ void rfs_invalidatepage(struct page *page,
 
     rfs_context_deinit(&rcont);
 
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     rfs_inode_put(rinode);
 }
 #endif
 
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(5,19,0))
 int rfs_releasepage(struct page *page,
                     gfp_t flags)
 {
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_inode *rinode;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
@@ -495,8 +526,9 @@ int rfs_releasepage(struct page *page,
         return -EINVAL;
 
     rinode = rfs_inode_find(mapping->host);
-    rinfo = rfs_inode_get_rinfo(rinode);
+    rinfo = rfs_inode_read_rinfo(rinode, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
 
     BUG_ON(!rinfo);
 
@@ -518,11 +550,243 @@ int rfs_releasepage(struct page *page,
 
     rfs_context_deinit(&rcont);
 
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
+    rfs_inode_put(rinode);
+    return rargs.rv.rv_int;
+}
+#endif
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5,8,0))
+void rfs_readahead(struct readahead_control *rac)
+{
+    struct rfs_file *rfile;
+    struct rfs_info *rinfo;
+    int rinfo_idx;
+    struct rfs_inode *rinode;
+    struct rfs_context rcont;
+    RFS_DEFINE_REDIRFS_ARGS(rargs);
+
+    rfs_context_init(&rcont, 0);
+
+    /* the file is NULL for readahead without an open file */
+    rfile = rac->file ? rfs_file_find(rac->file) : NULL;
+    if (rfile) {
+        rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
+        rinode = rfs_inode_get(rfile->rdentry->rinode);
+    } else {
+        rinode = rfs_inode_find(rac->mapping->host);
+        rinfo = rfs_inode_read_rinfo(rinode, &rinfo_idx);
+    }
+    BUG_ON(!rinfo || !rinode);
+    rcont.rfile = rfile;
+    rcont.rinode = rinode;
+
+    rargs.type.id = REDIRFS_REG_AOP_READAHEAD;
+    rargs.args.a_readahead.rac = rac;
+
+    if (!RFS_IS_AOP_SET(rinode, rargs.type.id) ||
+        !rfs_precall_flts(rinfo->rchain, &rcont, &rargs)) {
+        if (rinode->a_op_old && rinode->a_op_old->readahead)
+            rinode->a_op_old->readahead(
+                    rargs.args.a_readahead.rac);
+    }
+
+    if (RFS_IS_AOP_SET(rinode, rargs.type.id))
+        rfs_postcall_flts(rinfo->rchain, &rcont, &rargs);
+
+    rfs_context_deinit(&rcont);
+
+    rfs_file_put(rfile);
+    rfs_inode_put(rinode);
+    rfs_info_read_done(rinfo, rinfo_idx);
+}
+#endif
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5,18,0))
+bool rfs_dirty_folio(struct address_space *mapping,
+                     struct folio *folio)
+{
+    struct rfs_info *rinfo;
+    int rinfo_idx;
+    struct rfs_inode *rinode;
+    struct rfs_context rcont;
+    RFS_DEFINE_REDIRFS_ARGS(rargs);
+
+    rinode = rfs_inode_find(mapping->host);
+    rinfo = rfs_inode_read_rinfo(rinode, &rinfo_idx);
+    rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
+
+    BUG_ON(!rinfo);
+
+    rargs.type.id = rfs_inode_to_idc(rinode->inode, RFS_OP_a_dirty_folio);
+    rargs.args.a_dirty_folio.mapping = mapping;
+    rargs.args.a_dirty_folio.folio = folio;
+    rargs.rv.rv_bool = false;
+
+    if (!RFS_IS_AOP_SET(rinode, rargs.type.id) ||
+        !rfs_precall_flts(rinfo->rchain, &rcont, &rargs)) {
+        if (rinode->a_op_old && rinode->a_op_old->dirty_folio)
+            rargs.rv.rv_bool = rinode->a_op_old->dirty_folio(
+                    rargs.args.a_dirty_folio.mapping,
+                    rargs.args.a_dirty_folio.folio);
+    }
+
+    if (RFS_IS_AOP_SET(rinode, rargs.type.id))
+        rfs_postcall_flts(rinfo->rchain, &rcont, &rargs);
+
+    rfs_context_deinit(&rcont);
+
+    rfs_info_read_done(rinfo, rinfo_idx);
+    rfs_inode_put(rinode);
+    return rargs.rv.rv_bool;
+}
+
+void rfs_invalidate_folio(struct folio *folio,
+                          size_t offset,
+                          size_t length)
+{
+    struct rfs_info *rinfo;
+    int rinfo_idx;
+    struct rfs_inode *rinode;
+    struct rfs_context rcont;
+    RFS_DEFINE_REDIRFS_ARGS(rargs);
+    struct address_space *mapping;
+
+    mapping = folio_mapping(folio);
+
+    WARN_ON(!mapping);
+    if (unlikely(!mapping))
+        return;
+
+    rinode = rfs_inode_find(mapping->host);
+    rinfo = rfs_inode_read_rinfo(rinode, &rinfo_idx);
+    rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
+
+    BUG_ON(!rinfo);
+
+    rargs.type.id = rfs_inode_to_idc(rinode->inode, RFS_OP_a_invalidate_folio);
+    rargs.args.a_invalidate_folio.folio = folio;
+    rargs.args.a_invalidate_folio.offset = offset;
+    rargs.args.a_invalidate_folio.length = length;
+
+    if (!RFS_IS_AOP_SET(rinode, rargs.type.id) ||
+        !rfs_precall_flts(rinfo->rchain, &rcont, &rargs)) {
+        if (rinode->a_op_old && rinode->a_op_old->invalidate_folio)
+            rinode->a_op_old->invalidate_folio(
+                    rargs.args.a_invalidate_folio.folio,
+                    rargs.args.a_invalidate_folio.offset,
+                    rargs.args.a_invalidate_folio.length);
+    }
+
+    if (RFS_IS_AOP_SET(rinode, rargs.type.id))
+        rfs_postcall_flts(rinfo->rchain, &rcont, &rargs);
+
+    rfs_context_deinit(&rcont);
+
+    rfs_info_read_done(rinfo, rinfo_idx);
     rfs_inode_put(rinode);
+}
+#endif
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5,19,0))
+int rfs_read_folio(struct file *file,
+                   struct folio *folio)
+{
+    struct rfs_file *rfile;
+    struct rfs_info *rinfo;
+    int rinfo_idx;
+    struct rfs_inode *rinode;
+    struct rfs_context rcont;
+    RFS_DEFINE_REDIRFS_ARGS(rargs);
+
+    rfs_context_init(&rcont, 0);
+
+    /* the file is NULL when the page cache is filled without an open file */
+    rfile = file ? rfs_file_find(file) : NULL;
+    if (rfile) {
+        rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
+        rinode = rfs_inode_get(rfile->rdentry->rinode);
+    } else {
+        rinode = rfs_inode_find(folio->mapping->host);
+        rinfo = rfs_inode_read_rinfo(rinode, &rinfo_idx);
+    }
+    BUG_ON(!rinfo || !rinode);
+    rcont.rfile = rfile;
+    rcont.rinode = rinode;
+
+    rargs.type.id = REDIRFS_REG_AOP_READ_FOLIO;
+    rargs.args.a_read_folio.file = file;
+    rargs.args.a_read_folio.folio = folio;
+    rargs.rv.rv_int = -EIO;
+
+    if (!RFS_IS_AOP_SET(rinode, rargs.type.id) ||
+        !rfs_precall_flts(rinfo->rchain, &rcont, &rargs)) {
+        if (rinode->a_op_old && rinode->a_op_old->read_folio)
+            rargs.rv.rv_int = rinode->a_op_old->read_folio(
+                    rargs.args.a_read_folio.file,
+                    rargs.args.a_read_folio.folio);
+    }
+
+    if (RFS_IS_AOP_SET(rinode, rargs.type.id))
+        rfs_postcall_flts(rinfo->rchain, &rcont, &rargs);
+
+    rfs_context_deinit(&rcont);
+
+    rfs_file_put(rfile);
+    rfs_inode_put(rinode);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 
+bool rfs_release_folio(struct folio *folio,
+                       gfp_t gfp)
+{
+    struct rfs_info *rinfo;
+    int rinfo_idx;
+    struct rfs_inode *rinode;
+    struct rfs_context rcont;
+    RFS_DEFINE_REDIRFS_ARGS(rargs);
+    struct address_space *mapping;
+
+    mapping = folio_mapping(folio);
+
+    WARN_ON(!mapping);
+    if (unlikely(!mapping))
+        return false;
+
+    rinode = rfs_inode_find(mapping->host);
+    rinfo = rfs_inode_read_rinfo(rinode, &rinfo_idx);
+    rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
+
+    BUG_ON(!rinfo);
+
+    rargs.type.id = rfs_inode_to_idc(rinode->inode, RFS_OP_a_release_folio);
+    rargs.args.a_release_folio.folio = folio;
+    rargs.args.a_release_folio.gfp = gfp;
+    rargs.rv.rv_bool = false;
+
+    if (!RFS_IS_AOP_SET(rinode, rargs.type.id) ||
+        !rfs_precall_flts(rinfo->rchain, &rcont, &rargs)) {
+        if (rinode->a_op_old && rinode->a_op_old->release_folio)
+            rargs.rv.rv_bool = rinode->a_op_old->release_folio(
+                    rargs.args.a_release_folio.folio,
+                    rargs.args.a_release_folio.gfp);
+    }
+
+    if (RFS_IS_AOP_SET(rinode, rargs.type.id))
+        rfs_postcall_flts(rinfo->rchain, &rcont, &rargs);
+
+    rfs_context_deinit(&rcont);
+
+    rfs_info_read_done(rinfo, rinfo_idx);
+    rfs_inode_put(rinode);
+    return rargs.rv.rv_bool;
+}
+#endif
+
 /*
     ssize_t (*direct_IO)(struct kiocb *, struct iov_iter *);
     int (*migratepage)(struct address_space *, struct page *, struct page *, enum migrate_mode);
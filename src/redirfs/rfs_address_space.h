@@ -23,18 +23,24 @@
 
 #include "rfs.h"
 
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(5,19,0))
 int rfs_readpage(struct file *file,
                  struct page *page);
+#endif
 
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(5,18,0))
 int rfs_readpages(struct file *file,
                   struct address_space *mapping,
                   struct list_head *pages,
                   unsigned int nr_pages);
+#endif
 
 int rfs_writepages(struct address_space *mapping,
                    struct writeback_control *wbc);
 
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(5,18,0))
 int rfs_set_page_dirty(struct page *page);
+#endif
 
 int rfs_write_begin(struct file *file,
                     struct address_space *mapping,
@@ -57,13 +63,36 @@ sector_t rfs_bmap(struct address_space *mapping,
 
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(3,11,0))
 void rfs_invalidatepage(struct page *page, unsigned long offset);
-#else
+#elif (LINUX_VERSION_CODE < KERNEL_VERSION(5,18,0))
 void rfs_invalidatepage(struct page *page,
                         unsigned int offset,
                         unsigned int length);
 #endif
 
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(5,19,0))
 int rfs_releasepage(struct page *page,
                     gfp_t flags);
+#endif
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5,8,0))
+void rfs_readahead(struct readahead_control *rac);
+#endif
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5,18,0))
+bool rfs_dirty_folio(struct address_space *mapping,
+                     struct folio *folio);
+
+void rfs_invalidate_folio(struct folio *folio,
+                          size_t offset,
+                          size_t length);
+#endif
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5,19,0))
+int rfs_read_folio(struct file *file,
+                   struct folio *folio);
+
+bool rfs_release_folio(struct folio *folio,
+                       gfp_t gfp);
+#endif
 
 #endif // _RFS_ADDRESS_SPACE_H
@@ -25,6 +25,8 @@
  * along with RedirFS. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <linux/hashtable.h>
+#include <linux/jhash.h>
 #include "rfs.h"
 
 #ifdef RFS_DBG
@@ -32,6 +34,307 @@
     #pragma GCC optimize ("O0")
 #endif // RFS_DBG
 
+/* all published chains, used to recompile callbacks after a filter change */
+static LIST_HEAD(rfs_chain_list);
+static DEFINE_SPINLOCK(rfs_chain_list_lock);
+static RFS_DEFINE_MUTEX(rfs_chain_cbs_mutex);
+
+/*
+ * published chains are interned by their ordered filter list, so there is
+ * at most one live chain for a filter list and the chains can be compared
+ * by pointers, protected by rfs_chain_list_lock
+ */
+static DEFINE_HASHTABLE(rfs_chain_table, 8);
+static atomic_t rfs_chain_nr = ATOMIC_INIT(0);
+
+static u32 rfs_chain_hash(struct rfs_chain *rchain)
+{
+    return jhash(rchain->rflts, sizeof(struct rfs_flt *) * rchain->rflts_nr,
+            rchain->rflts_nr);
+}
+
+static struct rfs_chain *rfs_chain_lookup(struct rfs_chain *rchain)
+{
+    struct rfs_chain *rch;
+
+    spin_lock_bh(&rfs_chain_list_lock);
+
+    hash_for_each_possible(rfs_chain_table, rch, hnode, rchain->hash) {
+        if (rch->hash != rchain->hash ||
+            rch->rflts_nr != rchain->rflts_nr ||
+            memcmp(rch->rflts, rchain->rflts,
+                sizeof(struct rfs_flt *) * rchain->rflts_nr))
+            continue;
+
+        /* the chain is being released */
+        if (!atomic_inc_not_zero(&rch->count))
+            continue;
+
+        spin_unlock_bh(&rfs_chain_list_lock);
+        return rch;
+    }
+
+    spin_unlock_bh(&rfs_chain_list_lock);
+
+    return NULL;
+}
+
+int rfs_chain_unique_nr(void)
+{
+    return atomic_read(&rfs_chain_nr);
+}
+
+static struct rfs_chain_cbs *rfs_chain_cbs_alloc(struct rfs_chain *rchain)
+{
+    struct rfs_chain_cbs *rcbs;
+    struct rfs_op_info *cb;
+    struct rfs_flt *rflt;
+    int nr = 0;
+    int it, op_id, i;
+
+    DBG_BUG_ON(!rfs_preemptible());
+
+    for (i = 0; i < rchain->rflts_nr; i++) {
+        rflt = rchain->rflts[i];
+        if (!atomic_read(&rflt->active))
+            continue;
+
+        for (it = 0; it < RFS_INODE_MAX; it++) {
+            for (op_id = 0; op_id < RFS_OP_MAX; op_id++) {
+                cb = &rflt->cbs[it][op_id];
+                if (cb->pre_cb || cb->post_cb)
+                    nr++;
+            }
+        }
+    }
+
+    if (nr > USHRT_MAX)
+        return ERR_PTR(-E2BIG);
+
+    rcbs = kzalloc(sizeof(struct rfs_chain_cbs) +
+            sizeof(struct rfs_chain_cb) * nr, GFP_KERNEL);
+    if (!rcbs)
+        return ERR_PTR(-ENOMEM);
+
+    atomic_set(&rcbs->count, 1);
+
+    nr = 0;
+    for (it = 0; it < RFS_INODE_MAX; it++) {
+        for (op_id = 0; op_id < RFS_OP_MAX; op_id++) {
+            rcbs->start[it * RFS_OP_MAX + op_id] = nr;
+
+            for (i = 0; i < rchain->rflts_nr; i++) {
+                rflt = rchain->rflts[i];
+                if (!atomic_read(&rflt->active))
+                    continue;
+
+                cb = &rflt->cbs[it][op_id];
+                if (!cb->pre_cb && !cb->post_cb)
+                    continue;
+
+                rcbs->cbs[nr].pre_cb = cb->pre_cb;
+                rcbs->cbs[nr].post_cb = cb->post_cb;
+                rcbs->cbs[nr].rflt = rflt;
+                nr++;
+
+                if (!(cb->flags & REDIRFS_OP_NONBLOCK))
+                    set_bit(it * RFS_OP_MAX + op_id, rcbs->may_block);
+            }
+        }
+    }
+    rcbs->start[RFS_INODE_MAX * RFS_OP_MAX] = nr;
+
+    return rcbs;
+}
+
+#ifdef RFS_INFO_SRCU
+static void rfs_chain_cbs_free_rcu(struct rcu_head *head)
+{
+    kfree(container_of(head, struct rfs_chain_cbs, rcu));
+}
+
+/*
+ * the hooks use the callbacks inside the SRCU read side without a
+ * reference, a kiocb queued for an asynchronous completion takes one, it
+ * fails for callbacks already retired by their chain
+ */
+struct rfs_chain_cbs *rfs_chain_cbs_get(struct rfs_chain_cbs *rcbs)
+{
+    if (!rcbs || !atomic_inc_not_zero(&rcbs->count))
+        return NULL;
+
+    return rcbs;
+}
+
+/* hooks might still use the callbacks, see rfs_precall_flts */
+void rfs_chain_cbs_put(struct rfs_chain_cbs *rcbs)
+{
+    if (!rcbs || !atomic_dec_and_test(&rcbs->count))
+        return;
+
+    call_srcu(&rfs_info_srcu, &rcbs->rcu, rfs_chain_cbs_free_rcu);
+}
+#endif
+
+/*
+ * hooks might still use the old callbacks, see rfs_precall_flts
+ */
+static void rfs_chain_cbs_retire(struct rfs_chain *rchain,
+        struct rfs_chain_cbs *rcbs)
+{
+#ifdef RFS_INFO_SRCU
+    rfs_chain_cbs_put(rcbs);
+#else
+    spin_lock_bh(&rfs_chain_list_lock);
+    list_add(&rcbs->list, &rchain->cbs_retired);
+    spin_unlock_bh(&rfs_chain_list_lock);
+#endif
+}
+
+/*
+ * compiles callbacks for a newly created chain and makes it visible for
+ * rfs_chain_update_flt, if an identical chain is already published the new
+ * one is released and the published one is returned, on failure the chain
+ * is released
+ */
+static struct rfs_chain *rfs_chain_publish(struct rfs_chain *rchain)
+{
+    struct rfs_chain_cbs *rcbs;
+    struct rfs_chain *rchain_pub;
+
+    rchain->hash = rfs_chain_hash(rchain);
+
+    /* serializes the lookup and the insert */
+    rfs_mutex_lock(&rfs_chain_cbs_mutex);
+
+    rchain_pub = rfs_chain_lookup(rchain);
+    if (rchain_pub) {
+        rfs_mutex_unlock(&rfs_chain_cbs_mutex);
+        rfs_chain_put(rchain);
+        return rchain_pub;
+    }
+
+    rcbs = rfs_chain_cbs_alloc(rchain);
+    if (IS_ERR(rcbs)) {
+        rfs_mutex_unlock(&rfs_chain_cbs_mutex);
+        rfs_chain_put(rchain);
+        return ERR_CAST(rcbs);
+    }
+
+    rchain->cbs = rcbs;
+
+    spin_lock_bh(&rfs_chain_list_lock);
+    list_add_tail(&rchain->list, &rfs_chain_list);
+    hash_add(rfs_chain_table, &rchain->hnode, rchain->hash);
+    spin_unlock_bh(&rfs_chain_list_lock);
+
+    atomic_inc(&rfs_chain_nr);
+
+    rfs_mutex_unlock(&rfs_chain_cbs_mutex);
+
+    return rchain;
+}
+
+static struct rfs_chain *rfs_chain_get_stale(void)
+{
+    struct rfs_chain *rchain;
+
+    spin_lock_bh(&rfs_chain_list_lock);
+
+    list_for_each_entry(rchain, &rfs_chain_list, list) {
+        if (!rchain->cbs_stale)
+            continue;
+
+        rchain->cbs_stale = 0;
+
+        /* the chain is being released */
+        if (!atomic_inc_not_zero(&rchain->count))
+            continue;
+
+        spin_unlock_bh(&rfs_chain_list_lock);
+        return rchain;
+    }
+
+    spin_unlock_bh(&rfs_chain_list_lock);
+
+    return NULL;
+}
+
+struct rfs_chain_update {
+    struct list_head list;
+    struct rfs_chain *rchain;
+    struct rfs_chain_cbs *rcbs;
+};
+
+/*
+ * recompiles callbacks for all chains containing the filter, has to be
+ * called after the filter's callbacks or its active state were changed,
+ * all callbacks are compiled before any is published so on failure no
+ * chain is changed and the caller reverts the change
+ */
+int rfs_chain_update_flt(struct rfs_flt *rflt)
+{
+    struct rfs_chain_update *update;
+    struct rfs_chain_update *tmp;
+    struct rfs_chain *rchain;
+    struct rfs_chain_cbs *rcbs;
+    struct rfs_chain_cbs *rcbs_old;
+    LIST_HEAD(updates);
+    int rv = 0;
+
+    might_sleep();
+
+    rfs_mutex_lock(&rfs_chain_cbs_mutex);
+
+    spin_lock_bh(&rfs_chain_list_lock);
+    list_for_each_entry(rchain, &rfs_chain_list, list) {
+        if (rfs_chain_find(rchain, rflt) != -1)
+            rchain->cbs_stale = 1;
+    }
+    spin_unlock_bh(&rfs_chain_list_lock);
+
+    /* the remaining chains are only unmarked after a failure */
+    while ((rchain = rfs_chain_get_stale())) {
+        if (rv) {
+            rfs_chain_put(rchain);
+            continue;
+        }
+
+        update = kmalloc(sizeof(struct rfs_chain_update), GFP_KERNEL);
+        rcbs = update ? rfs_chain_cbs_alloc(rchain) : ERR_PTR(-ENOMEM);
+        if (IS_ERR(rcbs)) {
+            rv = PTR_ERR(rcbs);
+            kfree(update);
+            rfs_chain_put(rchain);
+            continue;
+        }
+
+        update->rchain = rchain;
+        update->rcbs = rcbs;
+        list_add_tail(&update->list, &updates);
+    }
+
+    list_for_each_entry_safe(update, tmp, &updates, list) {
+        rchain = update->rchain;
+
+        if (rv) {
+            /* not published, no hook can see it */
+            kfree(update->rcbs);
+        } else {
+            rcbs_old = rchain->cbs;
+            rcu_assign_pointer(rchain->cbs, update->rcbs);
+            rfs_chain_cbs_retire(rchain, rcbs_old);
+        }
+
+        rfs_chain_put(rchain);
+        kfree(update);
+    }
+
+    rfs_mutex_unlock(&rfs_chain_cbs_mutex);
+
+    return rv;
+}
+
 static struct rfs_chain *rfs_chain_alloc(int size, int type)
 {
     struct rfs_chain *rchain;
@@ -48,6 +351,11 @@ static struct rfs_chain *rfs_chain_alloc(int size, int type)
     rchain->rflts = rflts;
     rchain->rflts_nr = size;
     atomic_set(&rchain->count, 1);
+    INIT_LIST_HEAD(&rchain->list);
+    INIT_HLIST_NODE(&rchain->hnode);
+#ifndef RFS_INFO_SRCU
+    INIT_LIST_HEAD(&rchain->cbs_retired);
+#endif
 
     return rchain;
 }
@@ -65,6 +373,10 @@ struct rfs_chain *rfs_chain_get(struct rfs_chain *rchain)
 
 void rfs_chain_put(struct rfs_chain *rchain)
 {
+#ifndef RFS_INFO_SRCU
+    struct rfs_chain_cbs *rcbs;
+    struct rfs_chain_cbs *tmp;
+#endif
     int i;
 
     if (!rchain || IS_ERR(rchain))
@@ -74,9 +386,28 @@ void rfs_chain_put(struct rfs_chain *rchain)
     if (!atomic_dec_and_test(&rchain->count))
         return;
 
+    spin_lock_bh(&rfs_chain_list_lock);
+    list_del(&rchain->list);
+    if (hash_hashed(&rchain->hnode)) {
+        hash_del(&rchain->hnode);
+        atomic_dec(&rfs_chain_nr);
+    }
+#ifndef RFS_INFO_SRCU
+    list_for_each_entry_safe(rcbs, tmp, &rchain->cbs_retired, list) {
+        list_del(&rcbs->list);
+        kfree(rcbs);
+    }
+#endif
+    spin_unlock_bh(&rfs_chain_list_lock);
+
     for (i = 0; i < rchain->rflts_nr; i++)
         rfs_flt_put(rchain->rflts[i]);
 
+#ifdef RFS_INFO_SRCU
+    rfs_chain_cbs_put(rchain->cbs);
+#else
+    kfree(rchain->cbs);
+#endif
     kfree(rchain->rflts);
     kfree(rchain);
 }
@@ -119,7 +450,7 @@ struct rfs_chain *rfs_chain_add(struct rfs_chain *rchain, struct rfs_flt *rflt)
 
     if (!rchain) {
         rchain_new->rflts[0] = rfs_flt_get(rflt);
-        return rchain_new;
+        return rfs_chain_publish(rchain_new);
     }
 
     while (rchain->rflts[i]->priority < rflt->priority) {
@@ -134,7 +465,7 @@ struct rfs_chain *rfs_chain_add(struct rfs_chain *rchain, struct rfs_flt *rflt)
         rchain_new->rflts[j++] = rfs_flt_get(rchain->rflts[i++]);
     }
 
-    return rchain_new;
+    return rfs_chain_publish(rchain_new);
 }
 
 struct rfs_chain *rfs_chain_rem(struct rfs_chain *rchain, struct rfs_flt *rflt)
@@ -159,7 +490,7 @@ struct rfs_chain *rfs_chain_rem(struct rfs_chain *rchain, struct rfs_flt *rflt)
             rchain_new->rflts[j++] = rfs_flt_get(rchain->rflts[i]);
     }
 
-    return rchain_new;
+    return rfs_chain_publish(rchain_new);
 }
 
 void rfs_chain_ops(struct rfs_chain *rchain, struct rfs_ops *rops)
@@ -176,34 +507,23 @@ void rfs_chain_ops(struct rfs_chain *rchain, struct rfs_ops *rops)
 
             int j;
             for (j = 0; j < RFS_OP_MAX; j++) {
-                if (rchain->rflts[i]->cbs[it][j].pre_cb)
-                    rops->arr[it][j]++;
-                if (rchain->rflts[i]->cbs[it][j].post_cb)
-                    rops->arr[it][j]++;
+                if (rchain->rflts[i]->cbs[it][j].pre_cb ||
+                    rchain->rflts[i]->cbs[it][j].post_cb)
+                    __set_bit(j, rops->bits[it]);
             }
         }
     }
+
+    if (!bitmap_empty(rops->bits[RFS_INODE_DNONE], RFS_OP_MAX))
+        rops->flags |= RFS_OPS_DNONE;
 }
 
+/*
+ * the chains are interned, see rfs_chain_publish
+ */
 int rfs_chain_cmp(struct rfs_chain *rch1, struct rfs_chain *rch2)
 {
-    int i;
-
-    if (!rch1 && !rch2)
-        return 0;
-
-    if (!rch1 || !rch2)
-        return -1;
-
-    if (rch1->rflts_nr != rch2->rflts_nr)
-        return -1;
-
-    for (i = 0; i < rch1->rflts_nr; i++) {
-        if (rch1->rflts[i] != rch2->rflts[i])
-            return -1;
-    }
-
-    return 0;
+    return rch1 == rch2 ? 0 : -1;
 }
 
 struct rfs_chain *rfs_chain_join(struct rfs_chain *rch1, struct rfs_chain *rch2)
@@ -254,7 +574,7 @@ struct rfs_chain *rfs_chain_join(struct rfs_chain *rch1, struct rfs_chain *rch2)
     while (l != rch2->rflts_nr)
         rch->rflts[i++] = rfs_flt_get(rch2->rflts[l++]);
 
-    return rch;
+    return rfs_chain_publish(rch);
 }
 
 struct rfs_chain *rfs_chain_diff(struct rfs_chain *rch1, struct rfs_chain *rch2)
@@ -295,7 +615,7 @@ struct rfs_chain *rfs_chain_diff(struct rfs_chain *rch1, struct rfs_chain *rch2)
 
     BUG_ON(j != size);
 
-    return rch;
+    return rfs_chain_publish(rch);
 }
 
 #ifdef RFS_DBG
@@ -44,6 +44,20 @@ void rfs_data_remove(struct list_head *head)
     }
 }
 
+void rfs_data_head_init(struct rfs_data_head *head)
+{
+    INIT_LIST_HEAD(&head->list);
+    RCU_INIT_POINTER(head->slots, NULL);
+}
+
+/* the object is not reachable, so there are no slot readers */
+void rfs_data_head_remove(struct rfs_data_head *head)
+{
+    rfs_data_remove(&head->list);
+    kfree(rcu_dereference_protected(head->slots, 1));
+    RCU_INIT_POINTER(head->slots, NULL);
+}
+
 int redirfs_init_data(struct redirfs_data *data, redirfs_filter filter,
         void (*free)(struct redirfs_data *),
         void (*detach)(struct redirfs_data *))
@@ -55,7 +69,7 @@ int redirfs_init_data(struct redirfs_data *data, redirfs_filter filter,
     atomic_set(&data->cnt, 1);
     data->free = free;
     data->detach = detach;
-    data->filter = rfs_flt_get(filter);
+    data->filter = rfs_flt_data_get(filter);
 
     return 0;
 }
@@ -72,6 +86,15 @@ struct redirfs_data *redirfs_get_data(struct redirfs_data *data)
     return data;
 }
 
+static void rfs_data_free_rcu(struct rcu_head *head)
+{
+    struct redirfs_data *data = container_of(head, struct redirfs_data, rcu);
+    struct rfs_flt *rflt = data->filter;
+
+    data->free(data);
+    rfs_flt_data_put(rflt);
+}
+
 void redirfs_put_data(struct redirfs_data *data)
 {
     if (!data || IS_ERR(data))
@@ -82,8 +105,8 @@ void redirfs_put_data(struct redirfs_data *data)
     if (!atomic_dec_and_test(&data->cnt))
         return;
 
-    rfs_flt_put(data->filter);
-    data->free(data);
+    /* a slot reader might still be referencing the data */
+    call_rcu(&data->rcu, rfs_data_free_rcu);
 }
 
 static struct redirfs_data *rfs_find_data(struct list_head *head,
@@ -99,6 +122,88 @@ static struct redirfs_data *rfs_find_data(struct list_head *head,
     return NULL;
 }
 
+/*
+ * the filter's slot is read without the object's lock, filters without
+ * a slot search the list under the lock
+ */
+static struct redirfs_data *rfs_data_head_get(struct rfs_data_head *head,
+        spinlock_t *lock, struct rfs_flt *rflt)
+{
+    struct rfs_data_slots *slots;
+    struct redirfs_data *data = NULL;
+
+    if (rflt->slot < 0) {
+        spin_lock(lock);
+        data = rfs_find_data(&head->list, rflt);
+        spin_unlock(lock);
+        return data;
+    }
+
+    rcu_read_lock();
+
+    slots = rcu_dereference(head->slots);
+    if (slots)
+        data = rcu_dereference(slots->data[rflt->slot]);
+
+    /* the detached data is released after the grace period */
+    if (data && !atomic_inc_not_zero(&data->cnt))
+        data = NULL;
+
+    rcu_read_unlock();
+
+    return data;
+}
+
+/* the object's lock is held */
+static struct redirfs_data *rfs_data_head_attach(struct rfs_data_head *head,
+        struct rfs_flt *rflt, struct redirfs_data *data)
+{
+    struct rfs_data_slots *slots;
+    struct redirfs_data *rv;
+
+    rv = rfs_find_data(&head->list, rflt);
+    if (rv)
+        return rv;
+
+    if (rflt->slot >= 0) {
+        slots = rcu_dereference_protected(head->slots, 1);
+        if (!slots) {
+            slots = kzalloc(sizeof(struct rfs_data_slots), GFP_ATOMIC);
+            if (!slots)
+                return NULL;
+
+            rcu_assign_pointer(head->slots, slots);
+        }
+
+        rcu_assign_pointer(slots->data[rflt->slot], data);
+    }
+
+    list_add_tail(&data->list, &head->list); 
+    redirfs_get_data(data);
+
+    return redirfs_get_data(data);
+}
+
+/* the object's lock is held */
+static struct redirfs_data *rfs_data_head_detach(struct rfs_data_head *head,
+        struct rfs_flt *rflt)
+{
+    struct rfs_data_slots *slots;
+    struct redirfs_data *data;
+
+    data = rfs_find_data(&head->list, rflt);
+    if (!data)
+        return NULL;
+
+    list_del(&data->list);
+
+    slots = rcu_dereference_protected(head->slots, 1);
+    if (slots && rflt->slot >= 0)
+        RCU_INIT_POINTER(slots->data[rflt->slot], NULL);
+
+    return data;
+}
+
 struct redirfs_data *redirfs_attach_data_file(redirfs_filter filter,
         struct file *file, struct redirfs_data *data)
 {
@@ -115,16 +220,10 @@ struct redirfs_data *redirfs_attach_data_file(redirfs_filter filter,
     spin_lock(&rfile->rdentry->lock);
     spin_lock(&rfile->lock);
 
-    if (rfs_chain_find(rfile->rdentry->rinfo->rchain, filter) == -1)
-        goto exit;
-
-    rv = rfs_find_data(&rfile->data, filter);
-    if (rv)
+    if (rfs_info_find_flt(rfile->rdentry->rinfo, filter) == -1)
         goto exit;
 
-    list_add_tail(&data->list, &rfile->data); 
-    redirfs_get_data(data);
-    rv = redirfs_get_data(data);
+    rv = rfs_data_head_attach(&rfile->data, filter, data);
 exit:
     spin_unlock(&rfile->lock);
     spin_unlock(&rfile->rdentry->lock);
@@ -146,12 +245,9 @@ struct redirfs_data *redirfs_detach_data_file(redirfs_filter filter,
         return NULL;
 
     spin_lock(&rfile->lock);
-
-    data = rfs_find_data(&rfile->data, filter);
-    if (data)
-        list_del(&data->list);
-
+    data = rfs_data_head_detach(&rfile->data, filter);
     spin_unlock(&rfile->lock);
+
     redirfs_put_data(data);
     rfs_file_put(rfile);
     return data;
@@ -170,11 +266,8 @@ struct redirfs_data *redirfs_get_data_file(redirfs_filter filter,
     if (!rfile)
         return NULL;
 
-    spin_lock(&rfile->lock);
-
-    data = rfs_find_data(&rfile->data, filter);
+    data = rfs_data_head_get(&rfile->data, &rfile->lock, filter);
 
-    spin_unlock(&rfile->lock);
     rfs_file_put(rfile);
     return data;
 }
@@ -194,16 +287,10 @@ struct redirfs_data *redirfs_attach_data_dentry(redirfs_filter filter,
 
     spin_lock(&rdentry->lock);
 
-    if (rfs_chain_find(rdentry->rinfo->rchain, filter) == -1)
+    if (rfs_info_find_flt(rdentry->rinfo, filter) == -1)
         goto exit;
 
-    rv = rfs_find_data(&rdentry->data, filter);
-    if (rv)
-        goto exit;
-
-    list_add_tail(&data->list, &rdentry->data); 
-    redirfs_get_data(data);
-    rv = redirfs_get_data(data);
+    rv = rfs_data_head_attach(&rdentry->data, filter, data);
 exit:
     spin_unlock(&rdentry->lock);
     rfs_dentry_put(rdentry);
@@ -224,12 +311,9 @@ struct redirfs_data *redirfs_detach_data_dentry(redirfs_filter filter,
         return NULL;
 
     spin_lock(&rdentry->lock);
-
-    data = rfs_find_data(&rdentry->data, filter);
-    if (data)
-        list_del(&data->list);
-
+    data = rfs_data_head_detach(&rdentry->data, filter);
     spin_unlock(&rdentry->lock);
+
     redirfs_put_data(data);
     rfs_dentry_put(rdentry);
     return data;
@@ -248,11 +332,8 @@ struct redirfs_data *redirfs_get_data_dentry(redirfs_filter filter,
     if (!rdentry)
         return NULL;
 
-    spin_lock(&rdentry->lock);
-
-    data = rfs_find_data(&rdentry->data, filter);
+    data = rfs_data_head_get(&rdentry->data, &rdentry->lock, filter);
 
-    spin_unlock(&rdentry->lock);
     rfs_dentry_put(rdentry);
     return data;
 }
@@ -272,16 +353,10 @@ struct redirfs_data *redirfs_attach_data_inode(redirfs_filter filter,
 
     spin_lock(&rinode->lock);
 
-    if (rfs_chain_find(rinode->rinfo->rchain, filter) == -1)
-        goto exit;
-
-    rv = rfs_find_data(&rinode->data, filter);
-    if (rv)
+    if (rfs_info_find_flt(rinode->rinfo, filter) == -1)
         goto exit;
 
-    list_add_tail(&data->list, &rinode->data); 
-    redirfs_get_data(data);
-    rv = redirfs_get_data(data);
+    rv = rfs_data_head_attach(&rinode->data, filter, data);
 exit:
     spin_unlock(&rinode->lock);
     rfs_inode_put(rinode);
@@ -302,12 +377,9 @@ struct redirfs_data *redirfs_detach_data_inode(redirfs_filter filter,
         return NULL;
 
     spin_lock(&rinode->lock);
-
-    data = rfs_find_data(&rinode->data, filter);
-    if (data)
-        list_del(&data->list);
-
+    data = rfs_data_head_detach(&rinode->data, filter);
     spin_unlock(&rinode->lock);
+
     redirfs_put_data(data);
     rfs_inode_put(rinode);
     return data;
@@ -326,11 +398,8 @@ struct redirfs_data *redirfs_get_data_inode(redirfs_filter filter,
     if (!rinode)
         return NULL;
 
-    spin_lock(&rinode->lock);
-
-    data = rfs_find_data(&rinode->data, filter);
+    data = rfs_data_head_get(&rinode->data, &rinode->lock, filter);
 
-    spin_unlock(&rinode->lock);
     rfs_inode_put(rinode);
     return data;
 }
@@ -338,13 +407,23 @@ struct redirfs_data *redirfs_get_data_inode(redirfs_filter filter,
 void rfs_context_init(struct rfs_context *rcont, int start)
 {
     INIT_LIST_HEAD(&rcont->data);
+    rcont->rinode = NULL;
+    rcont->rdentry = NULL;
+    rcont->rfile = NULL;
     rcont->idx_start = start;
     rcont->idx = 0;
+    rcont->rcbs = NULL;
+    rcont->lat_start = 0;
 }
 
 void rfs_context_deinit(struct rfs_context *rcont)
 {
     rfs_data_remove(&rcont->data);
+#ifdef RFS_INFO_SRCU
+    if (rcont->rcbs)
+        srcu_read_unlock(&rfs_info_srcu, rcont->rcbs_idx);
+#endif
+    rcont->rcbs = NULL;
 }
 
 struct redirfs_data *redirfs_attach_data_context(redirfs_filter filter,
@@ -418,13 +497,7 @@ struct redirfs_data *redirfs_attach_data_root(redirfs_filter filter,
     if (!found)
         goto exit;
 
-    rv = rfs_find_data(&rroot->data, filter);
-    if (rv)
-        goto exit;
-
-    list_add_tail(&data->list, &rroot->data); 
-    redirfs_get_data(data);
-    rv = redirfs_get_data(data);
+    rv = rfs_data_head_attach(&rroot->data, filter, data);
 exit:
     spin_unlock(&rroot->lock);
     return rv;
@@ -440,12 +513,9 @@ struct redirfs_data *redirfs_detach_data_root(redirfs_filter filter,
         return NULL;
 
     spin_lock(&rroot->lock);
-
-    data = rfs_find_data(&rroot->data, filter);
-    if (data)
-        list_del(&data->list);
-
+    data = rfs_data_head_detach(&rroot->data, filter);
     spin_unlock(&rroot->lock);
+
     redirfs_put_data(data);
 
     return data;
@@ -455,18 +525,67 @@ struct redirfs_data *redirfs_get_data_root(redirfs_filter filter,
         redirfs_root root)
 {
     struct rfs_root *rroot = (struct rfs_root *)root;
-    struct redirfs_data *data;
 
     if (!filter || IS_ERR(filter) || !root)
         return NULL;
 
-    spin_lock(&rroot->lock);
+    return rfs_data_head_get(&rroot->data, &rroot->lock, filter);
+}
+
+/*
+ * the objects resolved by the hook are used if they belong to the passed
+ * kernel object, otherwise the data are looked up as by redirfs_get_data_*
+ */
+struct redirfs_data *redirfs_ctx_get_data_file(redirfs_context context,
+        redirfs_filter filter, struct file *file)
+{
+    struct rfs_context *rcont = (struct rfs_context *)context;
+    struct rfs_file *rfile;
 
-    data = rfs_find_data(&rroot->data, filter);
+    if (!filter || IS_ERR(filter) || !context || !file)
+        return NULL;
 
-    spin_unlock(&rroot->lock);
+    rfile = rcont->rfile;
+    if (!rfile || rfile->file != file)
+        return redirfs_get_data_file(filter, file);
 
-    return data;
+    return rfs_data_head_get(&rfile->data, &rfile->lock, filter);
+}
+
+struct redirfs_data *redirfs_ctx_get_data_dentry(redirfs_context context,
+        redirfs_filter filter, struct dentry *dentry)
+{
+    struct rfs_context *rcont = (struct rfs_context *)context;
+    struct rfs_dentry *rdentry;
+
+    if (!filter || IS_ERR(filter) || !context || !dentry)
+        return NULL;
+
+    /* the file holds a reference to its rdentry */
+    rdentry = rcont->rdentry;
+    if (!rdentry && rcont->rfile)
+        rdentry = rcont->rfile->rdentry;
+
+    if (!rdentry || rdentry->dentry != dentry)
+        return redirfs_get_data_dentry(filter, dentry);
+
+    return rfs_data_head_get(&rdentry->data, &rdentry->lock, filter);
+}
+
+struct redirfs_data *redirfs_ctx_get_data_inode(redirfs_context context,
+        redirfs_filter filter, struct inode *inode)
+{
+    struct rfs_context *rcont = (struct rfs_context *)context;
+    struct rfs_inode *rinode;
+
+    if (!filter || IS_ERR(filter) || !context || !inode)
+        return NULL;
+
+    rinode = rcont->rinode;
+    if (!rinode || rinode->inode != inode)
+        return redirfs_get_data_inode(filter, inode);
+
+    return rfs_data_head_get(&rinode->data, &rinode->lock, filter);
 }
 
 EXPORT_SYMBOL(redirfs_init_data);
@@ -487,6 +606,9 @@ EXPORT_SYMBOL(redirfs_get_data_context);
 EXPORT_SYMBOL(redirfs_attach_data_root);
 EXPORT_SYMBOL(redirfs_detach_data_root);
 EXPORT_SYMBOL(redirfs_get_data_root);
+EXPORT_SYMBOL(redirfs_ctx_get_data_file);
+EXPORT_SYMBOL(redirfs_ctx_get_data_dentry);
+EXPORT_SYMBOL(redirfs_ctx_get_data_inode);
 
 #ifdef RFS_DBG
     #pragma GCC pop_options
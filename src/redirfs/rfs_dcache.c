@@ -81,6 +81,7 @@ static void rfs_dcache_entry_free(struct rfs_dcache_entry *entry)
         return;
 
     list_del_init(&entry->list);
+    dput(entry->cursor);
     dput(entry->dentry);
     kfree(entry);
 }
@@ -158,141 +159,430 @@ void rfs_dcache_entry_free_list(struct list_head *head)
     }
 }
 
-static int rfs_dcache_get_subs_mutex(struct dentry *dir, struct list_head *sibs)
+/*
+ * locks the directory against changes of its children list, returns false
+ * if the directory was left locked by a rename, see rfs_rename_start
+ */
+static bool rfs_dcache_dir_lock(struct dentry *dir)
 {
-    int rv = 0;
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(3,1,0)) 
     // DEBUG_CENTOS_7_FILE_MOVE_LOCK   
     extern bool rfs_rename_start;
-    bool rename_file = false;
-#endif
-
-    if (!dir || !dir->d_inode)
-        return 0;
-
-#if (LINUX_VERSION_CODE > KERNEL_VERSION(3,1,0)) 
-    // DEBUG_CENTOS_7_FILE_MOVE_LOCK
 
     if(rfs_rename_start) {
         // rename system call only
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(4,0,0)) 
-        if (mutex_is_locked(&dir->d_inode->i_mutex)) {
-            rename_file = true;
-            //printk("rename file. ignore lock\n");
-        } else {
-            //printk("rename dir. lock now\n");
-            rfs_inode_mutex_lock(dir->d_inode);
-        }
+        if (mutex_is_locked(&dir->d_inode->i_mutex))
+            return false;
 #else
-        if (inode_is_locked(dir->d_inode)) {
-            rename_file = true;
-            //printk("rename file. ignore lock\n");
-        } else {
-            //printk("rename dir. lock now\n");
-            rfs_inode_mutex_lock(dir->d_inode);
-        }
+        if (inode_is_locked(dir->d_inode))
+            return false;
 #endif
-
-    } else {
-        rfs_inode_mutex_lock(dir->d_inode);
     }
-#else
-    rfs_inode_mutex_lock(dir->d_inode);
 #endif
-   
-    rv = rfs_dcache_get_subs(dir, sibs, NULL);
 
-#if (LINUX_VERSION_CODE > KERNEL_VERSION(3,1,0)) 
-    // DEBUG_CENTOS_7_FILE_MOVE_LOCK
-    if(rfs_rename_start) {
-        if(!rename_file) {
-            //printk("unlock dir\n");
-            rfs_inode_mutex_unlock(dir->d_inode);
-        } else {
-            // unlock will be upper-layer
-        }
-    } else {
+    rfs_inode_mutex_lock(dir->d_inode);
+    return true;
+}
+
+static void rfs_dcache_dir_unlock(struct dentry *dir, bool locked)
+{
+    /* otherwise the unlock is done by the upper layer */
+    if (locked)
         rfs_inode_mutex_unlock(dir->d_inode);
-    }
-#else
-    rfs_inode_mutex_unlock(dir->d_inode);
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * The walk engine, the directories are taken from a shared list by up to
+ * walk->workers_max workers, the caller is the first one and the others
+ * are started on rfs_dcache_walk_wq as the list grows. The children of a
+ * directory are read in batches of RFS_DCACHE_WALK_BATCH after a cursor,
+ * so a worker needs a constant memory for any directory size and the dir
+ * lock is not held while the callbacks are called. If the cursor was moved
+ * to another directory meanwhile, the directory is read again from its
+ * start, the callbacks have to be idempotent.
+ *
+ * A worker descends into a subdirectory as soon as it reads one and puts
+ * the rest of the directory, i.e. the directory with the subdirectory as
+ * its cursor, on the head of the list for any worker. The list holds only
+ * ancestors of the directories being walked, so the pending memory is
+ * bounded by the tree depth times the workers, not by the number of the
+ * subdirectories.
+ */
+
+#define RFS_DCACHE_WALK_BATCH 64
+#define RFS_DCACHE_WALK_WORKERS 8
+
+struct rfs_dcache_walk {
+    int (*cb)(struct dentry *, void *);
+    void *data;
+    spinlock_t lock;
+    struct list_head dirs; /* rfs_dcache_entry, lock */
+    int workers; /* lock */
+    int workers_max;
+    int rv; /* the first error, lock */
+    struct completion done;
+};
+
+struct rfs_dcache_walker {
+    struct rfs_dcache_walk *walk;
+    struct work_struct work;
+    struct dentry *batch[RFS_DCACHE_WALK_BATCH];
+};
+
+static struct rfs_dcache_walk_stat {
+    atomic_t walks;
+    atomic_t workers;
+    atomic_long_t dirs;
+    atomic_long_t dentries;
+    atomic_long_t pending;
+} rfs_dcache_walk_stat;
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,36))
+static struct workqueue_struct *rfs_dcache_walk_wq;
 #endif
 
-    return rv;
-}
+static void rfs_dcache_walk_spawn(struct rfs_dcache_walk *walk);
 
-static int rfs_dcache_get_dirs(struct list_head *dirs, struct list_head *sibs)
+/*
+ * reads up to max children after the cursor under the dir's d_lock only,
+ * the cursor is the last returned child and it is referenced by the batch,
+ * the directory is read from its start if the cursor was moved away
+ */
+static int rfs_dcache_get_batch(struct dentry *dir, struct dentry *cursor,
+        struct dentry **batch, int max)
 {
-    struct rfs_dcache_entry *entry;
-    struct rfs_dcache_entry *dir;
-    struct rfs_dcache_entry *tmp;
+    struct dentry *dentry;
+    int nr = 0;
 
-    list_for_each_entry_safe(entry, tmp, sibs, list) {
-        if (!entry->dentry->d_inode)
-            continue;
+    rfs_dcache_lock(dir);
 
-        if (!S_ISDIR(entry->dentry->d_inode->i_mode))
-            continue;
+    if (!cursor || cursor->d_parent != dir)
+        dentry = rfs_d_child_entry(&dir->d_subdirs);
+    else
+        dentry = cursor;
 
-        dir = rfs_dcache_entry_alloc(entry->dentry, dirs);
-        if (IS_ERR(dir))
-            return PTR_ERR(dir);
+    rfs_for_each_d_child_continue(dentry, &dir->d_subdirs) {
+        rfs_dcache_lock_nested(dentry);
+        batch[nr++] = rfs_dget_locked(dentry);
+        rfs_dcache_unlock_nested(dentry);
 
-        rfs_dcache_entry_free(entry);
+        if (nr == max)
+            break;
     }
 
-    return 0;
+    rfs_dcache_unlock(dir);
+
+    return nr;
 }
 
-int rfs_dcache_walk(struct dentry *root, int (*cb)(struct dentry *, void *),
-        void *data)
+static int rfs_dcache_walk_get_batch(struct rfs_dcache_walker *walker,
+        struct dentry *dir, struct dentry *cursor)
+{
+    bool locked;
+    int nr;
+
+    locked = rfs_dcache_dir_lock(dir);
+    nr = rfs_dcache_get_batch(dir, cursor, walker->batch,
+            RFS_DCACHE_WALK_BATCH);
+    rfs_dcache_dir_unlock(dir, locked);
+
+    return nr;
+}
+
+static int rfs_dcache_walk_queue_dir(struct rfs_dcache_walk *walk,
+        struct dentry *dentry, struct dentry *cursor)
 {
     LIST_HEAD(dirs);
-    LIST_HEAD(sibs);
     struct rfs_dcache_entry *dir;
-    struct rfs_dcache_entry *sib;
-    int rv = 0;
 
-    dir = rfs_dcache_entry_alloc(root, &dirs);
+    dir = rfs_dcache_entry_alloc(dentry, &dirs);
     if (IS_ERR(dir))
         return PTR_ERR(dir);
 
-    while (!list_empty(&dirs)) {
-        dir = list_entry(dirs.next, struct rfs_dcache_entry, list);
+    dir->cursor = dget(cursor);
 
-        rv = cb(dir->dentry, data);
-        if (rv < 0)
-            goto exit;
+    /* the deepest continuation is taken first */
+    spin_lock(&walk->lock);
+    list_splice(&dirs, &walk->dirs);
+    spin_unlock(&walk->lock);
 
-        if (rv > 0 || !dir->dentry->d_inode) {
-            rfs_dcache_entry_free(dir);
-            rv = 0;
-            continue;
+    atomic_long_inc(&rfs_dcache_walk_stat.pending);
+    return 0;
+}
+
+/*
+ * walks the directory after the cursor, or from its start calling the
+ * callback for it first if there is no cursor, and then the subdirectories
+ * it descends into
+ */
+static int rfs_dcache_walk_dir(struct rfs_dcache_walker *walker,
+        struct dentry *dir, struct dentry *cursor)
+{
+    struct rfs_dcache_walk *walk = walker->walk;
+    struct dentry *subdir;
+    struct dentry *dentry;
+    int nr;
+    int i, k;
+    int rv = 0;
+
+    dir = dget(dir);
+    cursor = dget(cursor);
+
+    for (;;) {
+        if (!cursor) {
+            rv = walk->cb(dir, walk->data);
+            if (rv < 0)
+                break;
+
+            atomic_long_inc(&rfs_dcache_walk_stat.dirs);
+
+            if (rv > 0 || !dir->d_inode) {
+                rv = 0;
+                break;
+            }
         }
 
-        rv = rfs_dcache_get_subs_mutex(dir->dentry, &sibs);
-        if (rv)
-            goto exit;
+        subdir = NULL;
+        while (!subdir &&
+               (nr = rfs_dcache_walk_get_batch(walker, dir, cursor))) {
+            for (i = 0; i < nr && rv >= 0 && !subdir; i++) {
+                dentry = walker->batch[i];
 
-        rv = rfs_dcache_get_dirs(&dirs, &sibs);
-        if (rv)
-            goto exit;
+                if (dentry->d_inode && S_ISDIR(dentry->d_inode->i_mode))
+                    subdir = dget(dentry);
+                else
+                    rv = walk->cb(dentry, walk->data);
+            }
+
+            /* the next batch is read after the last handled child */
+            dput(cursor);
+            cursor = dget(walker->batch[i - 1]);
+
+            for (k = 0; k < nr; k++)
+                dput(walker->batch[k]);
 
-        list_for_each_entry(sib, &sibs, list) {
-            rv = cb(sib->dentry, data);
             if (rv < 0)
-                goto exit;
+                break;
+
+            rv = 0;
+            atomic_long_add(i, &rfs_dcache_walk_stat.dentries);
+            cond_resched();
+        }
+
+        if (rv < 0 || !subdir)
+            break;
+
+        rv = rfs_dcache_walk_queue_dir(walk, dir, cursor);
+        if (rv < 0) {
+            dput(subdir);
+            break;
         }
-        rfs_dcache_entry_free_list(&sibs);
+        rfs_dcache_walk_spawn(walk);
+
+        dput(cursor);
+        cursor = NULL;
+        dput(dir);
+        dir = subdir;
+    }
+
+    dput(cursor);
+    dput(dir);
+    return rv;
+}
+
+static void rfs_dcache_walk_run(struct rfs_dcache_walker *walker)
+{
+    struct rfs_dcache_walk *walk = walker->walk;
+    struct rfs_dcache_entry *dir;
+    bool done;
+    int rv;
+
+    atomic_inc(&rfs_dcache_walk_stat.workers);
+
+    spin_lock(&walk->lock);
+    while (!walk->rv && !list_empty(&walk->dirs)) {
+        dir = list_entry(walk->dirs.next, struct rfs_dcache_entry, list);
+        list_del_init(&dir->list);
+        spin_unlock(&walk->lock);
+
+        atomic_long_dec(&rfs_dcache_walk_stat.pending);
+        rv = rfs_dcache_walk_dir(walker, dir->dentry, dir->cursor);
+        rfs_dcache_entry_free(dir);
+
+        spin_lock(&walk->lock);
+        if (rv && !walk->rv)
+            walk->rv = rv;
+    }
+    done = !--walk->workers;
+    spin_unlock(&walk->lock);
+
+    atomic_dec(&rfs_dcache_walk_stat.workers);
+
+    if (done)
+        complete(&walk->done);
+}
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,36))
+
+static void rfs_dcache_walk_work(struct work_struct *work)
+{
+    struct rfs_dcache_walker *walker;
+
+    walker = container_of(work, struct rfs_dcache_walker, work);
+    rfs_dcache_walk_run(walker);
+    kfree(walker);
+}
+
+/*
+ * starts another worker if there are directories waiting, otherwise the
+ * running workers take them
+ */
+static void rfs_dcache_walk_spawn(struct rfs_dcache_walk *walk)
+{
+    struct rfs_dcache_walker *walker;
+
+    spin_lock(&walk->lock);
+    if (walk->rv || walk->workers >= walk->workers_max ||
+        list_empty(&walk->dirs)) {
+        spin_unlock(&walk->lock);
+        return;
+    }
+    walk->workers++;
+    spin_unlock(&walk->lock);
+
+    walker = kzalloc(sizeof(struct rfs_dcache_walker), GFP_KERNEL);
+    if (!walker) {
+        spin_lock(&walk->lock);
+        walk->workers--;
+        spin_unlock(&walk->lock);
+        return;
+    }
+
+    walker->walk = walk;
+    INIT_WORK(&walker->work, rfs_dcache_walk_work);
+    queue_work(rfs_dcache_walk_wq, &walker->work);
+}
+
+int rfs_dcache_walk_init(void)
+{
+    rfs_dcache_walk_wq = alloc_workqueue("rfs_dcache_walk", WQ_UNBOUND,
+            RFS_DCACHE_WALK_WORKERS);
+    if (!rfs_dcache_walk_wq)
+        return -ENOMEM;
+
+    return 0;
+}
+
+void rfs_dcache_walk_exit(void)
+{
+    destroy_workqueue(rfs_dcache_walk_wq);
+}
+
+#else /* LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,36) */
+
+static void rfs_dcache_walk_spawn(struct rfs_dcache_walk *walk)
+{
+}
+
+int rfs_dcache_walk_init(void)
+{
+    return 0;
+}
+
+void rfs_dcache_walk_exit(void)
+{
+}
+
+#endif /* LINUX_VERSION_CODE < KERNEL_VERSION(2,6,36) */
+
+static int rfs_dcache_walk_workers(struct dentry *root,
+        int (*cb)(struct dentry *, void *), void *data, int workers_max)
+{
+    struct rfs_dcache_walk walk;
+    struct rfs_dcache_walker *walker;
+    struct rfs_dcache_entry *dir;
+    struct rfs_dcache_entry *tmp;
+    int rv;
+
+    DBG_BUG_ON(!rfs_preemptible());
+
+    walker = kzalloc(sizeof(struct rfs_dcache_walker), GFP_KERNEL);
+    if (!walker)
+        return -ENOMEM;
+
+    walk.cb = cb;
+    walk.data = data;
+    spin_lock_init(&walk.lock);
+    INIT_LIST_HEAD(&walk.dirs);
+    walk.workers = 1;
+    walk.workers_max = workers_max;
+    walk.rv = 0;
+    init_completion(&walk.done);
+    walker->walk = &walk;
+
+    atomic_inc(&rfs_dcache_walk_stat.walks);
+
+    rv = rfs_dcache_walk_queue_dir(&walk, root, NULL);
+    if (rv)
+        goto exit;
+
+    /* the caller is the first worker */
+    rfs_dcache_walk_run(walker);
+    wait_for_completion(&walk.done);
+    rv = walk.rv;
+
+    /* left after an error */
+    list_for_each_entry_safe(dir, tmp, &walk.dirs, list) {
         rfs_dcache_entry_free(dir);
+        atomic_long_dec(&rfs_dcache_walk_stat.pending);
     }
 exit:
-    list_splice(&sibs, &dirs);
-    rfs_dcache_entry_free_list(&dirs);
+    atomic_dec(&rfs_dcache_walk_stat.walks);
+    kfree(walker);
 
     return rv;
 }
 
+/*
+ * the callback is called for the root and for each cached dentry below it
+ * in the caller's context, a directory is descended into if the callback
+ * returns 0 for it, a negative value stops the walk
+ */
+int rfs_dcache_walk(struct dentry *root, int (*cb)(struct dentry *, void *),
+        void *data)
+{
+    return rfs_dcache_walk_workers(root, cb, data, 1);
+}
+
+/*
+ * as rfs_dcache_walk but the callback is called from several workers at
+ * once, so it has to be safe against itself
+ */
+int rfs_dcache_walk_parallel(struct dentry *root,
+        int (*cb)(struct dentry *, void *), void *data)
+{
+    return rfs_dcache_walk_workers(root, cb, data,
+            min_t(int, num_online_cpus(), RFS_DCACHE_WALK_WORKERS));
+}
+
+ssize_t rfs_dcache_walk_show(char *buf, ssize_t size)
+{
+    return snprintf(buf, size,
+            "walks = %d\n"
+            "workers = %d\n"
+            "dirs = %ld\n"
+            "dentries = %ld\n"
+            "pending = %ld\n",
+            atomic_read(&rfs_dcache_walk_stat.walks),
+            atomic_read(&rfs_dcache_walk_stat.workers),
+            atomic_long_read(&rfs_dcache_walk_stat.dirs),
+            atomic_long_read(&rfs_dcache_walk_stat.dentries),
+            atomic_long_read(&rfs_dcache_walk_stat.pending));
+}
+
 static int rfs_dcache_skip(struct dentry *dentry, struct rfs_dcache_data *rdata)
 {
     struct rfs_dentry *rdentry = NULL;
@@ -345,6 +635,20 @@ exit:
     return rv;
 }
 
+/*
+ * a lookup miss is attached only if a filter hooks negative dentries, the
+ * create, mknod, mkdir, symlink, link and atomic_open hooks of the parent
+ * attach the dentry when it becomes positive
+ */
+int rfs_dcache_rdentry_add_lookup(struct dentry *dentry, struct rfs_info *rinfo)
+{
+    if (!dentry->d_inode &&
+        !(rinfo->rops && rinfo->rops->flags & RFS_OPS_DNONE))
+        return 0;
+
+    return rfs_dcache_rdentry_add(dentry, rinfo);
+}
+
 int rfs_dcache_rinode_del(struct rfs_dentry *rdentry, struct inode *inode)
 {
     struct rfs_inode *rinode = NULL;
@@ -411,6 +715,202 @@ int rfs_dcache_add(struct dentry *dentry, void *data)
     return rfs_dcache_rdentry_add(dentry, rdata->rinfo);
 }
 
+static void rfs_dcache_set_expand(struct dentry *dentry)
+{
+    struct rfs_inode *rinode;
+
+    if (!dentry->d_inode || !S_ISDIR(dentry->d_inode->i_mode))
+        return;
+
+    rinode = rfs_inode_find(dentry->d_inode);
+    if (!rinode)
+        return;
+
+    /* permission is hooked until the children are attached */
+    smp_mb(); /* the new rinfo is seen by rfs_dcache_expand clearing the bit */
+    set_bit(RFS_INODE_EXPAND, &rinode->flags);
+    rfs_inode_set_ops(rinode);
+    rfs_inode_put(rinode);
+}
+
+/*
+ * updates only the attached dentries and does not descend to directories
+ * which are not attached, those are attached by rfs_dcache_expand
+ */
+int rfs_dcache_add_lazy(struct dentry *dentry, void *data)
+{
+    struct rfs_dcache_data *rdata = data;
+    struct rfs_dentry *rdentry;
+    int rv;
+
+    if (rfs_dcache_skip(dentry, rdata)) {
+        rfs_root_add_walk(dentry);
+        return 1;
+    }
+
+    if (dentry != rdata->droot) {
+        rdentry = rfs_dentry_find(dentry);
+        if (!rdentry)
+            return 1;
+
+        rfs_dentry_put(rdentry);
+    }
+
+    rv = rfs_dcache_rdentry_add(dentry, rdata->rinfo);
+    if (rv)
+        return rv;
+
+    rfs_dcache_set_expand(dentry);
+    return 0;
+}
+
+/* the whole cached subtree is attached unless the root is lazily attached */
+int rfs_dcache_walk_add(struct rfs_dcache_data *rdata)
+{
+    struct rfs_root *rroot = rdata->rinfo->rroot;
+    int rv;
+
+    if (!rroot || !(rroot->flags & RFS_ROOT_LAZY))
+        return rfs_dcache_walk_parallel(rdata->droot, rfs_dcache_add, rdata);
+
+    rv = rfs_dcache_walk_parallel(rdata->droot, rfs_dcache_add_lazy, rdata);
+    if (!rv)
+        rfs_root_add_walk_subroots(rdata->droot);
+
+    return rv;
+}
+
+int rfs_dcache_add_dir_lazy(struct dentry *dentry)
+{
+    int rv;
+
+    rv = rfs_dcache_add_dir(dentry, NULL);
+    if (rv)
+        return rv;
+
+    rfs_dcache_set_expand(dentry);
+    return 0;
+}
+
+static int rfs_dcache_attach(struct dentry *dentry, struct rfs_info *rinfo)
+{
+    struct rfs_dentry *rdentry;
+    struct rfs_info *rinfo_old;
+    bool attached = false;
+    bool keep;
+    int rv;
+
+    /*
+     * nested roots and dentries attached by lookup with the same rinfo are
+     * already set, the others were attached by an expansion before the
+     * directory's rinfo changed
+     */
+    rdentry = rfs_dentry_find(dentry);
+    if (rdentry) {
+        rinfo_old = rfs_dentry_get_rinfo(rdentry);
+        keep = rinfo_old == rinfo || (rinfo_old && rinfo_old->rroot &&
+                rinfo_old->rroot->dentry == dentry);
+        rfs_info_put(rinfo_old);
+        rfs_dentry_put(rdentry);
+        if (keep)
+            return 0;
+        attached = true;
+    }
+
+    if (attached)
+        rv = rfs_dcache_rdentry_add(dentry, rinfo);
+    else if (rinfo == rfs_info_none)
+        return rfs_dcache_add_dir_lazy(dentry);
+    else
+        rv = rfs_dcache_rdentry_add_lookup(dentry, rinfo);
+    if (rv)
+        return rv;
+
+    rfs_dcache_set_expand(dentry);
+    return 0;
+}
+
+/* children attached by rfs_dcache_expand between the reads of d_subdirs */
+#define RFS_DCACHE_EXPAND_BATCH 16
+
+/*
+ * attaches the cached children of a lazily attached directory with the
+ * directory's rinfo, the children directories are marked to do the same
+ * when they are accessed. It is called from permission so the directory's
+ * i_mutex might be held and it is not taken here. The children are read in
+ * batches after a cursor and attached without holding the directory's
+ * rinode mutex, so the memory is bounded for any directory size and the
+ * children's rinode mutexes never nest in the parent's. Concurrent callers
+ * attach the same children, rfs_dcache_attach skips the up to date ones.
+ */
+int rfs_dcache_expand(struct rfs_inode *rinode)
+{
+    struct dentry *batch[RFS_DCACHE_EXPAND_BATCH];
+    struct dentry *cursor = NULL;
+    struct rfs_dentry *rdentry = NULL;
+    struct rfs_info *rinfo = NULL;
+    struct rfs_info *rinfo_now;
+    struct dentry *dir;
+    int nr;
+    int i;
+    int rv = 0;
+
+    DBG_BUG_ON(!rfs_preemptible());
+
+    if (!test_bit(RFS_INODE_EXPAND, &rinode->flags))
+        return 0;
+
+    dir = d_find_alias(rinode->inode);
+    if (!dir)
+        return 0;
+
+    rdentry = rfs_dentry_find(dir);
+    if (!rdentry)
+        goto exit;
+
+    rinfo = rfs_dentry_get_rinfo(rdentry);
+    if (!rinfo)
+        goto exit;
+
+    while ((nr = rfs_dcache_get_batch(dir, cursor, batch,
+                    RFS_DCACHE_EXPAND_BATCH))) {
+        dput(cursor);
+        cursor = dget(batch[nr - 1]);
+
+        for (i = 0; i < nr; i++) {
+            if (!rv)
+                rv = rfs_dcache_attach(batch[i], rinfo);
+            dput(batch[i]);
+        }
+
+        if (rv)
+            goto exit;
+
+        cond_resched();
+    }
+
+    /*
+     * if the directory was attached again meanwhile its children are
+     * expanded again, pairs with the barrier in rfs_dcache_set_expand
+     */
+    clear_bit(RFS_INODE_EXPAND, &rinode->flags);
+    smp_mb();
+    rinfo_now = rfs_dentry_get_rinfo(rdentry);
+    if (rinfo_now != rinfo)
+        set_bit(RFS_INODE_EXPAND, &rinode->flags);
+    rfs_info_put(rinfo_now);
+exit:
+    dput(cursor);
+    rfs_info_put(rinfo);
+    rfs_dentry_put(rdentry);
+    dput(dir);
+
+    if (!rv && !test_bit(RFS_INODE_EXPAND, &rinode->flags))
+        rfs_inode_set_ops(rinode);
+
+    return rv;
+}
+
 int rfs_dcache_rem(struct dentry *dentry, void *data)
 {
     struct rfs_dcache_data *rdata = data;
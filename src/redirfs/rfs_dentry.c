@@ -44,12 +44,24 @@ static void rfs_dentry_free(struct rfs_object *robject);
 
 static struct rfs_object_type rfs_dentry_type = {
     .type = RFS_TYPE_RDENTRY,
+    .size = sizeof(struct rfs_dentry),
     .free = rfs_dentry_free,
 };
 
 /*---------------------------------------------------------------------------*/
 
-struct rfs_radix_tree   rfs_dentry_radix_tree = {
+#ifdef RFS_USE_HASHTABLE
+
+static struct rfs_object_table rfs_dentry_object_table = {
+    .rfs_type = RFS_TYPE_RDENTRY,
+    };
+
+static struct rfs_object_table *const rfs_dentry_table =
+    &rfs_dentry_object_table;
+
+#else /* RFS_USE_HASHTABLE */
+
+static struct rfs_radix_tree rfs_dentry_radix_tree = {
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(4,0,0)) 
     .root = RADIX_TREE_INIT(GFP_ATOMIC),
 #else
@@ -59,6 +71,10 @@ struct rfs_radix_tree   rfs_dentry_radix_tree = {
     .rfs_type = RFS_TYPE_RDENTRY,
     };
 
+static struct rfs_radix_tree *const rfs_dentry_table = &rfs_dentry_radix_tree;
+
+#endif /* !RFS_USE_HASHTABLE */
+
 /*---------------------------------------------------------------------------*/
 
 #ifdef RFS_PER_OBJECT_OPS
@@ -79,7 +95,27 @@ struct rfs_dentry* rfs_dentry_find(const struct dentry *dentry)
         return rdentry;
 #endif /* RFS_PER_OBJECT_OPS */
 
-    robject = rfs_get_object_by_system_object(&rfs_dentry_radix_tree, dentry);
+    robject = rfs_get_object_by_system_object(rfs_dentry_table, dentry);
+    if (!robject)
+        return NULL;
+
+    rdentry = container_of(robject, struct rfs_dentry, robject);
+    DBG_BUG_ON(RFS_DENTRY_SIGNATURE != rdentry->signature);
+    return rdentry;
+}
+
+/* no reference is taken, the rdentry is valid until rcu_read_unlock */
+struct rfs_dentry* rfs_dentry_find_rcu(const struct dentry *dentry)
+{
+    struct rfs_dentry  *rdentry;
+    struct rfs_object  *robject;
+
+#ifdef RFS_PER_OBJECT_OPS
+    if (dentry->d_op && dentry->d_op->d_iput == rfs_d_iput)
+        return container_of(dentry->d_op, struct rfs_dentry, op_new);
+#endif /* RFS_PER_OBJECT_OPS */
+
+    robject = rfs_find_object_by_system_object_rcu(rfs_dentry_table, dentry);
     if (!robject)
         return NULL;
 
@@ -108,7 +144,7 @@ static struct rfs_dentry *rfs_dentry_alloc(struct dentry *dentry)
 
     INIT_LIST_HEAD(&rdentry->rinode_list);
     INIT_LIST_HEAD(&rdentry->rfiles);
-    INIT_LIST_HEAD(&rdentry->data);
+    rfs_data_head_init(&rdentry->data);
     rdentry->dentry = dentry;
     rdentry->op_old = dentry->d_op;
     spin_lock_init(&rdentry->lock);
@@ -173,7 +209,7 @@ static void rfs_dentry_free(struct rfs_object *robject)
     rfs_inode_put(rdentry->rinode);
     rfs_info_put(rdentry->rinfo);
 
-    rfs_data_remove(&rdentry->data);
+    rfs_data_head_remove(&rdentry->data);
     
 #ifndef RFS_PER_OBJECT_OPS
         if (rdentry->d_rhops)
@@ -245,7 +281,7 @@ struct rfs_dentry *rfs_dentry_add(struct dentry *dentry, struct rfs_info *rinfo)
 #ifndef RFS_PER_OBJECT_OPS
     DBG_BUG_ON(!rd_new->d_rhops);
 #endif
-    rd_new->rinfo = rfs_info_get(rinfo);
+    rd_new->rinfo = rfs_info_get(rfs_info_base(rinfo));
 #ifdef RFS_PER_OBJECT_OPS
     dentry->d_op = &rd_new->op_new;
 #endif /* RFS_PER_OBJECT_OPS */
@@ -256,7 +292,7 @@ struct rfs_dentry *rfs_dentry_add(struct dentry *dentry, struct rfs_info *rinfo)
     rfs_keep_operations(rd_new->d_rhops);
 #endif /* !RFS_PER_OBJECT_OPS */
 
-    err = rfs_insert_object(&rfs_dentry_radix_tree,
+    err = rfs_insert_object(rfs_dentry_table,
                             &rd_new->robject,
                             false);
     DBG_BUG_ON(err);
@@ -346,7 +382,8 @@ void rfs_dentry_set_rinfo(struct rfs_dentry *rdentry, struct rfs_info *rinfo)
     spin_lock(&rdentry->lock);
     {
         rinfo_old = rdentry->rinfo;
-        rdentry->rinfo = rfs_info_get(rinfo);
+        rcu_assign_pointer(rdentry->rinfo,
+                rfs_info_get(rfs_info_base(rinfo)));
     }
     spin_unlock(&rdentry->lock);
 
@@ -380,17 +417,24 @@ void rfs_dentry_rem_rfile(struct rfs_file *rfile)
 
 int rfs_dentry_cache_create(void)
 {
+    int rv = 0;
+
     rfs_dentry_cache = rfs_kmem_cache_create("rfs_dentry_cache",
             sizeof(struct rfs_dentry));
 
     if (!rfs_dentry_cache)
         return -ENOMEM;
 
-    return 0;
+    rv = rfs_object_table_init(rfs_dentry_table);
+    if (rv)
+        kmem_cache_destroy(rfs_dentry_cache);
+
+    return rv;
 }
 
 void rfs_dentry_cache_destory(void)
 {
+    rfs_object_table_destroy(rfs_dentry_table);
     kmem_cache_destroy(rfs_dentry_cache);
 }
 
@@ -398,6 +442,7 @@ void rfs_d_iput(struct dentry *dentry, struct inode *inode)
 {
     struct rfs_dentry *rdentry;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
@@ -409,8 +454,9 @@ void rfs_d_iput(struct dentry *dentry, struct inode *inode)
         iput(inode);
         return;
     }
-    rinfo = rfs_dentry_get_rinfo(rdentry);
+    rinfo = rfs_dentry_read_rinfo(rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rdentry = rdentry;
 
     if (S_ISREG(inode->i_mode))
         rargs.type.id = REDIRFS_REG_DOP_D_IPUT;
@@ -447,13 +493,14 @@ void rfs_d_iput(struct dentry *dentry, struct inode *inode)
     rfs_context_deinit(&rcont);
 
     rfs_dentry_put(rdentry);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
 }
 
 static void rfs_d_release(struct dentry *dentry)
 {
     struct rfs_dentry *rdentry;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
@@ -462,8 +509,9 @@ static void rfs_d_release(struct dentry *dentry)
         rfs_pr_debug("dentry=%p", dentry);
         return;
     }
-    rinfo = rfs_dentry_get_rinfo(rdentry);
+    rinfo = rfs_dentry_read_rinfo(rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rdentry = rdentry;
     rargs.type.id = REDIRFS_NONE_DOP_D_RELEASE;
     rargs.args.d_release.dentry = dentry;
 
@@ -480,7 +528,7 @@ static void rfs_d_release(struct dentry *dentry)
 
     rfs_dentry_del(rdentry);
     rfs_dentry_put(rdentry);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     rfs_pr_debug("dentry=%p", dentry);
 }
 
@@ -502,12 +550,14 @@ static int rfs_d_compare(struct dentry *dentry, struct qstr *name1,
 {
     struct rfs_dentry *rdentry;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
     rdentry = rfs_dentry_find(dentry);
-    rinfo = rfs_dentry_get_rinfo(rdentry);
+    rinfo = rfs_dentry_read_rinfo(rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rdentry = rdentry;
 
     if (dentry->d_inode) {
         if (S_ISREG(dentry->d_inode->i_mode))
@@ -551,7 +601,7 @@ static int rfs_d_compare(struct dentry *dentry, struct qstr *name1,
     rfs_context_deinit(&rcont);
 
     rfs_dentry_put(rdentry);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
 
     return rargs.rv.rv_int;
 }
@@ -565,12 +615,18 @@ static int rfs_d_compare(const struct dentry *parent, const struct inode *inode,
 {
     struct rfs_dentry *rdentry;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
-    rdentry = rfs_dentry_find(dentry);
-    rinfo = rfs_dentry_get_rinfo(rdentry);
+    /* d_compare is always called under rcu_read_lock, no reference needed */
+    rdentry = rfs_dentry_find_rcu(dentry);
+    if (unlikely(!rdentry))
+        return rfs_d_compare_default(&dentry->d_name, name);
+
+    rinfo = rfs_dentry_read_rinfo(rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rdentry = rdentry;
 
     if (dentry->d_inode) {
         if (S_ISREG(dentry->d_inode->i_mode))
@@ -621,8 +677,7 @@ static int rfs_d_compare(const struct dentry *parent, const struct inode *inode,
 
     rfs_context_deinit(&rcont);
 
-    rfs_dentry_put(rdentry);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
 
     return rargs.rv.rv_int;
 }
@@ -635,12 +690,18 @@ static int rfs_d_compare(const struct dentry *parent,
 {
     struct rfs_dentry *rdentry;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
-    rdentry = rfs_dentry_find(dentry);
-    rinfo = rfs_dentry_get_rinfo(rdentry);
+    /* d_compare is always called under rcu_read_lock, no reference needed */
+    rdentry = rfs_dentry_find_rcu(dentry);
+    if (unlikely(!rdentry))
+        return rfs_d_compare_default(&dentry->d_name, name);
+
+    rinfo = rfs_dentry_read_rinfo(rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rdentry = rdentry;
 
     if (dentry->d_inode) {
         if (S_ISREG(dentry->d_inode->i_mode))
@@ -687,8 +748,7 @@ static int rfs_d_compare(const struct dentry *parent,
 
     rfs_context_deinit(&rcont);
 
-    rfs_dentry_put(rdentry);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
 
     return rargs.rv.rv_int;
 
@@ -701,12 +761,18 @@ static int rfs_d_compare(const struct dentry *dentry,
 {
     struct rfs_dentry *rdentry;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
-    rdentry = rfs_dentry_find(dentry);
-    rinfo = rfs_dentry_get_rinfo(rdentry);
+    /* d_compare is always called under rcu_read_lock, no reference needed */
+    rdentry = rfs_dentry_find_rcu(dentry);
+    if (unlikely(!rdentry))
+        return rfs_d_compare_default(&dentry->d_name, name);
+
+    rinfo = rfs_dentry_read_rinfo(rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rdentry = rdentry;
 
     if (dentry->d_inode) {
         if (S_ISREG(dentry->d_inode->i_mode))
@@ -751,8 +817,7 @@ static int rfs_d_compare(const struct dentry *dentry,
 
     rfs_context_deinit(&rcont);
 
-    rfs_dentry_put(rdentry);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
 
     return rargs.rv.rv_int;
 }
@@ -765,12 +830,14 @@ static int rfs_d_revalidate(struct dentry *dentry, struct nameidata *nd)
 {
     struct rfs_dentry *rdentry;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
     rdentry = rfs_dentry_find(dentry);
-    rinfo = rfs_dentry_get_rinfo(rdentry);
+    rinfo = rfs_dentry_read_rinfo(rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rdentry = rdentry;
 
     if (dentry->d_inode) {
         if (S_ISREG(dentry->d_inode->i_mode))
@@ -808,7 +875,7 @@ static int rfs_d_revalidate(struct dentry *dentry, struct nameidata *nd)
     rfs_context_deinit(&rcont);
 
     rfs_dentry_put(rdentry);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
 
     return rargs.rv.rv_int;
 }
@@ -819,12 +886,22 @@ static int rfs_d_revalidate(struct dentry *dentry, unsigned int flags)
 {
     struct rfs_dentry *rdentry;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
+    bool rcu_walk = flags & LOOKUP_RCU;
 
-    rdentry = rfs_dentry_find(dentry);
-    rinfo = rfs_dentry_get_rinfo(rdentry);
+    /* RCU path walk holds rcu_read_lock, the rdentry is not referenced */
+    if (rcu_walk) {
+        rdentry = rfs_dentry_find_rcu(dentry);
+        if (!rdentry)
+            return -ECHILD;
+    } else
+        rdentry = rfs_dentry_find(dentry);
+
+    rinfo = rfs_dentry_read_rinfo(rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rdentry = rdentry;
 
     if (dentry->d_inode) {
         if (S_ISREG(dentry->d_inode->i_mode))
@@ -848,6 +925,12 @@ static int rfs_d_revalidate(struct dentry *dentry, unsigned int flags)
     rargs.args.d_revalidate.flags = flags;
     rargs.rv.rv_int = 1;
 
+    if (rcu_walk && RFS_IS_DOP_SET(rdentry, rargs.type.id) &&
+        rfs_chain_may_block(rinfo->rchain, &rcont, rargs.type.id)) {
+        rargs.rv.rv_int = -ECHILD;
+        goto exit;
+    }
+
     if (!RFS_IS_DOP_SET(rdentry, rargs.type.id) ||
         !rfs_precall_flts(rinfo->rchain, &rcont, &rargs)) {
         if (rdentry->op_old && rdentry->op_old->d_revalidate)
@@ -859,10 +942,12 @@ static int rfs_d_revalidate(struct dentry *dentry, unsigned int flags)
     if (RFS_IS_DOP_SET(rdentry, rargs.type.id))
         rfs_postcall_flts(rinfo->rchain, &rcont, &rargs);
 
+exit:
     rfs_context_deinit(&rcont);
 
-    rfs_dentry_put(rdentry);
-    rfs_info_put(rinfo);
+    if (!rcu_walk)
+        rfs_dentry_put(rdentry);
+    rfs_info_read_done(rinfo, rinfo_idx);
 
     return rargs.rv.rv_int;
 }
@@ -43,6 +43,7 @@ static void rfs_file_free(struct rfs_object *robject);
 
 static struct rfs_object_type rfs_file_type = {
     .type = RFS_TYPE_RFILE,
+    .size = sizeof(struct rfs_file),
     .free = rfs_file_free,
     };
 
@@ -50,26 +51,16 @@ static struct rfs_object_type rfs_file_type = {
 
 #ifdef RFS_USE_HASHTABLE
 
-#define OBJ_TABLE_SIZE 257
-
-static struct rfs_object_table_entry  file_entries[OBJ_TABLE_SIZE];
-
-unsigned long rfs_file_index(unsigned long file)
-{
-    return ((((unsigned long)file) >> 5) % ARRAY_SIZE(file_entries));
-}
-
-/* common table not divided by object types, i.e. hosts any object */
-static struct rfs_object_table rfs_file_table = {
-    .index = rfs_file_index,
+static struct rfs_object_table rfs_file_object_table = {
     .rfs_type = RFS_TYPE_RFILE,
-    .array_size = ARRAY_SIZE(file_entries),
-    .array = file_entries,
     };
 
+static struct rfs_object_table *const rfs_file_table =
+    &rfs_file_object_table;
+
 #else /* RFS_USE_HASHTABLE */
 
-struct rfs_radix_tree   rfs_file_radix_tree = {
+static struct rfs_radix_tree rfs_file_radix_tree = {
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(4,0,0)) 
     .root = RADIX_TREE_INIT(GFP_ATOMIC),
 #else
@@ -79,6 +70,8 @@ struct rfs_radix_tree   rfs_file_radix_tree = {
     .rfs_type = RFS_TYPE_RFILE,
     };
 
+static struct rfs_radix_tree *const rfs_file_table = &rfs_file_radix_tree;
+
 #endif /* !RFS_USE_HASHTABLE */
 
 /*---------------------------------------------------------------------------*/
@@ -105,11 +98,7 @@ struct rfs_file* rfs_file_find(struct file *file)
         return rfile;
 #endif /* RFS_PER_OBJECT_OPS */
 
-#ifdef RFS_USE_HASHTABLE
-    robject = rfs_get_object_by_system_object(&rfs_file_table, file);
-#else
-    robject = rfs_get_object_by_system_object(&rfs_file_radix_tree, file);
-#endif
+    robject = rfs_get_object_by_system_object(rfs_file_table, file);
     if (!robject)
         return NULL;
 
@@ -162,6 +151,8 @@ struct rfs_file* rfs_file_find_with_open_flts(struct file *file)
     file->f_op = fops_get(rinode->f_op_old);
 
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
+    rcont.rdentry = rdentry;
 
     if (S_ISREG(file->f_inode->i_mode))
         rargs.type.id = REDIRFS_REG_FOP_OPEN;
@@ -218,7 +209,7 @@ static struct rfs_file *rfs_file_alloc(struct file *file)
 #endif // RFS_DBG
 
     INIT_LIST_HEAD(&rfile->rdentry_list);
-    INIT_LIST_HEAD(&rfile->data);
+    rfs_data_head_init(&rfile->data);
     rfile->file = file;
     spin_lock_init(&rfile->lock);
 
@@ -295,7 +286,7 @@ static void rfs_file_free(struct rfs_object *robject)
     
     fops_put(rfile->op_old);
 
-    rfs_data_remove(&rfile->data);
+    rfs_data_head_remove(&rfile->data);
 
 #ifndef RFS_PER_OBJECT_OPS
     if (rfile->f_rhops)
@@ -339,11 +330,7 @@ struct rfs_file *rfs_file_add(struct file *file)
 #ifndef RFS_PER_OBJECT_OPS
     rfs_keep_operations(rfile->f_rhops);
 #endif /* RFS_PER_OBJECT_OPS */
-#ifdef RFS_USE_HASHTABLE
-    err = rfs_insert_object(&rfs_file_table, &rfile->robject, false);
-#else
-    err = rfs_insert_object(&rfs_file_radix_tree, &rfile->robject, false);
-#endif
+    err = rfs_insert_object(rfs_file_table, &rfile->robject, false);
     DBG_BUG_ON(err);
     if (unlikely(err)) {
         rfs_file_del(rfile);
@@ -376,23 +363,26 @@ static void rfs_file_del(struct rfs_file *rfile)
 
 int rfs_file_cache_create(void)
 {
+    int rv = 0;
+
     rfs_file_cache = rfs_kmem_cache_create("rfs_file_cache",
             sizeof(struct rfs_file));
 
     if (!rfs_file_cache)
         return -ENOMEM;
 
-#ifdef RFS_USE_HASHTABLE
-    rfs_object_table_init(&rfs_file_table);
-#endif
+    rv = rfs_object_table_init(rfs_file_table);
+    if (rv)
+        kmem_cache_destroy(rfs_file_cache);
 
-    return 0;
+    return rv;
 }
 
 /*---------------------------------------------------------------------------*/
 
 void rfs_file_cache_destory(void)
 {
+    rfs_object_table_destroy(rfs_file_table);
     kmem_cache_destroy(rfs_file_cache);
 }
 
@@ -404,6 +394,7 @@ int rfs_open(struct inode *inode, struct file *file)
     struct rfs_dentry *rdentry;
     struct rfs_inode *rinode;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
@@ -420,9 +411,10 @@ int rfs_open(struct inode *inode, struct file *file)
         return 0;
     }
 
-    rinfo = rfs_dentry_get_rinfo(rdentry);
-    rfs_dentry_put(rdentry);
+    rinfo = rfs_dentry_read_rinfo(rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
+    rcont.rdentry = rdentry;
 
     if (S_ISREG(inode->i_mode))
         rargs.type.id = REDIRFS_REG_FOP_OPEN;
@@ -464,8 +456,9 @@ int rfs_open(struct inode *inode, struct file *file)
     
     rfs_context_deinit(&rcont);
 
+    rfs_dentry_put(rdentry);
     rfs_inode_put(rinode);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     rfs_pr_debug("inode=%p, ret=%d", inode, rargs.rv.rv_int);
     return rargs.rv.rv_int;
 }
@@ -476,14 +469,16 @@ int rfs_release(struct inode *inode, struct file *file)
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
     rfile = rfs_file_find_with_open_flts(file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     if (S_ISREG(inode->i_mode))
         rargs.type.id = REDIRFS_REG_FOP_RELEASE;
@@ -521,7 +516,7 @@ int rfs_release(struct inode *inode, struct file *file)
     if (!rargs.rv.rv_int)
         rfs_file_del(rfile);
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     rfs_pr_debug("inode=%p, ret=%d", inode, rargs.rv.rv_int);
     return rargs.rv.rv_int;
 }
@@ -578,6 +573,7 @@ int rfs_readdir(struct file *file, void *dirent, filldir_t filldir)
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
     struct dentry *d_first = NULL;
@@ -589,8 +585,9 @@ int rfs_readdir(struct file *file, void *dirent, filldir_t filldir)
         /* this optimization was borrowed from
        the Kaspersky's version of rfs filter */
     d_first = rfs_get_first_cached_dir_entry(file->f_dentry);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
     rargs.rv.rv_int = -ENOTDIR;
 
     if (S_ISDIR(file->f_dentry->d_inode->i_mode)) {
@@ -624,7 +621,7 @@ int rfs_readdir(struct file *file, void *dirent, filldir_t filldir)
 exit:
     dput(d_first);
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 #endif
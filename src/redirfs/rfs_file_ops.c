@@ -18,7 +18,10 @@
  * along with RedirFS. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <linux/hash.h>
+#include <linux/workqueue.h>
 #include "rfs.h"
+#include "rfs_file_ops.h"
 
 #ifdef RFS_DBG
     #pragma GCC push_options
@@ -31,14 +34,21 @@ loff_t rfs_llseek(struct file *file, loff_t offset, int origin)
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(file, llseek, rfs_llseek);
+    if (fop_old && fop_old->llseek)
+        return fop_old->llseek(file, offset, origin);
+
     rfile = rfs_file_find_with_open_flts(file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_llseek);
     rargs.args.f_llseek.file = file;
@@ -61,7 +71,7 @@ loff_t rfs_llseek(struct file *file, loff_t offset, int origin)
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_loff;
 }
 
@@ -71,14 +81,21 @@ ssize_t rfs_read(struct file *file, char __user *buf, size_t count, loff_t *pos)
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(file, read, rfs_read);
+    if (fop_old && fop_old->read)
+        return fop_old->read(file, buf, count, pos);
+
     rfile = rfs_file_find_with_open_flts(file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_read);
     rargs.args.f_read.file = file;
@@ -103,7 +120,7 @@ ssize_t rfs_read(struct file *file, char __user *buf, size_t count, loff_t *pos)
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_ssize;
 }
 
@@ -113,14 +130,21 @@ ssize_t rfs_write(struct file *file, const char __user *buf, size_t count, loff_
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(file, write, rfs_write);
+    if (fop_old && fop_old->write)
+        return fop_old->write(file, buf, count, pos);
+
     rfile = rfs_file_find_with_open_flts(file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_write);
     rargs.args.f_write.file = file;
@@ -145,25 +169,297 @@ ssize_t rfs_write(struct file *file, const char __user *buf, size_t count, loff_
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_ssize;
 }
 
 /*---------------------------------------------------------------------------*/
 
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4,1,0)) && defined(RFS_INFO_SRCU)
+#define RFS_ASYNC_IOCB
+#endif
+
+#ifdef RFS_ASYNC_IOCB
+
+/*
+ * an asynchronous kiocb completes after read_iter or write_iter returned
+ * -EIOCBQUEUED, ki_complete is interposed so the post callbacks see the
+ * final result, the context, the file, the chain and the callbacks vector
+ * are kept in rfs_iocb until then, referenced, so an I/O which takes long
+ * does not hold the SRCU read side and the releases of all infos
+ */
+struct rfs_iocb {
+    struct hlist_node node;
+    struct kiocb *kiocb;
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(5,16,0))
+    void (*ki_complete)(struct kiocb *kiocb, long res, long res2);
+    long res2;
+#else
+    void (*ki_complete)(struct kiocb *kiocb, long res);
+#endif
+    long res;
+    struct rfs_file *rfile;
+    struct rfs_chain *rchain;
+    struct rfs_context rcont;
+    struct redirfs_args rargs;
+    /* a callback for the operation might sleep */
+    bool may_block;
+    struct work_struct work;
+};
+
+#define RFS_IOCB_HASH_BITS 8
+
+/*
+ * the kiocbs in flight hashed by their addresses, each bucket has its own
+ * lock so I/O submitted and completed on different CPUs does not contend
+ */
+static struct rfs_iocb_bucket {
+    spinlock_t lock;
+    struct hlist_head head;
+} ____cacheline_aligned_in_smp rfs_iocb_hash[1 << RFS_IOCB_HASH_BITS] = {
+    [0 ... (1 << RFS_IOCB_HASH_BITS) - 1] = {
+        .lock = __SPIN_LOCK_UNLOCKED(rfs_iocb_hash.lock),
+    },
+};
+
+/* asynchronous kiocbs whose post callbacks were called on the return */
+static atomic_long_t rfs_iocb_fallbacks = ATOMIC_LONG_INIT(0);
+
+long rfs_iocb_fallback_nr(void)
+{
+    return atomic_long_read(&rfs_iocb_fallbacks);
+}
+
+/* queued kiocbs, each pins its chain and through it the chain's filters */
+static atomic_t rfs_iocb_nr = ATOMIC_INIT(0);
+static DECLARE_WAIT_QUEUE_HEAD(rfs_iocb_wait);
+
+void rfs_iocb_drain(void)
+{
+    wait_event(rfs_iocb_wait, !atomic_read(&rfs_iocb_nr));
+}
+
+static inline struct rfs_iocb_bucket *rfs_iocb_bucket(struct kiocb *kiocb)
+{
+    return &rfs_iocb_hash[hash_ptr(kiocb, RFS_IOCB_HASH_BITS)];
+}
+
+static struct rfs_iocb *rfs_iocb_unhash(struct kiocb *kiocb)
+{
+    struct rfs_iocb_bucket *bucket = rfs_iocb_bucket(kiocb);
+    struct rfs_iocb *riocb;
+    unsigned long flags;
+
+    spin_lock_irqsave(&bucket->lock, flags);
+    hlist_for_each_entry(riocb, &bucket->head, node) {
+        if (riocb->kiocb == kiocb) {
+            hlist_del(&riocb->node);
+            kiocb->ki_complete = riocb->ki_complete;
+            spin_unlock_irqrestore(&bucket->lock, flags);
+            return riocb;
+        }
+    }
+    spin_unlock_irqrestore(&bucket->lock, flags);
+
+    return NULL;
+}
+
+static long rfs_iocb_postcall(struct rfs_iocb *riocb, long res)
+{
+    riocb->rargs.rv.rv_ssize = res;
+    rfs_postcall_flts(riocb->rchain, &riocb->rcont, &riocb->rargs);
+    res = riocb->rargs.rv.rv_ssize;
+
+    rfs_data_remove(&riocb->rcont.data);
+    rfs_chain_cbs_put(riocb->rcont.rcbs);
+    rfs_chain_put(riocb->rchain);
+    rfs_file_put(riocb->rfile);
+    kfree(riocb);
+
+    if (atomic_dec_and_test(&rfs_iocb_nr))
+        wake_up(&rfs_iocb_wait);
+
+    return res;
+}
+
+static void rfs_iocb_finish(struct rfs_iocb *riocb)
+{
+    struct kiocb *kiocb = riocb->kiocb;
+    long res;
+
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(5,16,0))
+    void (*ki_complete)(struct kiocb *, long, long) = riocb->ki_complete;
+    long res2 = riocb->res2;
+
+    res = rfs_iocb_postcall(riocb, riocb->res);
+    ki_complete(kiocb, res, res2);
+#else
+    void (*ki_complete)(struct kiocb *, long) = riocb->ki_complete;
+
+    res = rfs_iocb_postcall(riocb, riocb->res);
+    ki_complete(kiocb, res);
+#endif
+}
+
+static void rfs_iocb_work(struct work_struct *work)
+{
+    rfs_iocb_finish(container_of(work, struct rfs_iocb, work));
+}
+
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(5,16,0))
+static void rfs_iocb_complete(struct kiocb *kiocb, long res, long res2)
+#else
+static void rfs_iocb_complete(struct kiocb *kiocb, long res)
+#endif
+{
+    struct rfs_iocb *riocb;
+
+    riocb = rfs_iocb_unhash(kiocb);
+    BUG_ON(!riocb);
+
+    riocb->res = res;
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(5,16,0))
+    riocb->res2 = res2;
+#endif
+
+    /*
+     * the I/O is often completed from an interrupt or under a lock, only
+     * the callbacks flagged REDIRFS_OP_NONBLOCK are called in place and
+     * only with the interrupts enabled
+     */
+    if (riocb->may_block || in_interrupt() || irqs_disabled()) {
+        INIT_WORK(&riocb->work, rfs_iocb_work);
+        schedule_work(&riocb->work);
+        return;
+    }
+
+    rfs_iocb_finish(riocb);
+}
+
+/*
+ * returns NULL if the post callbacks can be called when the original
+ * operation returns, i.e. for a synchronous or polled kiocb
+ */
+static struct rfs_iocb *rfs_iocb_prepare(struct kiocb *kiocb,
+        struct rfs_file *rfile, struct rfs_chain *rchain,
+        struct rfs_context *rcont, struct redirfs_args *rargs)
+{
+    struct rfs_iocb_bucket *bucket;
+    struct rfs_iocb *riocb;
+    unsigned long flags;
+
+    if (is_sync_kiocb(kiocb))
+        return NULL;
+
+#ifdef IOCB_HIPRI
+    if (kiocb->ki_flags & IOCB_HIPRI)
+        return NULL;
+#endif
+
+    /* the post callbacks see -EIOCBQUEUED, see f_read_iter in redirfs.h */
+    riocb = kzalloc(sizeof(struct rfs_iocb), GFP_NOFS);
+    if (!riocb) {
+        atomic_long_inc(&rfs_iocb_fallbacks);
+        return NULL;
+    }
+
+    /* the callbacks latched by the pre call were retired meanwhile */
+    if (!rfs_chain_cbs_get(rcont->rcbs)) {
+        kfree(riocb);
+        atomic_long_inc(&rfs_iocb_fallbacks);
+        return NULL;
+    }
+
+    atomic_inc(&rfs_iocb_nr);
+    riocb->kiocb = kiocb;
+    riocb->ki_complete = kiocb->ki_complete;
+    riocb->rfile = rfs_file_get(rfile);
+    riocb->rchain = rfs_chain_get(rchain);
+    riocb->may_block = rfs_chain_may_block(rchain, rcont, rargs->type.id);
+    riocb->rargs = *rargs;
+    /* f_read_iter and f_write_iter have the same layout */
+    riocb->rargs.args.f_read_iter.iov_iter = NULL;
+
+    /* the data attached by the pre callbacks are moved to riocb */
+    riocb->rcont = *rcont;
+    INIT_LIST_HEAD(&riocb->rcont.data);
+    list_splice_init(&rcont->data, &riocb->rcont.data);
+
+    bucket = rfs_iocb_bucket(kiocb);
+    spin_lock_irqsave(&bucket->lock, flags);
+    hlist_add_head(&riocb->node, &bucket->head);
+    kiocb->ki_complete = rfs_iocb_complete;
+    spin_unlock_irqrestore(&bucket->lock, flags);
+
+    return riocb;
+}
+
+/*
+ * called with the value returned by the original operation, the post
+ * callbacks are called here unless the kiocb was queued
+ */
+static ssize_t rfs_iocb_submitted(struct rfs_iocb *riocb, ssize_t rv)
+{
+    /* riocb might have been completed and released already */
+    if (rv == -EIOCBQUEUED)
+        return rv;
+
+    riocb = rfs_iocb_unhash(riocb->kiocb);
+    BUG_ON(!riocb);
+
+    return rfs_iocb_postcall(riocb, rv);
+}
+
+#else /* RFS_ASYNC_IOCB */
+
+struct rfs_iocb;
+
+long rfs_iocb_fallback_nr(void)
+{
+    return 0;
+}
+
+void rfs_iocb_drain(void)
+{
+}
+
+static inline struct rfs_iocb *rfs_iocb_prepare(struct kiocb *kiocb,
+        struct rfs_file *rfile, struct rfs_chain *rchain,
+        struct rfs_context *rcont, struct redirfs_args *rargs)
+{
+    return NULL;
+}
+
+static inline ssize_t rfs_iocb_submitted(struct rfs_iocb *riocb, ssize_t rv)
+{
+    return rv;
+}
+
+#endif /* !RFS_ASYNC_IOCB */
+
+/*---------------------------------------------------------------------------*/
+
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(3,14,0))
 ssize_t rfs_read_iter(struct kiocb *kiocb, struct iov_iter *iov_iter)
 {
     struct rfs_file *rfile;
+    struct rfs_iocb *riocb = NULL;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(kiocb->ki_filp, read_iter, rfs_read_iter);
+    if (fop_old && fop_old->read_iter)
+        return fop_old->read_iter(kiocb, iov_iter);
+
     rfile = rfs_file_find_with_open_flts(kiocb->ki_filp);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(kiocb->ki_filp->f_inode, RFS_OP_f_read_iter);
     rargs.args.f_read_iter.kiocb = kiocb;
@@ -172,19 +468,26 @@ ssize_t rfs_read_iter(struct kiocb *kiocb, struct iov_iter *iov_iter)
 
     if (!RFS_IS_FOP_SET(rfile, rargs.type.id) ||
         !rfs_precall_flts(rinfo->rchain, &rcont, &rargs)) {
-        if (rfile->op_old && rfile->op_old->read_iter) 
+        if (rfile->op_old && rfile->op_old->read_iter) {
+            if (RFS_IS_FOP_SET(rfile, rargs.type.id))
+                riocb = rfs_iocb_prepare(kiocb, rfile, rinfo->rchain,
+                        &rcont, &rargs);
             rargs.rv.rv_ssize = rfile->op_old->read_iter(
                     rargs.args.f_read_iter.kiocb,
                     rargs.args.f_read_iter.iov_iter);
+            if (riocb)
+                rargs.rv.rv_ssize = rfs_iocb_submitted(riocb,
+                        rargs.rv.rv_ssize);
+        }
     }
 
-    if (RFS_IS_FOP_SET(rfile, rargs.type.id))
+    if (RFS_IS_FOP_SET(rfile, rargs.type.id) && !riocb)
         rfs_postcall_flts(rinfo->rchain, &rcont, &rargs);
         
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_ssize;
 }
 
@@ -193,15 +496,23 @@ ssize_t rfs_read_iter(struct kiocb *kiocb, struct iov_iter *iov_iter)
 ssize_t rfs_write_iter(struct kiocb *kiocb, struct iov_iter *iov_iter)
 {
     struct rfs_file *rfile;
+    struct rfs_iocb *riocb = NULL;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(kiocb->ki_filp, write_iter, rfs_write_iter);
+    if (fop_old && fop_old->write_iter)
+        return fop_old->write_iter(kiocb, iov_iter);
+
     rfile = rfs_file_find_with_open_flts(kiocb->ki_filp);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(kiocb->ki_filp->f_inode, RFS_OP_f_write_iter);
     rargs.args.f_write_iter.kiocb = kiocb;
@@ -210,19 +521,26 @@ ssize_t rfs_write_iter(struct kiocb *kiocb, struct iov_iter *iov_iter)
 
     if (!RFS_IS_FOP_SET(rfile, rargs.type.id) ||
         !rfs_precall_flts(rinfo->rchain, &rcont, &rargs)) {
-        if (rfile->op_old && rfile->op_old->write_iter) 
+        if (rfile->op_old && rfile->op_old->write_iter) {
+            if (RFS_IS_FOP_SET(rfile, rargs.type.id))
+                riocb = rfs_iocb_prepare(kiocb, rfile, rinfo->rchain,
+                        &rcont, &rargs);
             rargs.rv.rv_ssize = rfile->op_old->write_iter(
                     rargs.args.f_write_iter.kiocb,
                     rargs.args.f_write_iter.iov_iter);
+            if (riocb)
+                rargs.rv.rv_ssize = rfs_iocb_submitted(riocb,
+                        rargs.rv.rv_ssize);
+        }
     }
 
-    if (RFS_IS_FOP_SET(rfile, rargs.type.id))
+    if (RFS_IS_FOP_SET(rfile, rargs.type.id) && !riocb)
         rfs_postcall_flts(rinfo->rchain, &rcont, &rargs);
         
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_ssize;
 }
 #endif
@@ -234,6 +552,7 @@ int rfs_iterate(struct file *file, struct dir_context *dir_context)
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
     struct dentry *d_first = NULL;
@@ -246,8 +565,9 @@ int rfs_iterate(struct file *file, struct dir_context *dir_context)
        the Kaspersky's version of rfs filter */
     d_first = rfs_get_first_cached_dir_entry(file->f_dentry);
 
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_iterate);
     BUG_ON(rargs.type.id != REDIRFS_REG_FOP_DIR_ITERATE);
@@ -275,7 +595,7 @@ int rfs_iterate(struct file *file, struct dir_context *dir_context)
 
     dput(d_first);
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 #endif
@@ -286,6 +606,7 @@ int rfs_iterate_shared(struct file *file, struct dir_context *dir_context)
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
     struct dentry *d_first = NULL;
@@ -297,8 +618,9 @@ int rfs_iterate_shared(struct file *file, struct dir_context *dir_context)
        the Kaspersky's version of rfs filter */
     d_first = rfs_get_first_cached_dir_entry(file->f_dentry);
 
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_iterate_shared);
     BUG_ON(rargs.type.id != REDIRFS_REG_FOP_DIR_ITERATE_SHARED);
@@ -325,7 +647,7 @@ int rfs_iterate_shared(struct file *file, struct dir_context *dir_context)
 
     dput(d_first);
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 #endif
@@ -335,14 +657,21 @@ unsigned int rfs_poll(struct file *file, struct poll_table_struct *poll_table_st
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(file, poll, rfs_poll);
+    if (fop_old && fop_old->poll)
+        return fop_old->poll(file, poll_table_struct);
+
     rfile = rfs_file_find_with_open_flts(file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_poll);
     rargs.args.f_poll.file = file;
@@ -363,7 +692,7 @@ unsigned int rfs_poll(struct file *file, struct poll_table_struct *poll_table_st
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 
@@ -373,14 +702,21 @@ long rfs_unlocked_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(file, unlocked_ioctl, rfs_unlocked_ioctl);
+    if (fop_old && fop_old->unlocked_ioctl)
+        return fop_old->unlocked_ioctl(file, cmd, arg);
+
     rfile = rfs_file_find_with_open_flts(file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_unlocked_ioctl);
     rargs.args.f_unlocked_ioctl.file = file;
@@ -403,7 +739,7 @@ long rfs_unlocked_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_long;
 }
 
@@ -413,14 +749,21 @@ long rfs_compat_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(file, compat_ioctl, rfs_compat_ioctl);
+    if (fop_old && fop_old->compat_ioctl)
+        return fop_old->compat_ioctl(file, cmd, arg);
+
     rfile = rfs_file_find_with_open_flts(file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_compat_ioctl);
     rargs.args.f_compat_ioctl.file = file;
@@ -443,7 +786,7 @@ long rfs_compat_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_long;
 }
 
@@ -453,14 +796,21 @@ int rfs_mmap(struct file *file, struct vm_area_struct *vma)
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(file, mmap, rfs_mmap);
+    if (fop_old && fop_old->mmap)
+        return fop_old->mmap(file, vma);
+
     rfile = rfs_file_find_with_open_flts(file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_mmap);
     rargs.args.f_mmap.file = file;
@@ -481,7 +831,7 @@ int rfs_mmap(struct file *file, struct vm_area_struct *vma)
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 
@@ -491,14 +841,21 @@ int rfs_flush(struct file *file, fl_owner_t owner)
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(file, flush, rfs_flush);
+    if (fop_old && fop_old->flush)
+        return fop_old->flush(file, owner);
+
     rfile = rfs_file_find_with_open_flts(file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_flush);
     rargs.args.f_flush.file = file;
@@ -519,7 +876,7 @@ int rfs_flush(struct file *file, fl_owner_t owner)
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 
@@ -529,14 +886,21 @@ int rfs_fsync(struct file *file, struct dentry *dentry, int datasync)
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(file, fsync, rfs_fsync);
+    if (fop_old && fop_old->fsync)
+        return fop_old->fsync(file, dentry, datasync);
+
     rfile = rfs_file_find_with_open_flts(file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_fsync);
 	rargs.args.f_fsync.file = file;
@@ -559,7 +923,7 @@ int rfs_fsync(struct file *file, struct dentry *dentry, int datasync)
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 #elif (LINUX_VERSION_CODE < KERNEL_VERSION(3, 1, 0))
@@ -567,14 +931,21 @@ int rfs_fsync(struct file *file, int datasync)
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(file, fsync, rfs_fsync);
+    if (fop_old && fop_old->fsync)
+        return fop_old->fsync(file, datasync);
+
     rfile = rfs_file_find_with_open_flts(file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_fsync);
     rargs.args.f_fsync.file = file;
@@ -595,7 +966,7 @@ int rfs_fsync(struct file *file, int datasync)
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 #else
@@ -603,14 +974,21 @@ int rfs_fsync(struct file *file, loff_t start, loff_t end, int datasync)
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(file, fsync, rfs_fsync);
+    if (fop_old && fop_old->fsync)
+        return fop_old->fsync(file, start, end, datasync);
+
     rfile = rfs_file_find_with_open_flts(file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_fsync);
     rargs.args.f_fsync.file = file;
@@ -635,7 +1013,7 @@ int rfs_fsync(struct file *file, loff_t start, loff_t end, int datasync)
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 #endif
@@ -646,14 +1024,21 @@ int rfs_fsync(struct file *file, loff_t start, loff_t end, int datasync)
  {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(file, fasync, rfs_fasync);
+    if (fop_old && fop_old->fasync)
+        return fop_old->fasync(fd, file, on);
+
     rfile = rfs_file_find_with_open_flts(file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_fasync);
     rargs.args.f_fasync.file = file;
@@ -676,7 +1061,7 @@ int rfs_fsync(struct file *file, loff_t start, loff_t end, int datasync)
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
  }
 
@@ -686,14 +1071,21 @@ int rfs_fsync(struct file *file, loff_t start, loff_t end, int datasync)
  {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(file, lock, rfs_lock);
+    if (fop_old && fop_old->lock)
+        return fop_old->lock(file, cmd, flock);
+
     rfile = rfs_file_find_with_open_flts(file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_lock);
     rargs.args.f_lock.file = file;
@@ -716,7 +1108,7 @@ int rfs_fsync(struct file *file, loff_t start, loff_t end, int datasync)
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
  }
 
@@ -727,14 +1119,21 @@ ssize_t rfs_sendpage(struct file *file, struct page *page, int offset,
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(file, sendpage, rfs_sendpage);
+    if (fop_old && fop_old->sendpage)
+        return fop_old->sendpage(file, page, offset, len, pos, more);
+
     rfile = rfs_file_find_with_open_flts(file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_sendpage);
     rargs.args.f_sendpage.file = file;
@@ -763,7 +1162,7 @@ ssize_t rfs_sendpage(struct file *file, struct page *page, int offset,
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_ssize;
 }
 
@@ -774,14 +1173,21 @@ unsigned long rfs_get_unmapped_area(struct file *file, unsigned long addr,
  {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(file, get_unmapped_area, rfs_get_unmapped_area);
+    if (fop_old && fop_old->get_unmapped_area)
+        return fop_old->get_unmapped_area(file, addr, len, pgoff, flags);
+
     rfile = rfs_file_find_with_open_flts(file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_get_unmapped_area);
     rargs.args.f_get_unmapped_area.file = file;
@@ -808,7 +1214,7 @@ unsigned long rfs_get_unmapped_area(struct file *file, unsigned long addr,
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_ulong;
  }
 
@@ -818,14 +1224,21 @@ int rfs_flock(struct file *file, int cmd, struct file_lock *flock)
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(file, flock, rfs_flock);
+    if (fop_old && fop_old->flock)
+        return fop_old->flock(file, cmd, flock);
+
     rfile = rfs_file_find_with_open_flts(file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_flock);
     rargs.args.f_flock.file = file;
@@ -848,7 +1261,7 @@ int rfs_flock(struct file *file, int cmd, struct file_lock *flock)
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 
@@ -859,14 +1272,21 @@ ssize_t rfs_splice_write(struct pipe_inode_info *pipe, struct file *out,
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(out, splice_write, rfs_splice_write);
+    if (fop_old && fop_old->splice_write)
+        return fop_old->splice_write(pipe, out, ppos, len, flags);
+
     rfile = rfs_file_find_with_open_flts(out);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(out->f_inode, RFS_OP_f_splice_write);
     rargs.args.f_splice_write.pipe = pipe;
@@ -893,7 +1313,7 @@ ssize_t rfs_splice_write(struct pipe_inode_info *pipe, struct file *out,
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_ssize;
 }
 
@@ -905,14 +1325,21 @@ ssize_t rfs_splice_read(struct file *in, loff_t *ppos,
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(in, splice_read, rfs_splice_read);
+    if (fop_old && fop_old->splice_read)
+        return fop_old->splice_read(in, ppos, pipe, len, flags);
+
     rfile = rfs_file_find_with_open_flts(in);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(in->f_inode, RFS_OP_f_splice_read);
     rargs.args.f_splice_read.in = in;
@@ -939,7 +1366,7 @@ ssize_t rfs_splice_read(struct file *in, loff_t *ppos,
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_ssize;
 }
 
@@ -949,14 +1376,21 @@ int rfs_setlease(struct file *file, long arg, struct file_lock **flock)
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(file, setlease, rfs_setlease);
+    if (fop_old && fop_old->setlease)
+        return fop_old->setlease(file, arg, flock);
+
     rfile = rfs_file_find_with_open_flts(file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_setlease);
     rargs.args.f_setlease.file = file;
@@ -979,7 +1413,7 @@ int rfs_setlease(struct file *file, long arg, struct file_lock **flock)
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 #else
@@ -988,14 +1422,21 @@ int rfs_setlease(struct file *file, long arg, struct file_lock **flock,
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(file, setlease, rfs_setlease);
+    if (fop_old && fop_old->setlease)
+        return fop_old->setlease(file, arg, flock, priv);
+
     rfile = rfs_file_find_with_open_flts(file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_setlease);
     rargs.args.f_setlease.file = file;
@@ -1020,7 +1461,7 @@ int rfs_setlease(struct file *file, long arg, struct file_lock **flock,
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 #endif
@@ -1033,14 +1474,21 @@ long rfs_fallocate(struct file *file, int mode,
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
+    const struct file_operations *fop_old;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
+    fop_old = rfs_file_passthrough(file, fallocate, rfs_fallocate);
+    if (fop_old && fop_old->fallocate)
+        return fop_old->fallocate(file, mode, offset, len);
+
     rfile = rfs_file_find_with_open_flts(file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_fallocate);
     rargs.args.f_fallocate.file = file;
@@ -1065,7 +1513,7 @@ long rfs_fallocate(struct file *file, int mode,
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_long;
 }
 #endif
@@ -1078,14 +1526,16 @@ int rfs_show_fdinfo(struct seq_file *seq_file, struct file *file)
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
     rfile = rfs_file_find_with_open_flts(file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_show_fdinfo);
     rargs.args.f_show_fdinfo.seq_file = seq_file;
@@ -1104,7 +1554,7 @@ int rfs_show_fdinfo(struct seq_file *seq_file, struct file *file)
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 #else
@@ -1112,14 +1562,16 @@ void rfs_show_fdinfo(struct seq_file *seq_file, struct file *file)
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
     rfile = rfs_file_find_with_open_flts(file);
     if (IS_ERR(rfile))
         return;
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file->f_inode, RFS_OP_f_show_fdinfo);
     rargs.args.f_show_fdinfo.seq_file = seq_file;
@@ -1137,7 +1589,7 @@ void rfs_show_fdinfo(struct seq_file *seq_file, struct file *file)
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
 }
 #endif //(LINUX_VERSION_CODE < KERNEL_VERSION(3, 19, 0))
 #endif //(LINUX_VERSION_CODE >= KERNEL_VERSION(3,8,0))
@@ -1151,6 +1603,7 @@ ssize_t rfs_copy_file_range(struct file *file_in, loff_t pos_in,
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
@@ -1159,8 +1612,9 @@ ssize_t rfs_copy_file_range(struct file *file_in, loff_t pos_in,
         rfile = rfs_file_find_with_open_flts(file_out);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(file_in->f_inode, RFS_OP_f_copy_file_range);
     rargs.args.f_copy_file_range.file_in = file_in;
@@ -1189,7 +1643,7 @@ ssize_t rfs_copy_file_range(struct file *file_in, loff_t pos_in,
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_ssize;
 }
 #endif
@@ -1202,6 +1656,7 @@ int rfs_clone_file_range(struct file *src_file, loff_t src_off,
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
@@ -1210,8 +1665,9 @@ int rfs_clone_file_range(struct file *src_file, loff_t src_off,
         rfile = rfs_file_find_with_open_flts(dst_file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(src_file->f_inode, RFS_OP_f_clone_file_range);
     rargs.args.f_clone_file_range.src_file = src_file;
@@ -1241,7 +1697,7 @@ int rfs_clone_file_range(struct file *src_file, loff_t src_off,
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 #endif
@@ -1254,6 +1710,7 @@ ssize_t rfs_dedupe_file_range(struct file *src_file, u64 loff,
 {
     struct rfs_file *rfile;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
@@ -1262,8 +1719,9 @@ ssize_t rfs_dedupe_file_range(struct file *src_file, u64 loff,
         rfile = rfs_file_find_with_open_flts(dst_file);
     if (IS_ERR(rfile))
         return PTR_ERR(rfile);
-    rinfo = rfs_dentry_get_rinfo(rfile->rdentry);
+    rinfo = rfs_dentry_read_rinfo(rfile->rdentry, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rfile = rfile;
 
     rargs.type.id = rfs_inode_to_idc(src_file->f_inode, RFS_OP_f_dedupe_file_range);
     rargs.args.f_dedupe_file_range.src_file = src_file;
@@ -1294,7 +1752,7 @@ ssize_t rfs_dedupe_file_range(struct file *src_file, u64 loff,
     rfs_context_deinit(&rcont);
 
     rfs_file_put(rfile);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_ssize;
 }
 #endif
@@ -22,6 +22,7 @@
 #define _RFS_FILE_OPS_H
 
 #include "rfs.h"
+#include "rfs_hooked_ops.h"
 
 #define FUNCTION_FOP_open PROTOTYPE_FOP(open, rfs_open)
 #define FUNCTION_FOP_release PROTOTYPE_FOP(release, rfs_release)
@@ -289,6 +290,41 @@ ssize_t rfs_dedupe_file_range(struct file *src_file,
 
 int rfs_release(struct inode *inode, struct file *file);
 
+/*
+ * returns the original operations if no filter has a callback for op_id,
+ * the caller can call them directly without looking up the rfs_file, hook
+ * is the hook of the caller which is only found in the shared vectors
+ * made by rfs_create_file_ops, file->f_op is read once as the file might
+ * be switched to the original operations meanwhile. A file opened without
+ * rfs_open gets its open callbacks in the first hook, from
+ * rfs_file_find_with_open_flts, so nothing passes through while a filter
+ * has an open callback for the inode type.
+ */
+static inline const struct file_operations*
+rfs_file_op_old(struct file *file, enum rfs_op_id op_id, size_t op_offset,
+        const void *hook)
+{
+#ifdef RFS_PER_OBJECT_OPS
+    return NULL;
+#else
+    const struct file_operations *f_op;
+
+    if (rfs_op_subscribed(rfs_inode_to_idc(file->f_inode, op_id)) ||
+        rfs_op_subscribed(rfs_inode_to_idc(file->f_inode, RFS_OP_f_open)))
+        return NULL;
+
+    f_op = READ_ONCE(file->f_op);
+    if (!f_op || *(const void **)((const char *)f_op + op_offset) != hook)
+        return NULL;
+
+    return rfs_hooked_file_op_old(f_op);
+#endif
+}
+
+#define rfs_file_passthrough(file, op, hook) \
+    rfs_file_op_old(file, RFS_OP_f_##op, \
+            offsetof(struct file_operations, op), (const void *)hook)
+
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(3,11,0))
 int rfs_readdir(struct file *file, void *dirent, filldir_t filldir);
 #endif
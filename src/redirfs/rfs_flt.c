@@ -34,6 +34,70 @@
 static LIST_HEAD(rfs_flt_list);
 RFS_DEFINE_MUTEX(rfs_flt_list_mutex);
 
+atomic_t rfs_flt_subscribers[RFS_INODE_MAX][RFS_OP_MAX];
+
+/* the data slots of the filters, released in rfs_flt_free */
+static DECLARE_BITMAP(rfs_flt_slots, RFS_DATA_SLOTS);
+
+static int rfs_flt_slot_get(void)
+{
+    int slot;
+
+    do {
+        slot = find_first_zero_bit(rfs_flt_slots, RFS_DATA_SLOTS);
+        if (slot >= RFS_DATA_SLOTS)
+            return -1;
+    } while (test_and_set_bit(slot, rfs_flt_slots));
+
+    return slot;
+}
+
+/*
+ * recalculates rfs_flt_subscribers from the registered filters, a hook
+ * racing with the update can miss a callback the same way it misses
+ * a filter being attached
+ */
+static void rfs_flt_update_subscribers(void)
+{
+    struct rfs_flt *rflt;
+    int it, op_id;
+    int count;
+
+    for (it = 0; it < RFS_INODE_MAX; it++) {
+        for (op_id = 0; op_id < RFS_OP_MAX; op_id++) {
+            count = 0;
+            list_for_each_entry(rflt, &rfs_flt_list, list) {
+                if (!atomic_read(&rflt->active))
+                    continue;
+                if (rflt->cbs[it][op_id].pre_cb ||
+                    rflt->cbs[it][op_id].post_cb)
+                    count++;
+            }
+            atomic_set(&rfs_flt_subscribers[it][op_id], count);
+        }
+    }
+}
+
+static void rfs_flt_free(struct rfs_flt *rflt)
+{
+    if (rflt->slot >= 0)
+        clear_bit(rflt->slot, rfs_flt_slots);
+
+#ifdef RFS_FLT_PERCPU_REF
+    percpu_ref_exit(&rflt->data_ref);
+#endif
+    rfs_lat_flt_free(rflt);
+    kfree(rflt->name);
+    kfree(rflt);
+}
+
+#ifdef RFS_FLT_PERCPU_REF
+static void rfs_flt_data_release(struct percpu_ref *ref)
+{
+    rfs_flt_free(container_of(ref, struct rfs_flt, data_ref));
+}
+#endif
+
 struct rfs_flt *rfs_flt_alloc(struct redirfs_filter_info *flt_info)
 {
     struct rfs_flt *rflt;
@@ -53,11 +117,21 @@ struct rfs_flt *rfs_flt_alloc(struct redirfs_filter_info *flt_info)
         return ERR_PTR(-ENOMEM);
     }
 
+#ifdef RFS_FLT_PERCPU_REF
+    if (percpu_ref_init(&rflt->data_ref, rfs_flt_data_release, 0,
+                GFP_KERNEL)) {
+        kfree(rflt);
+        kfree(name);
+        return ERR_PTR(-ENOMEM);
+    }
+#endif
+
     INIT_LIST_HEAD(&rflt->list);
     rflt->name = name;
     rflt->priority = flt_info->priority;
     rflt->owner = flt_info->owner;
     rflt->ops = flt_info->ops;
+    rflt->slot = rfs_flt_slot_get();
     atomic_set(&rflt->count, 1);
     spin_lock_init(&rflt->lock);
     try_module_get(rflt->owner);
@@ -90,8 +164,37 @@ void rfs_flt_put(struct rfs_flt *rflt)
     if (!atomic_dec_and_test(&rflt->count))
         return;
 
-    kfree(rflt->name);
-    kfree(rflt);
+#ifdef RFS_FLT_PERCPU_REF
+    /* rfs_flt_data_release frees the filter after all data are gone */
+    percpu_ref_kill(&rflt->data_ref);
+#else
+    rfs_flt_free(rflt);
+#endif
+}
+
+struct rfs_flt *rfs_flt_data_get(struct rfs_flt *rflt)
+{
+    if (!rflt || IS_ERR(rflt))
+        return NULL;
+
+#ifdef RFS_FLT_PERCPU_REF
+    percpu_ref_get(&rflt->data_ref);
+    return rflt;
+#else
+    return rfs_flt_get(rflt);
+#endif
+}
+
+void rfs_flt_data_put(struct rfs_flt *rflt)
+{
+    if (!rflt || IS_ERR(rflt))
+        return;
+
+#ifdef RFS_FLT_PERCPU_REF
+    percpu_ref_put(&rflt->data_ref);
+#else
+    rfs_flt_put(rflt);
+#endif
 }
 
 void rfs_flt_release(struct kobject *kobj)
@@ -148,6 +251,7 @@ redirfs_filter redirfs_register_filter(struct redirfs_filter_info *info)
 
     list_add_tail(&rflt->list, &rfs_flt_list);
     rfs_flt_get(rflt);
+    rfs_flt_update_subscribers();
 
     rfs_mutex_unlock(&rfs_flt_list_mutex);
 
@@ -196,6 +300,7 @@ int redirfs_unregister_filter(redirfs_filter filter)
 
     rfs_mutex_lock(&rfs_flt_list_mutex);
     list_del_init(&rflt->list);
+    rfs_flt_update_subscribers();
     rfs_mutex_unlock(&rfs_flt_list_mutex);
 
     module_put(rflt->owner);
@@ -210,8 +315,24 @@ void redirfs_delete_filter(redirfs_filter filter)
     if (!rflt || IS_ERR(rflt))
         return;
 
+    /*
+     * the queued kiocbs and the infos released after a grace period keep
+     * the chains, and so the filter and its callbacks, until they finish
+     */
+    rfs_iocb_drain();
+#ifdef RFS_INFO_SRCU
+    srcu_barrier(&rfs_info_srcu);
+#endif
+
     BUG_ON(atomic_read(&rflt->count) != 2);
 
+    /*
+     * the filter's module is going away, run the data free callbacks
+     * deferred by the released objects and then by the data
+     */
+    rfs_object_free_flush();
+    rcu_barrier();
+
     rfs_flt_sysfs_exit(rflt);
     rfs_flt_put(rflt);
 }
@@ -222,6 +343,8 @@ static int rfs_flt_set_ops(struct rfs_flt *rflt)
     struct rfs_info *rinfo;
     int rv;
 
+    rfs_info_retire_flt(rflt);
+
     list_for_each_entry(rroot, &rfs_root_list, list) {
         if (rfs_chain_find(rroot->rinfo->rchain, rflt) == -1)
             continue;
@@ -236,8 +359,8 @@ static int rfs_flt_set_ops(struct rfs_flt *rflt)
             return rv;
         }
 
-        rfs_info_put(rroot->rinfo);
-        rroot->rinfo = rinfo;
+        rfs_root_set_rinfo(rroot, rinfo);
+        rfs_info_put(rinfo);
     }
 
     return 0;
@@ -246,6 +369,7 @@ static int rfs_flt_set_ops(struct rfs_flt *rflt)
 int redirfs_set_operations(redirfs_filter filter, struct redirfs_op_info ops[])
 {
     struct rfs_flt *rflt = (struct rfs_flt *)filter;
+    struct rfs_op_info (*cbs_old)[RFS_OP_MAX];
     int i = 0;
     int rv = 0;
 
@@ -254,6 +378,11 @@ int redirfs_set_operations(redirfs_filter filter, struct redirfs_op_info ops[])
     if (!rflt || IS_ERR(rflt))
         return -EINVAL;
 
+    /* restored with the subscribers if the chains cannot be recompiled */
+    cbs_old = kmemdup(rflt->cbs, sizeof(rflt->cbs), GFP_KERNEL);
+    if (!cbs_old)
+        return -ENOMEM;
+
     while (ops[i].op_id != REDIRFS_OP_END) {
 
         enum rfs_inode_type  it = RFS_IDC_TO_ITYPE(ops[i].op_id);
@@ -264,9 +393,32 @@ int redirfs_set_operations(redirfs_filter filter, struct redirfs_op_info ops[])
 
         rflt->cbs[it][op_id].pre_cb = ops[i].pre_cb;
         rflt->cbs[it][op_id].post_cb = ops[i].post_cb;
+        rflt->cbs[it][op_id].flags = ops[i].flags;
         i++;
     }
 
+    rfs_mutex_lock(&rfs_flt_list_mutex);
+    rfs_flt_update_subscribers();
+    /* the callbacks are not timed until there are histograms for them */
+    if (rfs_lat_active())
+        rv = rfs_lat_flt_alloc(rflt);
+    rfs_mutex_unlock(&rfs_flt_list_mutex);
+
+    if (!rv)
+        rv = rfs_chain_update_flt(rflt);
+    if (rv) {
+        memcpy(rflt->cbs, cbs_old, sizeof(rflt->cbs));
+        rfs_mutex_lock(&rfs_flt_list_mutex);
+        rfs_flt_update_subscribers();
+        rfs_mutex_unlock(&rfs_flt_list_mutex);
+        /* a chain published meanwhile has compiled the new callbacks */
+        rfs_chain_update_flt(rflt);
+        kfree(cbs_old);
+        return rv;
+    }
+
+    kfree(cbs_old);
+
     rfs_mutex_lock(&rfs_path_mutex);
     rv = rfs_flt_set_ops(rflt);
     rfs_mutex_unlock(&rfs_path_mutex);
@@ -274,6 +426,59 @@ int redirfs_set_operations(redirfs_filter filter, struct redirfs_op_info ops[])
     return rv;
 }
 
+/*
+ * switches the latency collection, the histograms of the registered filters
+ * are allocated before the hooks start to time the calls
+ */
+int rfs_flt_set_lat(bool on)
+{
+    struct rfs_flt *rflt;
+    int rv = 0;
+
+    might_sleep();
+
+    rfs_mutex_lock(&rfs_flt_list_mutex);
+
+    if (on) {
+        list_for_each_entry(rflt, &rfs_flt_list, list) {
+            rv = rfs_lat_flt_alloc(rflt);
+            if (rv)
+                break;
+        }
+    }
+
+    if (!rv)
+        rfs_lat_switch(on);
+
+    rfs_mutex_unlock(&rfs_flt_list_mutex);
+
+    return rv;
+}
+
+static int rfs_flt_set_active(struct rfs_flt *rflt, int active)
+{
+    int active_old;
+    int rv;
+
+    might_sleep();
+
+    active_old = atomic_xchg(&rflt->active, active);
+    if (active_old == active)
+        return 0;
+
+    rv = rfs_chain_update_flt(rflt);
+    if (rv) {
+        atomic_set(&rflt->active, active_old);
+        rfs_chain_update_flt(rflt);
+    }
+
+    rfs_mutex_lock(&rfs_flt_list_mutex);
+    rfs_flt_update_subscribers();
+    rfs_mutex_unlock(&rfs_flt_list_mutex);
+
+    return rv;
+}
+
 int redirfs_activate_filter(redirfs_filter filter)
 {
     struct rfs_flt *rflt = (struct rfs_flt *)filter;
@@ -281,9 +486,7 @@ int redirfs_activate_filter(redirfs_filter filter)
     if (!rflt || IS_ERR(rflt))
         return -EINVAL;
 
-    atomic_set(&rflt->active, 1);
-
-    return 0;
+    return rfs_flt_set_active(rflt, 1);
 }
 
 int redirfs_deactivate_filter(redirfs_filter filter)
@@ -293,9 +496,7 @@ int redirfs_deactivate_filter(redirfs_filter filter)
     if (!rflt || IS_ERR(rflt))
         return -EINVAL;
 
-    atomic_set(&rflt->active, 0);
-
-    return 0;
+    return rfs_flt_set_active(rflt, 0);
 }
 
 EXPORT_SYMBOL(redirfs_register_filter);
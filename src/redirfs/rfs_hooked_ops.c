@@ -28,7 +28,28 @@
 /*---------------------------------------------------------------------------*/
 
 #ifdef RFS_USE_HASHTABLE
-#error "a hash table is not defined"
+static struct rfs_object_table  rfs_f_hoperations_table = {
+    .rfs_type = RFS_TYPE_FILE_OPS,
+};
+
+static struct rfs_object_table  rfs_i_hoperations_table = {
+    .rfs_type = RFS_TYPE_INODE_OPS,
+};
+
+static struct rfs_object_table  rfs_a_hoperations_table = {
+    .rfs_type = RFS_TYPE_AS_OPS,
+};
+
+static struct rfs_object_table  rfs_d_hoperations_table = {
+    .rfs_type = RFS_TYPE_DENTRY_OPS,
+};
+
+struct rfs_object_table*  rfs_hoperations_table[RFS_TYPE_MAX] = {
+    [RFS_TYPE_FILE_OPS]=&rfs_f_hoperations_table,
+    [RFS_TYPE_INODE_OPS]=&rfs_i_hoperations_table,
+    [RFS_TYPE_AS_OPS]=&rfs_a_hoperations_table,
+    [RFS_TYPE_DENTRY_OPS]=&rfs_d_hoperations_table,
+};
 #else
 static struct rfs_radix_tree   rfs_f_hoperations_radix_tree = {
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(4,0,0)) 
@@ -70,7 +91,7 @@ static struct rfs_radix_tree   rfs_d_hoperations_radix_tree = {
     .rfs_type = RFS_TYPE_DENTRY_OPS,
 };
 
-struct rfs_radix_tree*  rfs_hoperations_radix_tree[RFS_TYPE_MAX] = {
+struct rfs_radix_tree*  rfs_hoperations_table[RFS_TYPE_MAX] = {
     [RFS_TYPE_FILE_OPS]=&rfs_f_hoperations_radix_tree,
     [RFS_TYPE_INODE_OPS]=&rfs_i_hoperations_radix_tree,
     [RFS_TYPE_AS_OPS]=&rfs_a_hoperations_radix_tree,
@@ -78,6 +99,42 @@ struct rfs_radix_tree*  rfs_hoperations_radix_tree[RFS_TYPE_MAX] = {
 };
 #endif /* !RFS_USE_HASHTABLE */
 
+int rfs_hoperations_init(void)
+{
+#ifdef RFS_USE_HASHTABLE
+    int type;
+    int err;
+
+    for (type = 0; type < RFS_TYPE_MAX; ++type) {
+        if (!rfs_hoperations_table[type])
+            continue;
+
+        err = rfs_object_table_init(rfs_hoperations_table[type]);
+        if (err) {
+            while (type--) {
+                if (rfs_hoperations_table[type])
+                    rfs_object_table_destroy(rfs_hoperations_table[type]);
+            }
+            return err;
+        }
+    }
+#endif /* RFS_USE_HASHTABLE */
+
+    return 0;
+}
+
+void rfs_hoperations_destroy(void)
+{
+#ifdef RFS_USE_HASHTABLE
+    int type;
+
+    for (type = 0; type < RFS_TYPE_MAX; ++type) {
+        if (rfs_hoperations_table[type])
+            rfs_object_table_destroy(rfs_hoperations_table[type]);
+    }
+#endif /* RFS_USE_HASHTABLE */
+}
+
 /*---------------------------------------------------------------------------*/
 
 /* returns an old flags value */
@@ -105,9 +162,6 @@ rfs_hoperations_set_flags(
 
 /*---------------------------------------------------------------------------*/
 
-#ifdef RFS_USE_HASHTABLE
-#error "rfs_keep_operations is not defined for a hash table"
-#else
 void
 rfs_keep_operations(
     struct rfs_hoperations *rfs_hoperations)
@@ -133,10 +187,10 @@ rfs_keep_operations(
 
     type = rfs_hoperations->robject.type->type;
     DBG_BUG_ON(type == RFS_TYPE_UNKNOWN || type >= RFS_TYPE_MAX);
-    DBG_BUG_ON(!rfs_hoperations_radix_tree[type]);
-    DBG_BUG_ON(rfs_hoperations_radix_tree[type]->rfs_type != type);
+    DBG_BUG_ON(!rfs_hoperations_table[type]);
+    DBG_BUG_ON(rfs_hoperations_table[type]->rfs_type != type);
 
-    err = rfs_insert_object(rfs_hoperations_radix_tree[type],
+    err = rfs_insert_object(rfs_hoperations_table[type],
                             &rfs_hoperations->robject,
                             true);
     DBG_BUG_ON(err && (-EEXIST != err));
@@ -146,7 +200,6 @@ rfs_keep_operations(
                                   RFS_OPS_INSERTED);
     }
 }
-#endif /* !RFS_USE_HASHTABLE */
 
 /*---------------------------------------------------------------------------*/
 
@@ -175,18 +228,19 @@ rfs_unkeep_operations(
 
 /*---------------------------------------------------------------------------*/
 
-#ifdef RFS_USE_HASHTABLE
-#error "rfs_find_operations is not defined for a hash table"
-#else
 struct rfs_hoperations*
 rfs_find_operations(
-    struct rfs_radix_tree *radix_tree,
+#ifdef RFS_USE_HASHTABLE
+    struct rfs_object_table *table,
+#else
+    struct rfs_radix_tree *table,
+#endif
     const void  *old_op)
 {
     struct rfs_object      *robject;
     struct rfs_hoperations *rfs_hoperations;
 
-    robject = rfs_get_object_by_system_object(radix_tree,
+    robject = rfs_get_object_by_system_object(table,
                                               old_op);
     if (!robject)
         return NULL;
@@ -198,7 +252,6 @@ rfs_find_operations(
 
     return rfs_hoperations;
 }
-#endif
 
 /*---------------------------------------------------------------------------*/
 
@@ -224,6 +277,7 @@ rfs_free_file_operations(
 
 static struct rfs_object_type rfs_file_operations_type = {
     .type = RFS_TYPE_FILE_OPS,
+    .size = sizeof(struct rfs_hoperations) + sizeof(struct file_operations),
     .free = rfs_free_file_operations,
     };
 
@@ -242,7 +296,7 @@ rfs_create_file_ops(
     if (!op_old)
         return NULL;
 
-    rhoperations = rfs_find_operations(rfs_hoperations_radix_tree[RFS_TYPE_FILE_OPS],
+    rhoperations = rfs_find_operations(rfs_hoperations_table[RFS_TYPE_FILE_OPS],
                                        op_old);
     if (rhoperations) {
         /* found in the table */
@@ -270,6 +324,10 @@ rfs_create_file_ops(
 
     /* the space for new file operations is located after the object */
     rhoperations->new.f_op = (struct file_operations *)(rhoperations + 1);
+
+    BUILD_BUG_ON(offsetof(struct rfs_hoperations, self) +
+                 sizeof(rhoperations->self) != sizeof(*rhoperations));
+    rhoperations->self = rhoperations;
     
     /* copy the old operations to the new ones */
     *rhoperations->new.f_op = *op_old;
@@ -310,6 +368,7 @@ rfs_free_inode_operations(
 
 static struct rfs_object_type rfs_inode_operations_type = {
     .type = RFS_TYPE_INODE_OPS,
+    .size = sizeof(struct rfs_hoperations) + sizeof(struct inode_operations),
     .free = rfs_free_inode_operations,
     };
 
@@ -328,7 +387,7 @@ rfs_create_inode_ops(
     if (!op_old)
         return ERR_PTR(-EINVAL); 
 
-    rhoperations = rfs_find_operations(rfs_hoperations_radix_tree[RFS_TYPE_INODE_OPS],
+    rhoperations = rfs_find_operations(rfs_hoperations_table[RFS_TYPE_INODE_OPS],
                                        op_old);
     if (rhoperations) {
         /* found in the table */
@@ -388,6 +447,8 @@ rfs_free_address_space_operations(
 
 static struct rfs_object_type rfs_address_space_operations_type = {
     .type = RFS_TYPE_AS_OPS,
+    .size = sizeof(struct rfs_hoperations) +
+            sizeof(struct address_space_operations),
     .free = rfs_free_address_space_operations,
     };
 
@@ -406,7 +467,7 @@ rfs_create_address_space_ops(
     if (!op_old)
         return ERR_PTR(-EINVAL); 
 
-    rhoperations = rfs_find_operations(rfs_hoperations_radix_tree[RFS_TYPE_AS_OPS],
+    rhoperations = rfs_find_operations(rfs_hoperations_table[RFS_TYPE_AS_OPS],
                                        op_old);
     if (rhoperations) {
         /* found in the table */
@@ -466,6 +527,7 @@ rfs_free_dentry_operations(
 
 static struct rfs_object_type rfs_dentry_type = {
     .type = RFS_TYPE_DENTRY_OPS,
+    .size = sizeof(struct rfs_hoperations) + sizeof(struct dentry_operations),
     .free = rfs_free_dentry_operations,
     };
 
@@ -482,7 +544,7 @@ rfs_create_dentry_ops(
     DBG_BUG_ON(!rfs_preemptible());
 
     /* op_old might be NULL for some dentries */
-    rhoperations = rfs_find_operations(rfs_hoperations_radix_tree[RFS_TYPE_DENTRY_OPS],
+    rhoperations = rfs_find_operations(rfs_hoperations_table[RFS_TYPE_DENTRY_OPS],
                                        op_old);
     if (rhoperations) {
         /* found in the table */
@@ -25,6 +25,7 @@
 
 #include "redirfs.h"
 #include "rfs_object.h"
+#include "rfs_dbg.h"
 
 struct rfs_file;
 struct rfs_inode;
@@ -82,10 +83,25 @@ struct rfs_hoperations {
         struct address_space_operations     *a_op;
         struct dentry_operations            *d_op;
     } new;
+
+    /*
+     * points to this structure, must be the last field so it
+     * immediately precedes the new operations, see rfs_hooked_file_op_old
+     */
+    struct rfs_hoperations *self;
 };
 
 /*---------------------------------------------------------------------------*/
 
+/* sets up and tears down the tables of hooked operations */
+int
+rfs_hoperations_init(void);
+
+void
+rfs_hoperations_destroy(void);
+
+/*---------------------------------------------------------------------------*/
+
 void
 rfs_keep_operations(
     struct rfs_hoperations* rfs_hoperations);
@@ -112,5 +128,28 @@ struct rfs_hoperations*
 rfs_create_dentry_ops(
     const struct dentry_operations *op_old);
 
+/*---------------------------------------------------------------------------*/
+
+/*
+ * returns the original file operations of a shared vector allocated by
+ * rfs_create_file_ops, no lookup is done, the caller has to know that f_op
+ * is such a vector, see rfs_file_op_old
+ */
+static inline const struct file_operations*
+rfs_hooked_file_op_old(
+    const struct file_operations *f_op)
+{
+    struct rfs_hoperations *rhoperations;
+
+    rhoperations = (struct rfs_hoperations *)f_op - 1;
+    DBG_BUG_ON(rhoperations->self != rhoperations);
+
+    return rhoperations->old.f_op;
+}
+
+#ifndef READ_ONCE
+#define READ_ONCE(x) ACCESS_ONCE(x)
+#endif
+
 /*---------------------------------------------------------------------------*/
 #endif /* _RFS_HOOKED_OPS_H */
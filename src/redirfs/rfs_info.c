@@ -24,6 +24,8 @@
  * along with RedirFS. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <linux/hashtable.h>
+#include <linux/jhash.h>
 #include "rfs.h"
 
 #ifdef RFS_DBG
@@ -31,6 +33,10 @@
     #pragma GCC optimize ("O0")
 #endif // RFS_DBG
 
+#ifdef RFS_INFO_SRCU
+struct srcu_struct rfs_info_srcu;
+#endif
+
 static int rfs_info_add_ops(struct rfs_info *rinfo, struct rfs_chain *rchain)
 {
     struct rfs_ops *rops;
@@ -50,14 +56,87 @@ static int rfs_info_add_ops(struct rfs_info *rinfo, struct rfs_chain *rchain)
     return 0;
 }
 
+/*
+ * the infos are immutable and interned by the root and the chain, so the
+ * dentries and inodes with the same configuration share one info and its
+ * ops, protected by rfs_info_table_lock
+ */
+static DEFINE_HASHTABLE(rfs_info_table, 8);
+static DEFINE_SPINLOCK(rfs_info_table_lock);
+static atomic_t rfs_info_nr = ATOMIC_INIT(0);
+
+static u32 rfs_info_hash(struct rfs_root *rroot, struct rfs_chain *rchain)
+{
+    void *key[2] = {rroot, rchain};
+
+    return jhash(key, sizeof(key), 0);
+}
+
+static struct rfs_info *rfs_info_lookup(struct rfs_root *rroot,
+        struct rfs_chain *rchain, u32 hash)
+{
+    struct rfs_info *rinfo;
+
+    hash_for_each_possible(rfs_info_table, rinfo, hnode, hash) {
+        if (rinfo->rroot != rroot || rinfo->rchain != rchain)
+            continue;
+
+        /* the info is being released */
+        if (!atomic_inc_not_zero(&rinfo->count))
+            continue;
+
+        return rinfo;
+    }
+
+    return NULL;
+}
+
+/*
+ * the ops of the infos with the filter are stale after its callbacks were
+ * changed, the retired infos are not shared anymore
+ */
+void rfs_info_retire_flt(struct rfs_flt *rflt)
+{
+    struct rfs_info *rinfo;
+    struct hlist_node *tmp;
+    int bkt;
+
+    spin_lock_bh(&rfs_info_table_lock);
+
+    hash_for_each_safe(rfs_info_table, bkt, tmp, rinfo, hnode) {
+        if (rfs_chain_find(rinfo->rchain, rflt) == -1)
+            continue;
+
+        hash_del(&rinfo->hnode);
+        atomic_dec(&rfs_info_nr);
+    }
+
+    spin_unlock_bh(&rfs_info_table_lock);
+}
+
+int rfs_info_unique_nr(void)
+{
+    return atomic_read(&rfs_info_nr);
+}
+
 struct rfs_info *rfs_info_alloc(struct rfs_root *rroot,
         struct rfs_chain *rchain)
 {
     struct rfs_info *rinfo;
+    struct rfs_info *rinfo_old;
+    u32 hash;
     int rv;
 
     DBG_BUG_ON(!rfs_preemptible());
 
+    hash = rfs_info_hash(rroot, rchain);
+
+    spin_lock_bh(&rfs_info_table_lock);
+    rinfo = rfs_info_lookup(rroot, rchain, hash);
+    spin_unlock_bh(&rfs_info_table_lock);
+    if (rinfo)
+        return rinfo;
+
     rinfo = kzalloc(sizeof(struct rfs_info), GFP_KERNEL);
     if (!rinfo)
         return ERR_PTR(-ENOMEM);
@@ -70,11 +149,167 @@ struct rfs_info *rfs_info_alloc(struct rfs_root *rroot,
 
     rinfo->rchain = rfs_chain_get(rchain);
     rinfo->rroot = rfs_root_get(rroot);
+    if (rroot)
+        rinfo->rslot = &rroot->rslot;
     atomic_set(&rinfo->count, 1);
+    INIT_HLIST_NODE(&rinfo->hnode);
+
+    spin_lock_bh(&rfs_info_table_lock);
+    rinfo_old = rfs_info_lookup(rroot, rchain, hash);
+    if (!rinfo_old) {
+        hash_add(rfs_info_table, &rinfo->hnode, hash);
+        atomic_inc(&rfs_info_nr);
+    }
+    spin_unlock_bh(&rfs_info_table_lock);
+
+    if (rinfo_old) {
+        /* lost the race, the new info was never visible */
+        rfs_chain_put(rinfo->rchain);
+        rfs_ops_put(rinfo->rops);
+        rfs_root_put(rinfo->rroot);
+        kfree(rinfo);
+        return rinfo_old;
+    }
 
     return rinfo;
 }
 
+#ifdef RFS_INFO_SRCU
+
+static bool rfs_info_ops_cover(struct rfs_ops *rops, struct rfs_ops *rops_hooked)
+{
+    int it;
+
+    if (rops->flags & ~rops_hooked->flags)
+        return false;
+
+    for (it = 0; it < RFS_INODE_MAX; it++) {
+        if (!bitmap_subset(rops->bits[it], rops_hooked->bits[it],
+                    RFS_OP_MAX))
+            return false;
+    }
+
+    return true;
+}
+
+/*
+ * the objects stay attached with the base info whose chain keeps the
+ * references of its filters, a filter missing in the new chain would stay
+ * pinned until the next walk
+ */
+static bool rfs_info_chain_covers(struct rfs_chain *rchain,
+        struct rfs_chain *rbase_chain)
+{
+    int i;
+
+    if (!rbase_chain)
+        return true;
+
+    for (i = 0; i < rbase_chain->rflts_nr; i++) {
+        if (rfs_chain_find(rchain, rbase_chain->rflts[i]) == -1)
+            return false;
+    }
+
+    return true;
+}
+
+/*
+ * publishes the chain in the root's slot so a filter added to the root
+ * does not need a dcache walk, the objects below the root up to the nested
+ * roots are attached with the root's info and the ops hooked for it have to
+ * cover the new chain, which has to keep all filters of the base chain,
+ * -EAGAIN is returned otherwise and the caller has to walk, called with
+ * rfs_path_mutex
+ */
+int rfs_info_switch(struct rfs_root *rroot, struct rfs_chain *rchain)
+{
+    struct rfs_info *rbase;
+    struct rfs_info *rinfo;
+    int rv;
+
+    might_sleep();
+
+    rbase = rfs_info_base(rroot->rinfo);
+    if (!rbase || !rbase->rslot || !rbase->rops || !rchain)
+        return -EAGAIN;
+
+    if (rchain == rbase->rchain) {
+        rfs_root_set_rinfo(rroot, rbase);
+        return rfs_inode_set_rinfo_links(rroot);
+    }
+
+    /* a filter removed from the base chain is released by the walk */
+    if (!rfs_info_chain_covers(rchain, rbase->rchain))
+        return -EAGAIN;
+
+    rinfo = kzalloc(sizeof(struct rfs_info), GFP_KERNEL);
+    if (!rinfo)
+        return -ENOMEM;
+
+    rv = rfs_info_add_ops(rinfo, rchain);
+    if (rv) {
+        kfree(rinfo);
+        return rv;
+    }
+
+    if (!rfs_info_ops_cover(rinfo->rops, rbase->rops)) {
+        rfs_ops_put(rinfo->rops);
+        kfree(rinfo);
+        return -EAGAIN;
+    }
+
+    /* not interned, the switched info is private to the slot */
+    rinfo->rchain = rfs_chain_get(rchain);
+    rinfo->rroot = rfs_root_get(rroot);
+    rinfo->rbase = rfs_info_get(rbase);
+    atomic_set(&rinfo->count, 1);
+    INIT_HLIST_NODE(&rinfo->hnode);
+
+    /* the old slot info is freed after the hooks using it are done */
+    rfs_root_set_rinfo(rroot, rinfo);
+    rfs_info_put(rinfo);
+
+    /* the joined infos of the hard links are not in the slot */
+    return rfs_inode_set_rinfo_links(rroot);
+}
+
+#else /* RFS_INFO_SRCU */
+
+/*
+ * the hooks hold a reference to the info but not to the slot
+ */
+int rfs_info_switch(struct rfs_root *rroot, struct rfs_chain *rchain)
+{
+    return -EAGAIN;
+}
+
+#endif /* !RFS_INFO_SRCU */
+
+/*
+ * a reference to the info the hooks see for rinfo, the slot info is
+ * replaced before its last reference is dropped so the loop ends
+ */
+struct rfs_info *rfs_info_get_slot(struct rfs_info *rinfo)
+{
+#ifdef RFS_INFO_SRCU
+    struct rfs_info *rinfo_slot;
+    int idx;
+
+    if (!rinfo || IS_ERR(rinfo))
+        return NULL;
+
+    idx = srcu_read_lock(&rfs_info_srcu);
+    do {
+        rinfo_slot = rfs_info_slot(rinfo);
+    } while (!atomic_inc_not_zero(&rinfo_slot->count));
+    srcu_read_unlock(&rfs_info_srcu, idx);
+
+    return rinfo_slot;
+#else
+    return rfs_info_get(rinfo);
+#endif
+}
+
 struct rfs_info *rfs_info_get(struct rfs_info *rinfo)
 {
     if (!rinfo || IS_ERR(rinfo))
@@ -86,6 +321,22 @@ struct rfs_info *rfs_info_get(struct rfs_info *rinfo)
     return rinfo;
 }
 
+static void rfs_info_free(struct rfs_info *rinfo)
+{
+    rfs_chain_put(rinfo->rchain);
+    rfs_ops_put(rinfo->rops);
+    rfs_info_put(rinfo->rbase);
+    rfs_root_put(rinfo->rroot);
+    kfree(rinfo);
+}
+
+#ifdef RFS_INFO_SRCU
+static void rfs_info_free_rcu(struct rcu_head *head)
+{
+    rfs_info_free(container_of(head, struct rfs_info, rcu));
+}
+#endif
+
 void rfs_info_put(struct rfs_info *rinfo)
 {
     if (!rinfo || IS_ERR(rinfo))
@@ -95,10 +346,19 @@ void rfs_info_put(struct rfs_info *rinfo)
     if (!atomic_dec_and_test(&rinfo->count))
         return;
 
-    rfs_chain_put(rinfo->rchain);
-    rfs_ops_put(rinfo->rops);
-    rfs_root_put(rinfo->rroot);
-    kfree(rinfo);
+    spin_lock_bh(&rfs_info_table_lock);
+    if (hash_hashed(&rinfo->hnode)) {
+        hash_del(&rinfo->hnode);
+        atomic_dec(&rfs_info_nr);
+    }
+    spin_unlock_bh(&rfs_info_table_lock);
+
+#ifdef RFS_INFO_SRCU
+    /* hooks might still use the rinfo, see rfs_dentry_read_rinfo */
+    call_srcu(&rfs_info_srcu, &rinfo->rcu, rfs_info_free_rcu);
+#else
+    rfs_info_free(rinfo);
+#endif
 }
 
 static struct rfs_info *rfs_info_dentry(struct dentry *dentry)
@@ -110,7 +370,7 @@ static struct rfs_info *rfs_info_dentry(struct dentry *dentry)
     if (!rdentry)
         return NULL;
 
-    rinfo = rfs_info_get(rdentry->rinfo);
+    rinfo = rfs_info_get_slot(rdentry->rinfo);
 
     rfs_dentry_put(rdentry);
 
@@ -155,7 +415,7 @@ static void rfs_info_rdentry_rem(struct dentry *dentry)
     spin_lock(&rdentry->lock);
     {
         rinfo_old = rdentry->rinfo;
-        rdentry->rinfo = rfs_info_get(rfs_info_none);
+        rcu_assign_pointer(rdentry->rinfo, rfs_info_get(rfs_info_none));
     }
     spin_unlock(&rdentry->lock);
 
@@ -173,7 +433,7 @@ int rfs_info_add(struct dentry *dentry, struct rfs_info *rinfo,
     if (IS_ERR(rdata))
         return PTR_ERR(rdata);
 
-    rv = rfs_dcache_walk(dentry, rfs_dcache_add, rdata);
+    rv = rfs_dcache_walk_add(rdata);
     rfs_dcache_data_free(rdata);
 
     if (!rv)
@@ -192,7 +452,7 @@ int rfs_info_rem(struct dentry *dentry, struct rfs_info *rinfo,
     if (IS_ERR(rdata))
         return PTR_ERR(rdata);
 
-    rv = rfs_dcache_walk(dentry, rfs_dcache_rem, rdata);
+    rv = rfs_dcache_walk_parallel(dentry, rfs_dcache_rem, rdata);
     rfs_dcache_data_free(rdata);
 
     if (!rv)
@@ -233,7 +493,7 @@ int rfs_info_reset(struct dentry *dentry, struct rfs_info *rinfo)
     if (IS_ERR(rdata))
         return PTR_ERR(rdata);
 
-    rv = rfs_dcache_walk(dentry, rfs_dcache_reset, rdata);
+    rv = rfs_dcache_walk_parallel(dentry, rfs_dcache_reset, rdata);
     rfs_dcache_data_free(rdata);
 
     return rv;
@@ -263,6 +523,18 @@ int rfs_info_add_include(struct rfs_root *rroot, struct rfs_flt *rflt)
         goto exit;
     }
 
+    if (rinfo_old && rinfo_old == rroot->rinfo) {
+        rv = rfs_info_switch(rroot, rchain);
+        if (!rv) {
+            rfs_root_add_walk_subroots(rroot->dentry);
+            rv = rfs_root_walk(rfs_root_add_flt, rflt);
+            goto exit;
+        }
+        if (rv != -EAGAIN)
+            goto exit;
+        rv = 0;
+    }
+
     rinfo = rfs_info_alloc(rroot, rchain);
     if (IS_ERR(rinfo)) {
         rv = PTR_ERR(rinfo);
@@ -367,6 +639,15 @@ int rfs_info_rem_include(struct rfs_root *rroot, struct rfs_flt *rflt)
     if (prinfo && rfs_chain_find(prinfo->rchain, rflt) != -1)
         goto exit;
 
+    rv = rfs_info_switch(rroot, rchain);
+    if (!rv) {
+        rfs_root_add_walk_subroots(rroot->dentry);
+        rv = rfs_root_walk(rfs_root_rem_flt, rflt);
+        goto exit;
+    }
+    if (rv != -EAGAIN)
+        goto exit;
+
     rv = rfs_info_rem(rroot->dentry, rinfo, rflt);
     if (rv)
         goto exit;
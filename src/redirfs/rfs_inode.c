@@ -40,7 +40,18 @@
 
 /*---------------------------------------------------------------------------*/
 
-struct rfs_radix_tree   rfs_inode_radix_tree = {
+#ifdef RFS_USE_HASHTABLE
+
+static struct rfs_object_table rfs_inode_object_table = {
+    .rfs_type = RFS_TYPE_RINODE,
+    };
+
+static struct rfs_object_table *const rfs_inode_table =
+    &rfs_inode_object_table;
+
+#else /* RFS_USE_HASHTABLE */
+
+static struct rfs_radix_tree rfs_inode_radix_tree = {
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(4,0,0)) 
     .root = RADIX_TREE_INIT(GFP_ATOMIC),
 #else
@@ -50,12 +61,17 @@ struct rfs_radix_tree   rfs_inode_radix_tree = {
     .rfs_type = RFS_TYPE_RINODE,
     };
 
+static struct rfs_radix_tree *const rfs_inode_table = &rfs_inode_radix_tree;
+
+#endif /* !RFS_USE_HASHTABLE */
+
 /*---------------------------------------------------------------------------*/
 
 void rfs_inode_free(struct rfs_object *robject);
 
 static struct rfs_object_type rfs_inode_type = {
     .type = RFS_TYPE_RINODE,
+    .size = sizeof(struct rfs_inode),
     .free = rfs_inode_free,
     };
     
@@ -63,6 +79,13 @@ static struct rfs_object_type rfs_inode_type = {
 
 static rfs_kmem_cache_t *rfs_inode_cache = NULL;
 
+/*
+ * the inodes with rdentries attached with different rinfos, their rinfo is
+ * joined and does not follow the roots' slots, see rfs_inode_set_rinfo_links
+ */
+static LIST_HEAD(rfs_inode_joined);
+static DEFINE_SPINLOCK(rfs_inode_joined_lock);
+
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(3,17,0))
 int rfs_rename(struct inode *old_dir, struct dentry *old_dentry,
         struct inode *new_dir, struct dentry *new_dentry);
@@ -101,7 +124,28 @@ struct rfs_inode* rfs_inode_find(struct inode *inode)
         return rinode;
 #endif /* RFS_PER_OBJECT_OPS */
 
-    robject = rfs_get_object_by_system_object(&rfs_inode_radix_tree, inode);
+    robject = rfs_get_object_by_system_object(rfs_inode_table, inode);
+    if (!robject)
+        return NULL;
+
+    rinode = container_of(robject, struct rfs_inode, robject);
+    DBG_BUG_ON(RFS_INODE_SIGNATURE != rinode->signature);
+    return rinode;
+}
+
+/* no reference is taken, the rinode is valid until rcu_read_unlock */
+struct rfs_inode* rfs_inode_find_rcu(struct inode *inode)
+{
+    struct rfs_inode  *rinode;
+    struct rfs_object *robject;
+
+#ifdef RFS_PER_OBJECT_OPS
+    rinode = rfs_cast_to_rinode(inode);
+    if (rinode)
+        return rinode;
+#endif /* RFS_PER_OBJECT_OPS */
+
+    robject = rfs_find_object_by_system_object_rcu(rfs_inode_table, inode);
     if (!robject)
         return NULL;
 
@@ -129,7 +173,8 @@ static struct rfs_inode *rfs_inode_alloc(struct inode *inode)
     rfs_object_init(&rinode->robject, &rfs_inode_type, inode);
 
     INIT_LIST_HEAD(&rinode->rdentries);
-    INIT_LIST_HEAD(&rinode->data);
+    INIT_LIST_HEAD(&rinode->links_list);
+    rfs_data_head_init(&rinode->data);
     rinode->inode = inode;
     rinode->op_old = inode->i_op;
     rinode->f_op_old = inode->i_fop;
@@ -180,6 +225,17 @@ static struct rfs_inode *rfs_inode_alloc(struct inode *inode)
         }
     }
 
+    if (rinode->f_op_old && !S_ISSOCK(inode->i_mode)) {
+        rinode->f_rhops = rfs_create_file_ops(rinode->f_op_old);
+        DBG_BUG_ON(IS_ERR(rinode->f_rhops));
+        if (IS_ERR(rinode->f_rhops)) {
+            void *err_ptr = rinode->f_rhops;
+            rinode->f_rhops = NULL;
+            rfs_object_put(&rinode->robject);
+            return err_ptr;
+        }
+    }
+
 #endif /* !RFS_PER_OBJECT_OPS  */
 
     return rinode;
@@ -222,19 +278,27 @@ void rfs_inode_free(struct rfs_object *robject)
         rfs_object_put(&rinode->i_rhops->robject);
     if (rinode->a_rhops)
         rfs_object_put(&rinode->a_rhops->robject);
+    if (rinode->f_rhops)
+        rfs_object_put(&rinode->f_rhops->robject);
 #endif /* !RFS_PER_OBJECT_OPS */
 
     rfs_info_put(rinode->rinfo);
-    rfs_data_remove(&rinode->data);
+    rfs_data_head_remove(&rinode->data);
     kmem_cache_free(rfs_inode_cache, rinode);
 }
 
 /*---------------------------------------------------------------------------*/
 
+#ifdef RFS_PER_OBJECT_OPS
+    #define RFS_INODE_FOP_NEW(ri) ((ri)->f_op_new)
+#else
+    #define RFS_INODE_FOP_NEW(ri) (*(ri)->f_rhops->new.f_op)
+#endif
+
 static void rfs_inode_set_default_fop_reg(struct rfs_inode *ri_new, struct inode *inode)
 {
 #define PROTOTYPE_FOP(op, new_op) \
-    RFS_ADD_OP(ri_new->f_op_new, inode->i_fop, op, new_op);
+    RFS_ADD_OP(RFS_INODE_FOP_NEW(ri_new), inode->i_fop, op, new_op);
     SET_FOP_REG
 #undef PROTOTYPE_FOP
 }
@@ -242,7 +306,7 @@ static void rfs_inode_set_default_fop_reg(struct rfs_inode *ri_new, struct inode
 static void rfs_inode_set_default_fop_dir(struct rfs_inode *ri_new, struct inode *inode)
 {
 #define PROTOTYPE_FOP(op, new_op) \
-    RFS_ADD_OP(ri_new->f_op_new, inode->i_fop, op, new_op);
+    RFS_ADD_OP(RFS_INODE_FOP_NEW(ri_new), inode->i_fop, op, new_op);
     SET_FOP_DIR
 #undef PROTOTYPE_FOP
 }
@@ -254,7 +318,7 @@ static void rfs_inode_set_default_fop_lnk(struct rfs_inode *ri_new, struct inode
 static void rfs_inode_set_default_fop_chr(struct rfs_inode *ri_new, struct inode *inode)
 {
 #define PROTOTYPE_FOP(op, new_op) \
-    RFS_ADD_OP(ri_new->f_op_new, inode->i_fop, op, new_op);
+    RFS_ADD_OP(RFS_INODE_FOP_NEW(ri_new), inode->i_fop, op, new_op);
     SET_FOP_CHR
 #undef PROTOTYPE_FOP
 }
@@ -271,6 +335,12 @@ static void rfs_inode_set_default_fop(struct rfs_inode *ri_new, struct inode *in
 {
     umode_t mode = inode->i_mode;
 
+#ifndef RFS_PER_OBJECT_OPS
+    /* no i_fop to hook */
+    if (!ri_new->f_rhops)
+        return;
+#endif
+
     if (S_ISREG(mode))
         rfs_inode_set_default_fop_reg(ri_new, inode);
 
@@ -298,12 +368,12 @@ static void rfs_inode_set_default_fop(struct rfs_inode *ri_new, struct inode *in
     }
 
 #define PROTOTYPE_FOP(op, new_op) \
-    RFS_ADD_OP_MGT(ri_new->f_op_new, inode->i_fop, op, new_op);
+    RFS_ADD_OP_MGT(RFS_INODE_FOP_NEW(ri_new), inode->i_fop, op, new_op);
     FUNCTION_FOP_open // a watermark for rfs_cast_to_rfile
     FUNCTION_FOP_release
 #undef PROTOTYPE_FOP
 
-    inode->i_fop = &ri_new->f_op_new;
+    inode->i_fop = &RFS_INODE_FOP_NEW(ri_new);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -330,7 +400,7 @@ struct rfs_inode *rfs_inode_add(struct inode *inode, struct rfs_info *rinfo)
         if (!ri) {
             DBG_BUG_ON(ri_new->f_op_old->open == rfs_open);
 
-            ri_new->rinfo = rfs_info_get(rinfo);
+            ri_new->rinfo = rfs_info_get(rfs_info_base(rinfo));
 
             rfs_inode_set_default_fop(ri_new, inode);
 
@@ -341,7 +411,7 @@ struct rfs_inode *rfs_inode_add(struct inode *inode, struct rfs_info *rinfo)
             }
 #endif /* RFS_PER_OBJECT_OPS */
 
-            err = rfs_insert_object(&rfs_inode_radix_tree,
+            err = rfs_insert_object(rfs_inode_table,
                                     &ri_new->robject,
                                     false);
             DBG_BUG_ON(err);
@@ -360,6 +430,8 @@ struct rfs_inode *rfs_inode_add(struct inode *inode, struct rfs_info *rinfo)
         rfs_keep_operations(ri_new->i_rhops);
         if (ri_new->a_rhops)
             rfs_keep_operations(ri_new->a_rhops);
+        if (ri_new->f_rhops)
+            rfs_keep_operations(ri_new->f_rhops);
     }
 #endif /* RFS_PER_OBJECT_OPS */
 
@@ -396,12 +468,24 @@ void rfs_inode_del(struct rfs_inode *rinode)
     rfs_unkeep_operations(rinode->i_rhops);
     if (rinode->a_rhops)
         rfs_unkeep_operations(rinode->a_rhops);
+    if (rinode->f_rhops)
+        rfs_unkeep_operations(rinode->f_rhops);
 #endif /* RFS_PER_OBJECT_OPS */
     rfs_inode_put(rinode);
 }
 
 /*---------------------------------------------------------------------------*/
 
+static void rfs_inode_set_joined(struct rfs_inode *rinode, bool joined)
+{
+    spin_lock(&rfs_inode_joined_lock);
+    if (!joined)
+        list_del_init(&rinode->links_list);
+    else if (list_empty(&rinode->links_list))
+        list_add_tail(&rinode->links_list, &rfs_inode_joined);
+    spin_unlock(&rfs_inode_joined_lock);
+}
+
 void rfs_inode_add_rdentry(struct rfs_inode *rinode, struct rfs_dentry *rdentry)
 {
     rfs_mutex_lock(&rinode->mutex);
@@ -420,6 +504,9 @@ void rfs_inode_rem_rdentry(struct rfs_inode *rinode, struct rfs_dentry *rdentry)
     }
     rinode->rdentries_nr--;
     list_del_init(&rdentry->rinode_list);
+    /* the inode is listed only while its rdentries hold it */
+    if (rinode->rdentries_nr == 1)
+        rfs_inode_set_joined(rinode, false);
     rfs_mutex_unlock(&rinode->mutex);
     rfs_dentry_put(rdentry);
 }
@@ -430,15 +517,14 @@ static struct rfs_chain *rfs_inode_join_rchains(struct rfs_inode *rinode)
     struct rfs_info *rinfo = NULL;
     struct rfs_chain *rchain = NULL;
     struct rfs_chain *rchain_old = NULL;
+    int rinfo_idx;
 
     list_for_each_entry(rdentry, &rinode->rdentries, rinode_list) {
-        spin_lock(&rdentry->lock);
-        rinfo = rfs_info_get(rdentry->rinfo);
-        spin_unlock(&rdentry->lock);
-
+        /* the chain the hooks see, see rfs_info_switch */
+        rinfo = rfs_dentry_read_rinfo(rdentry, &rinfo_idx);
         rchain = rfs_chain_join(rinfo->rchain, rchain_old);
+        rfs_info_read_done(rinfo, rinfo_idx);
 
-        rfs_info_put(rinfo);
         rfs_chain_put(rchain_old);
 
         if (IS_ERR(rchain))
@@ -450,28 +536,36 @@ static struct rfs_chain *rfs_inode_join_rchains(struct rfs_inode *rinode)
     return rchain;
 }
 
+/*
+ * the hard links attached with one rinfo, usually below one root, share it
+ * and follow the root's slot
+ */
 static int rfs_inode_set_rinfo_fast(struct rfs_inode *rinode)
 {
     struct rfs_dentry *rdentry;
+    struct rfs_dentry *rdentry_link;
     struct rfs_info   *rinfo_old;
 
     if (!rinode->rdentries_nr)
         return 0;
 
-    if (rinode->rdentries_nr > 1)
-        return -1;
-
     rdentry = list_entry(rinode->rdentries.next, struct rfs_dentry, rinode_list);
 
+    list_for_each_entry(rdentry_link, &rinode->rdentries, rinode_list) {
+        if (rdentry_link->rinfo != rdentry->rinfo)
+            return -1;
+    }
+
     spin_lock(&rdentry->lock);
     spin_lock(&rinode->lock);
     {
         rinfo_old = rinode->rinfo;
-        rinode->rinfo = rfs_info_get(rdentry->rinfo);
+        rcu_assign_pointer(rinode->rinfo, rfs_info_get(rdentry->rinfo));
     }
     spin_unlock(&rinode->lock);
     spin_unlock(&rdentry->lock);
 
+    rfs_inode_set_joined(rinode, false);
     rfs_info_put(rinfo_old);
 
     return 0;
@@ -494,61 +588,42 @@ int rfs_inode_set_rinfo(struct rfs_inode *rinode)
 {
     struct rfs_chain *rchain;
     struct rfs_info *rinfo;
-    struct rfs_ops *rops;
     struct rfs_info *rinfo_old = NULL;
     int rv;
 
     if (!rinode)
         return 0;
 
-    rfs_mutex_lock(&rinode->mutex);
-    rv = rfs_inode_set_rinfo_fast(rinode);
-    rfs_mutex_unlock(&rinode->mutex);
-    if (!rv)
-        return 0;
-
-    rinfo = rfs_info_alloc(NULL, NULL);
-    if (IS_ERR(rinfo))
-        return PTR_ERR(rinfo);
-
-    rops = rfs_ops_alloc();
-    if (IS_ERR(rops)) {
-        rfs_info_put(rinfo);
-        return PTR_ERR(rops);
-    }
-
-    rinfo->rops = rops;
-
     rfs_mutex_lock(&rinode->mutex);
     { // start of the mutex lock
         rv = rfs_inode_set_rinfo_fast(rinode);
         if (!rv) {
             rfs_mutex_unlock(&rinode->mutex);
-            rfs_info_put(rinfo);
             return 0;
         }
 
         rchain = rfs_inode_join_rchains(rinode);
         if (IS_ERR(rchain)) {
             rfs_mutex_unlock(&rinode->mutex);
-            rfs_info_put(rinfo);
             return PTR_ERR(rchain);
         }
 
-        rinfo->rchain = rchain;
-
-        if (!rinfo->rchain) {
-            rfs_info_put(rinfo);
-            rinfo = rfs_info_get(rfs_info_none);
+        /* the interned info, rfs_info_none for no chain */
+        rinfo = rfs_info_alloc(NULL, rchain);
+        rfs_chain_put(rchain);
+        if (IS_ERR(rinfo)) {
+            rfs_mutex_unlock(&rinode->mutex);
+            return PTR_ERR(rinfo);
         }
 
-        rfs_chain_ops(rinfo->rchain, rinfo->rops);
         spin_lock(&rinode->lock);
         { // start of the lock
             rinfo_old = rinode->rinfo;
-            rinode->rinfo = rinfo;
+            rcu_assign_pointer(rinode->rinfo, rinfo);
         } // end of the lock
         spin_unlock(&rinode->lock);
+
+        rfs_inode_set_joined(rinode, true);
     } // end of the mutex lock
     rfs_mutex_unlock(&rinode->mutex);
 
@@ -557,19 +632,79 @@ int rfs_inode_set_rinfo(struct rfs_inode *rinode)
     return 0;
 }
 
+static bool rfs_inode_below_root(struct rfs_inode *rinode,
+        struct rfs_root *rroot)
+{
+    struct rfs_dentry *rdentry;
+    struct rfs_info *rinfo;
+    bool below = false;
+
+    rfs_mutex_lock(&rinode->mutex);
+    list_for_each_entry(rdentry, &rinode->rdentries, rinode_list) {
+        rinfo = rfs_dentry_get_rinfo(rdentry);
+        below = rinfo->rslot == &rroot->rslot;
+        rfs_info_put(rinfo);
+        if (below)
+            break;
+    }
+    rfs_mutex_unlock(&rinode->mutex);
+
+    return below;
+}
+
+/*
+ * recomputes the joined rinfo of the inodes with an rdentry below the root
+ * after a chain was switched in the root's slot, see rfs_info_switch
+ */
+int rfs_inode_set_rinfo_links(struct rfs_root *rroot)
+{
+    LIST_HEAD(pending);
+    struct rfs_inode *rinode;
+    int rv = 0;
+
+    spin_lock(&rfs_inode_joined_lock);
+    list_splice_init(&rfs_inode_joined, &pending);
+    while (!list_empty(&pending)) {
+        rinode = list_entry(pending.next, struct rfs_inode, links_list);
+        list_move_tail(&rinode->links_list, &rfs_inode_joined);
+        if (rv)
+            continue;
+
+        /* the rdentries hold references while the inode is listed */
+        rfs_inode_get(rinode);
+        spin_unlock(&rfs_inode_joined_lock);
+
+        if (rfs_inode_below_root(rinode, rroot))
+            rv = rfs_inode_set_rinfo(rinode);
+        rfs_inode_put(rinode);
+
+        spin_lock(&rfs_inode_joined_lock);
+    }
+    spin_unlock(&rfs_inode_joined_lock);
+
+    return rv;
+}
+
 int rfs_inode_cache_create(void)
 {
+    int rv = 0;
+
     rfs_inode_cache = rfs_kmem_cache_create("rfs_inode_cache",
             sizeof(struct rfs_inode));
 
     if (!rfs_inode_cache)
         return -ENOMEM;
 
-    return 0;
+    rv = rfs_object_table_init(rfs_inode_table);
+    if (rv)
+        kmem_cache_destroy(rfs_inode_cache);
+
+    return rv;
 }
 
 void rfs_inode_cache_destroy(void)
 {
+    rfs_object_table_destroy(rfs_inode_table);
     kmem_cache_destroy(rfs_inode_cache);
 }
 
@@ -658,6 +793,7 @@ struct dentry *rfs_lookup(struct inode *dir, struct dentry *dentry,
     rinode = rfs_inode_find(dir);
     rinfo = rfs_inode_get_rinfo(rinode);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
 
     rargs.args.i_lookup.dir = dir;
     rargs.args.i_lookup.dentry = dentry;
@@ -692,7 +828,7 @@ struct dentry *rfs_lookup(struct inode *dir, struct dentry *dentry,
 	} else {
 		if (rargs.rv.rv_dentry)
 			dentry = rargs.rv.rv_dentry;
-		if (rfs_dcache_rdentry_add(dentry, rinfo))
+		if (rfs_dcache_rdentry_add_lookup(dentry, rinfo))
 			BUG();
 	}
 exit:
@@ -723,6 +859,7 @@ static struct dentry *rfs_lookup(struct inode *dir, struct dentry *dentry,
     rinode = rfs_inode_find(dir);
     rinfo = rfs_inode_get_rinfo(rinode);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
 
     rargs.args.i_lookup.dir = dir;
     rargs.args.i_lookup.dentry = dentry;
@@ -753,7 +890,7 @@ static struct dentry *rfs_lookup(struct inode *dir, struct dentry *dentry,
     } else {
         if (rargs.rv.rv_dentry)
             dentry = rargs.rv.rv_dentry;
-        if (rfs_dcache_rdentry_add(dentry, rinfo))
+        if (rfs_dcache_rdentry_add_lookup(dentry, rinfo))
             BUG();
     }
 
@@ -781,6 +918,7 @@ static int rfs_mkdir(struct inode *dir, struct dentry *dentry, umode_t mode)
     rinode = rfs_inode_find(dir);
     rinfo = rfs_inode_get_rinfo(rinode);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
 
     if (S_ISDIR(dir->i_mode))
         rargs.type.id = REDIRFS_DIR_IOP_MKDIR;
@@ -836,6 +974,7 @@ static int rfs_create(struct inode *dir, struct dentry *dentry, int mode,
     rinode = rfs_inode_find(dir);
     rinfo = rfs_inode_get_rinfo(rinode);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
 
     if (S_ISDIR(dir->i_mode))
         rargs.type.id = REDIRFS_DIR_IOP_CREATE;
@@ -909,6 +1048,7 @@ static int rfs_create(struct inode *dir, struct dentry *dentry, umode_t mode,
     rinode = rfs_inode_find(dir);
     rinfo = rfs_inode_get_rinfo(rinode);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
 
     if (S_ISDIR(dir->i_mode))
         rargs.type.id = REDIRFS_DIR_IOP_CREATE;
@@ -963,6 +1103,7 @@ static int rfs_link(struct dentry *old_dentry, struct inode *dir,
     rinode = rfs_inode_find(dir);
     rinfo = rfs_inode_get_rinfo(rinode);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
 
     if (S_ISDIR(dir->i_mode))
         rargs.type.id = REDIRFS_DIR_IOP_LINK;
@@ -1009,6 +1150,7 @@ static int rfs_symlink(struct inode *dir, struct dentry *dentry,
     rinode = rfs_inode_find(dir);
     rinfo = rfs_inode_get_rinfo(rinode);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
 
     if (S_ISDIR(dir->i_mode))
         rargs.type.id = REDIRFS_DIR_IOP_SYMLINK;
@@ -1060,6 +1202,7 @@ static int rfs_mknod(struct inode * dir, struct dentry *dentry, umode_t mode,
     rinode = rfs_inode_find(dir);
     rinfo = rfs_inode_get_rinfo(rinode);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
 
     if (S_ISDIR(dir->i_mode))
         rargs.type.id = REDIRFS_DIR_IOP_MKNOD;
@@ -1101,12 +1244,14 @@ static int rfs_unlink(struct inode *inode, struct dentry *dentry)
 {
     struct rfs_inode *rinode;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
     rinode = rfs_inode_find(inode);
-    rinfo = rfs_inode_get_rinfo(rinode);
+    rinfo = rfs_inode_read_rinfo(rinode, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
 
     if (S_ISDIR(inode->i_mode))
         rargs.type.id = REDIRFS_DIR_IOP_UNLINK;
@@ -1131,7 +1276,7 @@ static int rfs_unlink(struct inode *inode, struct dentry *dentry)
     rfs_context_deinit(&rcont);
 
     rfs_inode_put(rinode);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     rfs_pr_debug("dentry=%p, ret=%d", dentry, rargs.rv.rv_int);
     return rargs.rv.rv_int;
 }
@@ -1140,12 +1285,14 @@ static int rfs_rmdir(struct inode *inode, struct dentry *dentry)
 {
     struct rfs_inode *rinode;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
     rinode = rfs_inode_find(inode);
-    rinfo = rfs_inode_get_rinfo(rinode);
+    rinfo = rfs_inode_read_rinfo(rinode, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
 
     if (S_ISDIR(inode->i_mode))
         rargs.type.id = REDIRFS_DIR_IOP_RMDIR;
@@ -1170,7 +1317,7 @@ static int rfs_rmdir(struct inode *inode, struct dentry *dentry)
     rfs_context_deinit(&rcont);
 
     rfs_inode_put(rinode);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 
@@ -1180,14 +1327,16 @@ static int rfs_permission(struct inode *inode, int mask, struct nameidata *nd)
 {
     struct rfs_inode *rinode;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
     int submask;
 
     submask = mask & ~MAY_APPEND;
     rinode = rfs_inode_find(inode);
-    rinfo = rfs_inode_get_rinfo(rinode);
+    rinfo = rfs_inode_read_rinfo(rinode, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
 
     if (S_ISREG(inode->i_mode))
         rargs.type.id = REDIRFS_REG_IOP_PERMISSION;
@@ -1228,7 +1377,7 @@ static int rfs_permission(struct inode *inode, int mask, struct nameidata *nd)
     rfs_context_deinit(&rcont);
 
     rfs_inode_put(rinode);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 
@@ -1238,14 +1387,16 @@ static int rfs_permission(struct inode *inode, int mask)
 {
     struct rfs_inode *rinode;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
     int submask;
 
     submask = mask & ~MAY_APPEND;
     rinode = rfs_inode_find(inode);
-    rinfo = rfs_inode_get_rinfo(rinode);
+    rinfo = rfs_inode_read_rinfo(rinode, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
 
     if (S_ISREG(inode->i_mode))
         rargs.type.id = REDIRFS_REG_IOP_PERMISSION;
@@ -1284,7 +1435,7 @@ static int rfs_permission(struct inode *inode, int mask)
     rfs_context_deinit(&rcont);
 
     rfs_inode_put(rinode);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 
@@ -1294,14 +1445,16 @@ static int rfs_permission(struct inode *inode, int mask, unsigned int flags)
 {
     struct rfs_inode *rinode;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
     int submask;
 
     submask = mask & ~MAY_APPEND;
     rinode = rfs_inode_find(inode);
-    rinfo = rfs_inode_get_rinfo(rinode);
+    rinfo = rfs_inode_read_rinfo(rinode, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
 
     if (S_ISREG(inode->i_mode))
         rargs.type.id = REDIRFS_REG_IOP_PERMISSION;
@@ -1340,7 +1493,7 @@ static int rfs_permission(struct inode *inode, int mask, unsigned int flags)
     rfs_context_deinit(&rcont);
 
     rfs_inode_put(rinode);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 
@@ -1350,14 +1503,35 @@ static int rfs_permission(struct inode *inode, int mask)
 {
     struct rfs_inode *rinode;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
     int submask;
+    bool rcu_walk = mask & MAY_NOT_BLOCK;
 
     submask = mask & ~MAY_APPEND;
-    rinode = rfs_inode_find(inode);
-    rinfo = rfs_inode_get_rinfo(rinode);
+
+    /* RCU path walk holds rcu_read_lock, the rinode is not referenced */
+    if (rcu_walk) {
+        rinode = rfs_inode_find_rcu(inode);
+        if (!rinode)
+            return -ECHILD;
+    } else
+        rinode = rfs_inode_find(inode);
+
+#ifdef RFS_LAZY_ATTACH
+    if (test_bit(RFS_INODE_EXPAND, &rinode->flags)) {
+        if (rcu_walk)
+            return -ECHILD;
+
+        /* a failure leaves the bit set and the attachment is retried */
+        rfs_dcache_expand(rinode);
+    }
+#endif
+
+    rinfo = rfs_inode_read_rinfo(rinode, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
 
     if (S_ISREG(inode->i_mode))
         rargs.type.id = REDIRFS_REG_IOP_PERMISSION;
@@ -1377,6 +1551,12 @@ static int rfs_permission(struct inode *inode, int mask)
     rargs.args.i_permission.inode = inode;
     rargs.args.i_permission.mask = mask;
 
+    if (rcu_walk && RFS_IS_IOP_SET(rinode, rargs.type.id) &&
+        rfs_chain_may_block(rinfo->rchain, &rcont, rargs.type.id)) {
+        rargs.rv.rv_int = -ECHILD;
+        goto exit;
+    }
+
     if (!RFS_IS_IOP_SET(rinode, rargs.type.id) ||
         !rfs_precall_flts(rinfo->rchain, &rcont, &rargs)) {
         if (rinode->op_old && rinode->op_old->permission)
@@ -1392,10 +1572,12 @@ static int rfs_permission(struct inode *inode, int mask)
     if (RFS_IS_IOP_SET(rinode, rargs.type.id))
         rfs_postcall_flts(rinfo->rchain, &rcont, &rargs);
 
+exit:
     rfs_context_deinit(&rcont);
 
-    rfs_inode_put(rinode);
-    rfs_info_put(rinfo);
+    if (!rcu_walk)
+        rfs_inode_put(rinode);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 
@@ -1429,12 +1611,14 @@ static int rfs_setattr(struct dentry *dentry, struct iattr *iattr)
 {
     struct rfs_inode *rinode;
     struct rfs_info *rinfo;
+    int rinfo_idx;
     struct rfs_context rcont;
     RFS_DEFINE_REDIRFS_ARGS(rargs);
 
     rinode = rfs_inode_find(dentry->d_inode);
-    rinfo = rfs_inode_get_rinfo(rinode);
+    rinfo = rfs_inode_read_rinfo(rinode, &rinfo_idx);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
 
     if (S_ISREG(dentry->d_inode->i_mode))
         rargs.type.id = REDIRFS_REG_IOP_SETATTR;
@@ -1472,7 +1656,7 @@ static int rfs_setattr(struct dentry *dentry, struct iattr *iattr)
     rfs_context_deinit(&rcont);
 
     rfs_inode_put(rinode);
-    rfs_info_put(rinfo);
+    rfs_info_read_done(rinfo, rinfo_idx);
     return rargs.rv.rv_int;
 }
 
@@ -1557,10 +1741,12 @@ int rfs_rename(struct inode *old_dir, struct dentry *old_dentry,
 
     rfs_context_init(&rcont_old, 0);
     rinode_old = rfs_inode_find(old_dir);
+    rcont_old.rinode = rinode_old;
     rinfo_old = rfs_inode_get_rinfo(rinode_old);
 
     rfs_context_init(&rcont_new, 0);
     rinode_new = rfs_inode_find(new_dir);
+    rcont_new.rinode = rinode_new;
 
     if (rinode_new)
         rinfo_new = rfs_inode_get_rinfo(rinode_new);
@@ -1635,10 +1821,12 @@ int rfs_rename(struct inode *old_dir, struct dentry *old_dentry,
 
     rfs_context_init(&rcont_old, 0);
     rinode_old = rfs_inode_find(old_dir);
+    rcont_old.rinode = rinode_old;
     rinfo_old = rfs_inode_get_rinfo(rinode_old);
 
     rfs_context_init(&rcont_new, 0);
     rinode_new = rfs_inode_find(new_dir);
+    rcont_new.rinode = rinode_new;
 
     if (rinode_new)
         rinfo_new = rfs_inode_get_rinfo(rinode_new);
@@ -1725,6 +1913,7 @@ int rfs_atomic_open(struct inode *inode, struct dentry *dentry, struct file *fil
     rinode = rfs_inode_find(inode);
     rinfo = rfs_inode_get_rinfo(rinode);
     rfs_context_init(&rcont, 0);
+    rcont.rinode = rinode;
     rargs.type.id = REDIRFS_DIR_IOP_ATOMIC_OPEN;
     rargs.args.i_atomic_open.inode = inode;
     rargs.args.i_atomic_open.dentry = dentry;
@@ -1785,8 +1974,21 @@ static void rfs_inode_set_ops_reg(struct rfs_inode *rinode)
     RFS_SET_IOP(rinode, REDIRFS_REG_IOP_PERMISSION, permission, rfs_permission);
     RFS_SET_IOP(rinode, REDIRFS_REG_IOP_SETATTR, setattr, rfs_setattr);
 
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(5,19,0))
     RFS_SET_AOP(rinode, REDIRFS_REG_AOP_READPAGE, readpage, rfs_readpage);
+#else
+    RFS_SET_AOP(rinode, REDIRFS_REG_AOP_READ_FOLIO, read_folio, rfs_read_folio);
+    RFS_SET_AOP(rinode, REDIRFS_REG_AOP_RELEASE_FOLIO, release_folio, rfs_release_folio);
+#endif
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(5,18,0))
     RFS_SET_AOP(rinode, REDIRFS_REG_AOP_READPAGES, readpages, rfs_readpages);
+#else
+    RFS_SET_AOP(rinode, REDIRFS_REG_AOP_DIRTY_FOLIO, dirty_folio, rfs_dirty_folio);
+    RFS_SET_AOP(rinode, REDIRFS_REG_AOP_INVALIDATE_FOLIO, invalidate_folio, rfs_invalidate_folio);
+#endif
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5,8,0))
+    RFS_SET_AOP(rinode, REDIRFS_REG_AOP_READAHEAD, readahead, rfs_readahead);
+#endif
     RFS_SET_AOP(rinode, RFS_OP_IDC(RFS_INODE_REG, RFS_OP_a_writepages), writepages, rfs_writepages);
 }
 
@@ -1794,7 +1996,16 @@ static void rfs_inode_set_ops_dir(struct rfs_inode *rinode)
 {
     RFS_SET_IOP(rinode, REDIRFS_DIR_IOP_UNLINK, unlink, rfs_unlink);
     RFS_SET_IOP(rinode, REDIRFS_DIR_IOP_RMDIR, rmdir, rfs_rmdir);
+#ifdef RFS_LAZY_ATTACH
+    /* the children of a lazily attached directory are attached in permission */
+    if (test_bit(RFS_INODE_EXPAND, &rinode->flags)) {
+        RFS_SET_IOP_MGT(rinode, REDIRFS_DIR_IOP_PERMISSION, permission, rfs_permission);
+    } else {
+        RFS_SET_IOP(rinode, REDIRFS_DIR_IOP_PERMISSION, permission, rfs_permission);
+    }
+#else
     RFS_SET_IOP(rinode, REDIRFS_DIR_IOP_PERMISSION, permission, rfs_permission);
+#endif
     RFS_SET_IOP(rinode, REDIRFS_DIR_IOP_SETATTR, setattr, rfs_setattr);
 
     RFS_SET_IOP_MGT(rinode, REDIRFS_DIR_IOP_CREATE, create, rfs_create);
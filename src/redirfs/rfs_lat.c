@@ -0,0 +1,257 @@
+/*
+ * RedirFS: Redirecting File System
+ *
+ * This file is part of RedirFS.
+ *
+ * RedirFS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * RedirFS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with RedirFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "rfs.h"
+
+#ifdef RFS_DBG
+    #pragma GCC push_options
+    #pragma GCC optimize ("O0")
+#endif // RFS_DBG
+
+#ifdef RFS_LAT_STATIC_KEY
+DEFINE_STATIC_KEY_FALSE(rfs_lat_key);
+static bool rfs_lat_on;
+#else
+bool rfs_lat_on __read_mostly;
+#endif
+
+/*
+ * the histograms of the original operations, allocated with the first filter
+ * histograms for an inode type and kept as redirfs is never unloaded
+ */
+static struct rfs_lat_ops __percpu *rfs_lat_ops[RFS_INODE_MAX];
+
+/*
+ * The histograms are allocated for the inode types the filter has callbacks
+ * for, so a filter does not pay for the whole operation table on each CPU.
+ * Called with rfs_flt_list_mutex held, the hooks read the pointers without
+ * any lock and skip the types which have none yet.
+ */
+int rfs_lat_flt_alloc(struct rfs_flt *rflt)
+{
+    struct rfs_lat_flt __percpu *lat;
+    struct rfs_lat_ops __percpu *ops;
+    int it, op_id;
+
+    for (it = 0; it < RFS_INODE_MAX; it++) {
+        for (op_id = 0; op_id < RFS_OP_MAX; op_id++) {
+            if (rflt->cbs[it][op_id].pre_cb ||
+                rflt->cbs[it][op_id].post_cb)
+                break;
+        }
+
+        if (op_id == RFS_OP_MAX)
+            continue;
+
+        if (!rfs_lat_ops[it]) {
+            ops = alloc_percpu(struct rfs_lat_ops);
+            if (!ops)
+                return -ENOMEM;
+            rcu_assign_pointer(rfs_lat_ops[it], ops);
+        }
+
+        if (!rflt->lat[it]) {
+            lat = alloc_percpu(struct rfs_lat_flt);
+            if (!lat)
+                return -ENOMEM;
+            rcu_assign_pointer(rflt->lat[it], lat);
+        }
+    }
+
+    return 0;
+}
+
+void rfs_lat_flt_free(struct rfs_flt *rflt)
+{
+    int it;
+
+    for (it = 0; it < RFS_INODE_MAX; it++) {
+        if (rflt->lat[it])
+            free_percpu(rflt->lat[it]);
+        rflt->lat[it] = NULL;
+    }
+}
+
+/* called with rfs_flt_list_mutex held, the histograms are kept when off */
+void rfs_lat_switch(bool on)
+{
+    if (rfs_lat_on == on)
+        return;
+
+    rfs_lat_on = on;
+
+#ifdef RFS_LAT_STATIC_KEY
+    if (on)
+        static_branch_enable(&rfs_lat_key);
+    else
+        static_branch_disable(&rfs_lat_key);
+#endif
+}
+
+bool rfs_lat_active(void)
+{
+    return rfs_lat_on;
+}
+
+static inline unsigned int rfs_lat_bucket(u64 start)
+{
+    u64 ns = ktime_to_ns(ktime_get());
+
+    if (ns <= start)
+        return 0;
+
+    ns = (ns - start) >> RFS_LAT_SHIFT;
+    if (!ns)
+        return 0;
+
+    return min_t(unsigned int, fls64(ns), RFS_LAT_BUCKETS - 1);
+}
+
+void rfs_lat_flt_record(struct rfs_flt *rflt, enum rfs_inode_type it,
+        enum rfs_op_id op_id, int call, u64 start)
+{
+    struct rfs_lat_flt __percpu *lat;
+
+    lat = rcu_dereference_raw(rflt->lat[it]);
+    if (!lat)
+        return;
+
+    this_cpu_inc(lat->hist[op_id][call].buckets[rfs_lat_bucket(start)]);
+}
+
+void rfs_lat_op_record(enum rfs_inode_type it, enum rfs_op_id op_id,
+        u64 start)
+{
+    struct rfs_lat_ops __percpu *ops;
+
+    ops = rcu_dereference_raw(rfs_lat_ops[it]);
+    if (!ops)
+        return;
+
+    this_cpu_inc(ops->hist[op_id].buckets[rfs_lat_bucket(start)]);
+}
+
+/*
+ * sums a histogram over the CPUs, the counters are read without stopping the
+ * writers so a sum may miss the calls recorded meanwhile
+ */
+static bool rfs_lat_hist_sum(struct rfs_lat_hist __percpu *hist,
+        u64 *sum)
+{
+    struct rfs_lat_hist *h;
+    bool used = false;
+    int cpu;
+    int i;
+
+    memset(sum, 0, sizeof(u64) * RFS_LAT_BUCKETS);
+
+    for_each_possible_cpu(cpu) {
+        h = per_cpu_ptr(hist, cpu);
+        for (i = 0; i < RFS_LAT_BUCKETS; i++)
+            sum[i] += h->buckets[i];
+    }
+
+    for (i = 0; i < RFS_LAT_BUCKETS; i++) {
+        if (sum[i])
+            used = true;
+    }
+
+    return used;
+}
+
+static ssize_t rfs_lat_hist_show(char *buf, ssize_t size,
+        enum rfs_inode_type it, enum rfs_op_id op_id, const char *call,
+        struct rfs_lat_hist __percpu *hist)
+{
+    u64 sum[RFS_LAT_BUCKETS];
+    ssize_t len;
+    int i;
+
+    if (!rfs_lat_hist_sum(hist, sum))
+        return 0;
+
+    len = snprintf(buf, size, "0x%05x %s", RFS_OP_IDC(it, op_id), call);
+
+    for (i = 0; i < RFS_LAT_BUCKETS && len < size; i++)
+        len += snprintf(buf + len, size - len, " %llu",
+                (unsigned long long)sum[i]);
+
+    if (len < size)
+        len += snprintf(buf + len, size - len, "\n");
+
+    return len;
+}
+
+static ssize_t rfs_lat_header(char *buf, ssize_t size)
+{
+    return snprintf(buf, size, "enabled: %d\n"
+            "# idc call, bucket n counts calls of [2^(n+5), 2^(n+6)) ns\n",
+            rfs_lat_on);
+}
+
+ssize_t rfs_lat_flt_show(struct rfs_flt *rflt, char *buf, ssize_t size)
+{
+    struct rfs_lat_flt __percpu *lat;
+    ssize_t len;
+    int it, op_id;
+
+    len = rfs_lat_header(buf, size);
+
+    for (it = 0; it < RFS_INODE_MAX; it++) {
+        lat = rcu_dereference_raw(rflt->lat[it]);
+        if (!lat)
+            continue;
+
+        for (op_id = 0; op_id < RFS_OP_MAX && len < size; op_id++) {
+            len += rfs_lat_hist_show(buf + len, size - len, it, op_id, "pre",
+                    &lat->hist[op_id][RFS_LAT_PRE]);
+            if (len >= size)
+                break;
+            len += rfs_lat_hist_show(buf + len, size - len, it, op_id, "post",
+                    &lat->hist[op_id][RFS_LAT_POST]);
+        }
+    }
+
+    return min(len, size - 1);
+}
+
+ssize_t rfs_lat_ops_show(char *buf, ssize_t size)
+{
+    struct rfs_lat_ops __percpu *ops;
+    ssize_t len;
+    int it, op_id;
+
+    len = rfs_lat_header(buf, size);
+
+    for (it = 0; it < RFS_INODE_MAX; it++) {
+        ops = rcu_dereference_raw(rfs_lat_ops[it]);
+        if (!ops)
+            continue;
+
+        for (op_id = 0; op_id < RFS_OP_MAX && len < size; op_id++)
+            len += rfs_lat_hist_show(buf + len, size - len, it, op_id, "op",
+                    &ops->hist[op_id]);
+    }
+
+    return min(len, size - 1);
+}
+
+#ifdef RFS_DBG
+    #pragma GCC pop_options
+#endif // RFS_DBG
@@ -23,6 +23,8 @@
 #include <linux/rculist.h>
 #include <linux/version.h>
 #include <linux/gfp.h>
+#include <linux/percpu.h>
+#include <linux/workqueue.h>
 #include "rfs_object.h"
 #include "rfs_dbg.h"
 
@@ -44,13 +46,61 @@ struct rfs_objects_debug_info {
     /* protects the list */
     spinlock_t          lock;
 #endif /* RFS_DBG */
-
-    /* counts allocated objects */
-    atomic_t            objects_count;
 };
 
 static struct rfs_objects_debug_info   rfs_objects_debug_info[RFS_TYPE_MAX];
 
+/*---------------------------------------------------------------------------*/
+
+/*
+ * the statistics are per cpu counters which only grow, the differences are
+ * computed when they are read, so the hot paths do not share a cache line
+ */
+struct rfs_object_stat {
+    unsigned long   allocs;
+    unsigned long   frees;
+    /* the last reference was dropped, the free waits for RCU */
+    unsigned long   releases;
+    unsigned long   inserts;
+    unsigned long   removes;
+    unsigned long   hits;
+    unsigned long   misses;
+    /* added on allocation and subtracted on free, only the sum is valid */
+    long            bytes;
+};
+
+struct rfs_object_stats {
+    struct rfs_object_stat  type[RFS_TYPE_MAX];
+};
+
+static DEFINE_PER_CPU(struct rfs_object_stats, rfs_object_stats);
+
+#define rfs_object_stat_inc(t, member) \
+    this_cpu_inc(rfs_object_stats.type[t].member)
+
+static void
+rfs_object_stat_sum(
+    enum rfs_type           type,
+    struct rfs_object_stat  *sum)
+{
+    struct rfs_object_stat  *stat;
+    int                     cpu;
+
+    memset(sum, 0, sizeof(*sum));
+
+    for_each_possible_cpu(cpu) {
+        stat = &per_cpu(rfs_object_stats, cpu).type[type];
+        sum->allocs += stat->allocs;
+        sum->frees += stat->frees;
+        sum->releases += stat->releases;
+        sum->inserts += stat->inserts;
+        sum->removes += stat->removes;
+        sum->hits += stat->hits;
+        sum->misses += stat->misses;
+        sum->bytes += stat->bytes;
+    }
+}
+
 void rfs_object_susbsystem_init(void)
 {
 #ifdef RFS_DBG
@@ -64,13 +114,6 @@ void rfs_object_susbsystem_init(void)
 
 /*---------------------------------------------------------------------------*/
 
-/* forward definitions */
-static void
-rfs_object_put_rcu(
-    struct rcu_head *rcu_head);
-
-/*---------------------------------------------------------------------------*/
-
 static const char* rfs_type_to_string[RFS_TYPE_MAX] = {
     [RFS_TYPE_UNKNOWN] = "RFS_TYPE_UNKNOWN",
     [RFS_TYPE_RINODE] = "RFS_TYPE_RINODE",
@@ -86,28 +129,41 @@ static const char* rfs_type_to_string[RFS_TYPE_MAX] = {
 
 #ifdef RFS_USE_HASHTABLE
 
-void
+static const struct rhashtable_params rfs_object_table_params = {
+    .head_offset = offsetof(struct rfs_object, hash_node),
+    .key_offset = offsetof(struct rfs_object, system_object),
+    .key_len = sizeof(void *),
+    .automatic_shrinking = true,
+};
+
+/* the tables of the known types, for the statistics */
+static struct rfs_object_table *rfs_object_tables[RFS_TYPE_MAX];
+
+int
 rfs_object_table_init(
     struct rfs_object_table *table)
 {
-    int i;
+    int err;
 
     DBG_BUG_ON(table->rfs_type >= RFS_TYPE_MAX);
-    DBG_BUG_ON(!table->array_size);
 
-    for (i=0; i < table->array_size; ++i) {
-        INIT_LIST_HEAD_RCU(&table->array[i].hash_list_head);
-        spin_lock_init(&table->array[i].lock);
-    }
-}
+    err = rhashtable_init(&table->ht, &rfs_object_table_params);
+    if (!err && table->rfs_type != RFS_TYPE_UNKNOWN)
+        rfs_object_tables[table->rfs_type] = table;
 
-/*---------------------------------------------------------------------------*/
+    return err;
+}
 
-static struct rfs_object_table_entry* rfs_object_hash_entry(
-    struct rfs_object_table *table,
-    void* system_object)
+void
+rfs_object_table_destroy(
+    struct rfs_object_table *table)
 {
-    return &table->array[table->index((unsigned long)system_object)];
+    DBG_BUG_ON(atomic_read(&table->ht.nelems));
+
+    if (rfs_object_tables[table->rfs_type] == table)
+        rfs_object_tables[table->rfs_type] = NULL;
+
+    rhashtable_destroy(&table->ht);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -117,43 +173,57 @@ rfs_get_object_by_system_object(
     struct rfs_object_table *rfs_object_table,
     const void              *system_object)
 {
-    struct rfs_object_table_entry   *table_entry;
-
-    DBG_BUG_ON(!system_object);
+    struct rfs_object*  object;
 
-    table_entry = rfs_object_hash_entry(rfs_object_table, system_object);
+    DBG_BUG_ON(!system_object && rfs_object_table->rfs_type != RFS_TYPE_DENTRY_OPS);
 
     rcu_read_lock();
     { /* start of the RCU lock */
-        struct rfs_object *rfs_object;
-
-        list_for_each_entry_rcu(rfs_object, &table_entry->hash_list_head, hash_list_entry) {
+        object = rhashtable_lookup_fast(&rfs_object_table->ht,
+                                        &system_object,
+                                        rfs_object_table_params);
+        if (object) {
+            DBG_BUG_ON(RFS_OBJECT_SIGNATURE != object->signature);
+            DBG_BUG_ON(object->type->type != rfs_object_table->rfs_type &&
+                       rfs_object_table->rfs_type != RFS_TYPE_UNKNOWN);
 
             /*
-             * it is possible to hit an object with zero reference count, 
-             * this is an object waiting RCU grace period expiration
-             * to be removed, such objects have system_object set to NULL
-             * and hash_list_head.prev set to invalid value
+             * the table's reference is dropped when the object is
+             * removed, a concurrently removed object is skipped
              */
-            DBG_BUG_ON(!refcount_read(&rfs_object->refcount) &&
-                       rcu_access_pointer(rfs_object->system_object));
-            DBG_BUG_ON(RFS_OBJECT_SIGNATURE != rfs_object->signature);
-            DBG_BUG_ON(rfs_object->type->type != rfs_object_table->rfs_type &&
-                       rfs_object_table->rfs_type != RFS_TYPE_UNKNOWN);
+            if (!refcount_inc_not_zero(&object->refcount))
+                object = NULL;
+        }
+    } /* end of the RCU lock */
+    rcu_read_unlock();
 
-            if (rcu_access_pointer(rfs_object->system_object) == system_object){
+    if (object)
+        rfs_object_stat_inc(rfs_object_table->rfs_type, hits);
+    else
+        rfs_object_stat_inc(rfs_object_table->rfs_type, misses);
 
-                /* bump the reference count */
-                rfs_object_get(rfs_object);
-                rcu_read_unlock();
-                return rfs_object;
-            }
-        } /* end list_for_each_entry */
+    return object;
+}
 
-    } /* end of the RCU lock */
-    rcu_read_unlock();
+/*
+ * the object is freed after the RCU grace period following the drop of
+ * the table's reference, so it is valid until the caller's rcu_read_unlock
+ */
+struct rfs_object*
+rfs_find_object_by_system_object_rcu(
+    struct rfs_object_table *rfs_object_table,
+    const void              *system_object)
+{
+    struct rfs_object*  object;
+
+    RCU_LOCKDEP_WARN(!rcu_read_lock_held(), "rfs object lookup without RCU");
 
-    return NULL;
+    object = rhashtable_lookup(&rfs_object_table->ht,
+                               &system_object,
+                               rfs_object_table_params);
+
+    DBG_BUG_ON(object && RFS_OBJECT_SIGNATURE != object->signature);
+    return object;
 }
 
 /*---------------------------------------------------------------------------*/
@@ -162,83 +232,85 @@ int rfs_insert_object(
     struct rfs_object_table *rfs_object_table,
     struct rfs_object       *rfs_object,
     bool                    check_for_duplicate)
-/*
-* -EEXIST is returned in case of a duplicate
-*/
 {
-    int error = 0;
-    struct rfs_object_table_entry   *table_entry;
-    void *system_object;
+    int    err;
 
     DBG_BUG_ON(RFS_OBJECT_SIGNATURE != rfs_object->signature);
     DBG_BUG_ON(!refcount_read(&rfs_object->refcount));
-    DBG_BUG_ON(!rcu_access_pointer(rfs_object->system_object));
     DBG_BUG_ON(rfs_object->type->type >= RFS_TYPE_MAX);
-    DBG_BUG_ON(!list_empty(&rfs_object->hash_list_entry));
 
-    system_object = rcu_access_pointer(rfs_object->system_object);
-    table_entry = rfs_object_hash_entry(rfs_object_table, system_object);
+    do {
+        /* the object is retained by the table */
+        rfs_object_get(rfs_object);
 
-    /* bump the reference count */
-    rfs_object_get(rfs_object);
+        DBG_BUG_ON(rfs_object->object_table);
+        rfs_object->object_table = rfs_object_table;
 
-    DBG_BUG_ON(rfs_object->object_table);
-    rfs_object->object_table = rfs_object_table;
+        err = rhashtable_lookup_insert_fast(&rfs_object_table->ht,
+                                            &rfs_object->hash_node,
+                                            rfs_object_table_params);
+        if (err) {
+            rfs_object->object_table = NULL;
+            rfs_object_put(rfs_object);
+        } else
+            rfs_object_stat_inc(rfs_object_table->rfs_type, inserts);
 
-    /* spin_lock can't synchronize user context with softirq */
-    DBG_BUG_ON(rfs_in_softirq());
+        /*
+         * a stalled object whose release hook was not called,
+         * see the comment in the radix tree rfs_insert_object
+         */
+        if (-EEXIST == err) {
 
-    spin_lock(&table_entry->lock);
-    { /* start of the lock */
+            struct rfs_object*  robj_to_remove;
 
-#ifdef RFS_DBG
-        {
-#else
-        if (check_for_duplicate) {
-#endif
-            struct rfs_object *found_rfs_object;
-            list_for_each_entry_rcu(found_rfs_object, &table_entry->hash_list_head, hash_list_entry) {
+            printk(KERN_CRIT"EEXIST error in rfs_insert_object [%lx][%s]\n",
+                   (unsigned long)rfs_object->system_object,
+                   rfs_type_to_string[rfs_object_table->rfs_type]);
+
+            robj_to_remove = rfs_get_object_by_system_object(
+                                        rfs_object_table,
+                                        rfs_object->system_object);
+            if (robj_to_remove) {
 
-                DBG_BUG_ON(RFS_OBJECT_SIGNATURE != found_rfs_object->signature);
-                DBG_BUG_ON(!refcount_read(&found_rfs_object->refcount) &&
-                           rcu_access_pointer(rfs_object->system_object));
+                DBG_BUG_ON(robj_to_remove == rfs_object);
 
-                if (system_object == rcu_access_pointer(found_rfs_object->system_object)) {
-                    DBG_BUG_ON(!check_for_duplicate);
-                    error = -EEXIST;
-                    break;
+                if (robj_to_remove != rfs_object) {
+                    rfs_remove_object(robj_to_remove);
+                } else {
+                    err = 0; /* carry on */
                 }
-            } /* end list_for_each_entry */
-        } /* end if (check_for_duplicate) */
 
-        if (!error) {
-            list_add_rcu(&rfs_object->hash_list_entry, &table_entry->hash_list_head);
+                rfs_object_put(robj_to_remove);
+            }
         }
+    } while (-EEXIST == err);
 
-    } /* end of the lock */
-    spin_unlock(&table_entry->lock);
-
-    /* undo in case of error */
-    if (error)
-        rfs_object_put(rfs_object);
-
-    DBG_BUG_ON(!refcount_read(&rfs_object->refcount));
-
-    return error;
+    return err;
 }
 
 void
 rfs_remove_object(
     struct rfs_object       *rfs_object)
 {
-    struct rfs_object_table_entry   *table_entry;
+    struct rfs_object_table *rfs_object_table;
+    int                     err;
 
     DBG_BUG_ON(RFS_OBJECT_SIGNATURE != rfs_object->signature);
 
-    table_entry = rfs_object_hash_entry( rfs_object->object_table,
-                        rcu_access_pointer(rfs_object->system_object));
+    rfs_object_table = rfs_object->object_table;
+    if (!rfs_object_table)
+        return;
+
+    /* the key is hashed to find the bucket so it is cleared afterwards */
+    err = rhashtable_remove_fast(&rfs_object_table->ht,
+                                 &rfs_object->hash_node,
+                                 rfs_object_table_params);
+    DBG_BUG_ON(err);
+    if (err)
+        return;
 
-    DBG_BUG_ON(LIST_POISON2 == rfs_object->hash_list_entry.prev);
+    rfs_object->object_table = NULL;
+    rfs_object_stat_inc(rfs_object_table->rfs_type, removes);
 
     /*
      * make the object non discoverable, 
@@ -247,23 +319,12 @@ rfs_remove_object(
      */
     rcu_assign_pointer(rfs_object->system_object, NULL);
 
-    /* spin_lock can't synchronize user context with softirq */
-    DBG_BUG_ON(rfs_in_softirq());
-
-    spin_lock(&table_entry->lock);
-    { /* start of the lock */
-        list_del_rcu(&rfs_object->hash_list_entry);
-    } /* end of the lock */
-    spin_unlock(&table_entry->lock);
-
-    rfs_object->object_table = NULL;
-
     /*
-     * call the rfs_object_put after all current readers completed with
-     * rfs_object_get to prevent reference counter dropping to zero before
-     * being bumped again
+     * the lookups do not reference an object with a zero count and the
+     * memory is freed after the RCU grace period, so the table's reference
+     * is released immediately
      */
-    call_rcu(&rfs_object->rcu_head, rfs_object_put_rcu);
+    rfs_object_put(rfs_object);
 }
 
 #else /* RFS_USE_HASHTABLE */
@@ -283,11 +344,29 @@ rfs_get_object_by_system_object(
     rcu_read_lock();
     { /* start of the RCU lock */
         object = radix_tree_lookup(&radix_tree->root, (long)system_object);
-        if (object)
-            rfs_object_get(object);
+        if (object && !refcount_inc_not_zero(&object->refcount))
+            object = NULL;
     } /* end of the RCU lock */
     rcu_read_unlock();
 
+    if (object)
+        rfs_object_stat_inc(radix_tree->rfs_type, hits);
+    else
+        rfs_object_stat_inc(radix_tree->rfs_type, misses);
+
+    return object;
+}
+
+struct rfs_object*
+rfs_find_object_by_system_object_rcu(
+    struct rfs_radix_tree   *radix_tree,
+    const void              *system_object)
+{
+    struct rfs_object*  object;
+
+    object = radix_tree_lookup(&radix_tree->root, (long)system_object);
+
+    DBG_BUG_ON(object && RFS_OBJECT_SIGNATURE != object->signature);
     return object;
 }
 
@@ -327,7 +406,8 @@ int rfs_insert_object(
                 {
                     rfs_object->radix_tree = NULL;
                     rfs_object_put(rfs_object);
-                }
+                } else
+                    rfs_object_stat_inc(radix_tree->rfs_type, inserts);
 
             } /* end of the RCU lock */
             rcu_read_unlock();
@@ -398,13 +478,10 @@ rfs_remove_object(
         if (removed) {
 
             rfs_object->radix_tree = NULL;
+            rfs_object_stat_inc(radix_tree->rfs_type, removes);
 
-            /*
-             * call the rfs_object_put after all current readers completed with
-             * rfs_object_get to prevent reference counter dropping to zero before
-             * being bumped again
-             */
-            call_rcu(&rfs_object->rcu_head, rfs_object_put_rcu);
+            /* see the hash table rfs_remove_object */
+            rfs_object_put(rfs_object);
         }
     }
     
@@ -412,19 +489,6 @@ rfs_remove_object(
 
 #endif /* !RFS_USE_HASHTABLE */
 
-/*---------------------------------------------------------------------------*/
-
-static void
-rfs_object_put_rcu(
-    struct rcu_head *rcu_head)
-{
-    struct rfs_object *rfs_object;
-
-    rfs_object = container_of(rcu_head, struct rfs_object, rcu_head);
-    DBG_BUG_ON(RFS_OBJECT_SIGNATURE != rfs_object->signature);
-
-    rfs_object_put(rfs_object);
-}
 
 /*---------------------------------------------------------------------------*/
 
@@ -442,7 +506,7 @@ rfs_object_init(
     DBG_BUG_ON(!system_object && type->type != RFS_TYPE_DENTRY_OPS);
 
 #ifdef RFS_USE_HASHTABLE
-    INIT_LIST_HEAD_RCU(&rfs_object->hash_list_entry);
+    rfs_object->object_table = NULL;
 #endif
     refcount_set(&rfs_object->refcount, 1);
     rfs_object->type = type;
@@ -450,7 +514,8 @@ rfs_object_init(
 
     DBG_BUG_ON(rfs_object->type->type >= ARRAY_SIZE(rfs_objects_debug_info));
     di = &rfs_objects_debug_info[rfs_object->type->type];
-    atomic_inc(&di->objects_count);
+    rfs_object_stat_inc(rfs_object->type->type, allocs);
+    this_cpu_add(rfs_object_stats.type[type->type].bytes, type->size);
 
 #ifdef RFS_DBG
     rfs_object->signature = RFS_OBJECT_SIGNATURE;
@@ -471,20 +536,19 @@ rfs_object_init(
 /*---------------------------------------------------------------------------*/
 
 static void
-rfs_object_free_rcu(
-    struct rcu_head *rcu_head)
+rfs_object_free(
+    struct rfs_object   *rfs_object)
 {
-    struct rfs_object *rfs_object;
     struct rfs_objects_debug_info  *di;
 
-    rfs_object = container_of(rcu_head, struct rfs_object, rcu_head);
     DBG_BUG_ON(RFS_OBJECT_SIGNATURE != rfs_object->signature);
 
     DBG_BUG_ON(rfs_object->type->type >= ARRAY_SIZE(rfs_objects_debug_info));
     di = &rfs_objects_debug_info[rfs_object->type->type];
 
-    DBG_BUG_ON(!atomic_read(&di->objects_count));
-    atomic_dec(&di->objects_count);
+    rfs_object_stat_inc(rfs_object->type->type, frees);
+    this_cpu_sub(rfs_object_stats.type[rfs_object->type->type].bytes,
+                 rfs_object->type->size);
 
 #ifdef RFS_DBG
     /* we are in a softirq context */
@@ -504,6 +568,105 @@ rfs_object_free_rcu(
     rfs_object->type->free(rfs_object);
 }
 
+#ifdef RFS_OBJECT_BATCH_FREE
+
+/* a batch is flushed when it reaches this size or after the delay */
+#define RFS_OBJECT_FREE_BATCH 64
+#define RFS_OBJECT_FREE_DELAY (HZ / 100 ? HZ / 100 : 1)
+
+static DEFINE_PER_CPU(struct llist_head, rfs_object_free_list);
+static DEFINE_PER_CPU(unsigned int, rfs_object_free_nr);
+
+static void rfs_object_free_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(rfs_object_free_work, rfs_object_free_work_fn);
+
+/* the batch is linked through free_node starting with the leader */
+static void
+rfs_object_free_batch_rcu(
+    struct rcu_head *rcu_head)
+{
+    struct rfs_object *rfs_object;
+    struct rfs_object *next;
+
+    rfs_object = container_of(rcu_head, struct rfs_object, rcu_head);
+
+    llist_for_each_entry_safe(rfs_object, next, &rfs_object->free_node,
+                              free_node) {
+        rfs_object_free(rfs_object);
+    }
+}
+
+static void
+rfs_object_free_batch(
+    struct llist_head   *head)
+{
+    struct llist_node   *nodes;
+    struct rfs_object   *leader;
+
+    nodes = llist_del_all(head);
+    if (!nodes)
+        return;
+
+    leader = llist_entry(nodes, struct rfs_object, free_node);
+    call_rcu(&leader->rcu_head, rfs_object_free_batch_rcu);
+}
+
+static void rfs_object_free_work_fn(struct work_struct *work)
+{
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        per_cpu(rfs_object_free_nr, cpu) = 0;
+        rfs_object_free_batch(per_cpu_ptr(&rfs_object_free_list, cpu));
+    }
+}
+
+/* called from any context, including softirq */
+static void
+rfs_object_queue_free(
+    struct rfs_object   *rfs_object)
+{
+    struct llist_head   *head;
+    bool                first;
+
+    head = get_cpu_ptr(&rfs_object_free_list);
+    {
+        first = llist_add(&rfs_object->free_node, head);
+
+        if (this_cpu_inc_return(rfs_object_free_nr) >= RFS_OBJECT_FREE_BATCH) {
+            this_cpu_write(rfs_object_free_nr, 0);
+            rfs_object_free_batch(head);
+        } else if (first) {
+            schedule_delayed_work(&rfs_object_free_work,
+                                  RFS_OBJECT_FREE_DELAY);
+        }
+    }
+    put_cpu_ptr(&rfs_object_free_list);
+}
+
+void rfs_object_free_flush(void)
+{
+    cancel_delayed_work_sync(&rfs_object_free_work);
+    rfs_object_free_work_fn(NULL);
+    rcu_barrier();
+}
+
+#else /* RFS_OBJECT_BATCH_FREE */
+
+static void
+rfs_object_free_rcu(
+    struct rcu_head *rcu_head)
+{
+    rfs_object_free(container_of(rcu_head, struct rfs_object, rcu_head));
+}
+
+void rfs_object_free_flush(void)
+{
+    rcu_barrier();
+}
+
+#endif /* !RFS_OBJECT_BATCH_FREE */
+
 /*---------------------------------------------------------------------------*/
 
 void
@@ -528,27 +691,58 @@ void rfs_object_put(
 
     if (refcount_dec_and_test(&rfs_object->refcount)) {
 #ifdef RFS_USE_HASHTABLE
-        /*
-         * the object must not be in the list, i.e. either never inserted
-         * or removed by list_del_rcu
-         */
-        DBG_BUG_ON(!list_empty(&rfs_object->hash_list_entry) && 
-                   LIST_POISON2 != rfs_object->hash_list_entry.prev);
+        /* the object must be either never inserted or removed */
         DBG_BUG_ON(rfs_object->object_table);
-
-        /* the object should be non discoverable */
-        DBG_BUG_ON(rfs_object->system_object && !list_empty(&rfs_object->hash_list_entry));
 #endif // RFS_USE_HASHTABLE
 
+        rfs_object_stat_inc(rfs_object->type->type, releases);
+
+#ifdef RFS_OBJECT_BATCH_FREE
+        rfs_object_queue_free(rfs_object);
+#else
         call_rcu(&rfs_object->rcu_head, rfs_object_free_rcu);
+#endif
     }
 }
 
 /*---------------------------------------------------------------------------*/
 
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,25))
+static unsigned int
+rfs_object_table_buckets(
+    enum rfs_type   type)
+{
+#ifdef RFS_USE_HASHTABLE
+    struct rfs_object_table *table = rfs_object_tables[type];
+    unsigned int            buckets = 0;
+
+    if (!table)
+        return 0;
+
+    rcu_read_lock();
+    buckets = rht_dereference_rcu(table->ht.tbl, &table->ht)->size;
+    rcu_read_unlock();
+
+    return buckets;
+#else
+    return 0;
+#endif
+}
+
+/* the allocation and free rates are computed since the previous read */
+static DEFINE_SPINLOCK(rfs_stat_lock);
+static unsigned long rfs_stat_jiffies;
+static unsigned long rfs_stat_allocs[RFS_TYPE_MAX];
+static unsigned long rfs_stat_frees[RFS_TYPE_MAX];
+
 ssize_t rfs_get_stat(char *buf, ssize_t size)
 {
+    struct rfs_object_stat sum;
+    unsigned long now = jiffies;
+    unsigned long elapsed;
+    unsigned long allocs_rate;
+    unsigned long frees_rate;
+    unsigned long live;
     ssize_t bytes = 0;
     int i;
 
@@ -556,13 +750,43 @@ ssize_t rfs_get_stat(char *buf, ssize_t size)
         return 0;
 
     buf[0] = '\0';
+
+    spin_lock(&rfs_stat_lock);
+
+    elapsed = now - rfs_stat_jiffies;
+    if (!elapsed)
+        elapsed = 1;
+
     for (i=0; i<RFS_TYPE_MAX; ++i) {
+        rfs_object_stat_sum(i, &sum);
+        live = sum.allocs - sum.frees;
+
+        allocs_rate = (sum.allocs - rfs_stat_allocs[i]) * HZ / elapsed;
+        frees_rate = (sum.frees - rfs_stat_frees[i]) * HZ / elapsed;
+        rfs_stat_allocs[i] = sum.allocs;
+        rfs_stat_frees[i] = sum.frees;
+
         bytes += snprintf(buf + bytes,
                     size - bytes,
-                    "[%s] = %u\n",
+                    "[%s] = %lu\n"
+                    "    bytes = %ld, allocs/s = %lu, frees/s = %lu, "
+                    "rcu pending = %lu\n"
+                    "    table = %lu, buckets = %u, hits = %lu, "
+                    "misses = %lu\n",
                     rfs_type_to_string[i],
-                    atomic_read(&rfs_objects_debug_info[i].objects_count));
+                    live,
+                    sum.bytes,
+                    allocs_rate, frees_rate,
+                    sum.releases - sum.frees,
+                    sum.inserts - sum.removes,
+                    rfs_object_table_buckets(i),
+                    sum.hits, sum.misses);
     }  /* end for */          
+
+    rfs_stat_jiffies = now;
+
+    spin_unlock(&rfs_stat_lock);
+
     return bytes;
 }
 #endif /* #if (LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,25)) */
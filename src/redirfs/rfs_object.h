@@ -23,6 +23,7 @@
 #ifndef _RFS_OBJECT_H
 #define _RFS_OBJECT_H
 
+#include <linux/version.h>
 #include <linux/types.h>
 #include <linux/list.h>
 
@@ -61,10 +62,37 @@ static inline unsigned int refcount_read(const refcount_t *r)
     return atomic_read(&r->refs);
 }
 
+static inline __must_check bool refcount_inc_not_zero(refcount_t *r)
+{
+    return atomic_inc_not_zero(&r->refs);
+}
+
 #endif //(LINUX_VERSION_CODE < KERNEL_VERSION(4,11,0)
 #include <linux/rcupdate.h>
 #include <linux/radix-tree.h>
 
+/*
+ * released objects are collected on per cpu lists and a whole list is freed
+ * by a single RCU callback instead of a callback per object
+ */
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(3,13,0))
+#define RFS_OBJECT_BATCH_FREE
+#include <linux/llist.h>
+#endif
+
+/*
+ * objects are looked up by a kernel pointer, a radix tree keyed by a pointer
+ * is sparse and deep so a resizable hash table is used when available,
+ * define RFS_USE_RADIX_TREE to use the radix tree anyway
+ */
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4,9,0)) && !defined(RFS_USE_RADIX_TREE)
+#define RFS_USE_HASHTABLE
+#endif
+
+#ifdef RFS_USE_HASHTABLE
+#include <linux/rhashtable.h>
+#endif
+
 enum rfs_type {
     RFS_TYPE_UNKNOWN,
     RFS_TYPE_RINODE,
@@ -80,16 +108,9 @@ enum rfs_type {
 
 #ifdef RFS_USE_HASHTABLE
 
-struct rfs_object_table_entry {
-    struct list_head   hash_list_head;
-    spinlock_t         lock;
-};
-
 struct rfs_object_table {
-    unsigned long (*index)(unsigned long key); /* returns index in the array for key */
-    enum rfs_type                  rfs_type;   /* objects type in the table, might be RFS_TYPE_UNKNOWN*/
-    unsigned long                  array_size; /* size of table_entries array */
-    struct rfs_object_table_entry  *array; /* pointer to an array */
+    struct rhashtable         ht;
+    enum rfs_type             rfs_type; /* objects type in the table, might be RFS_TYPE_UNKNOWN*/
 };
 
 #else
@@ -116,6 +137,11 @@ struct rfs_object {
     /* rcu callback list */
     struct rcu_head         rcu_head;
 
+#ifdef RFS_OBJECT_BATCH_FREE
+    /* a per cpu list of objects waiting for the RCU grace period */
+    struct llist_node       free_node;
+#endif
+
     /*
     * a pointer to a related system object
     * like inode, dentry, file etc, set to NULL
@@ -129,8 +155,8 @@ struct rfs_object {
     struct rfs_object_type  *type;
 
 #ifdef RFS_USE_HASHTABLE
-    /* hast table entry list, RCU */
-    struct list_head          hash_list_entry;
+    /* hash table linkage, keyed by system_object, RCU */
+    struct rhash_head         hash_node;
     struct rfs_object_table   *object_table;
 #else
     struct rfs_radix_tree     *radix_tree;
@@ -145,6 +171,9 @@ struct rfs_object_type {
 
     enum rfs_type type;
 
+    /* the size of the containing object, for the statistics */
+    size_t size;
+
     /*
      * free is called when the object reference count
      * drops to zero
@@ -167,9 +196,16 @@ void rfs_object_get(
 void rfs_object_put(
     struct rfs_object   *rfs_object);
 
+/* frees all released objects, must be called before destroying a cache */
+void rfs_object_free_flush(void);
+
 #ifdef RFS_USE_HASHTABLE
 
-void rfs_object_table_init(
+int rfs_object_table_init(
+    struct rfs_object_table *rfs_object_table);
+
+/* the table must be empty */
+void rfs_object_table_destroy(
     struct rfs_object_table *rfs_object_table);
 
 /* inserts an object in a table, the object is retained by the table */
@@ -183,8 +219,31 @@ struct rfs_object* rfs_get_object_by_system_object(
     struct rfs_object_table *rfs_object_table,
     const void              *system_object);
 
+/*
+ * looks up for an object without taking a reference, the caller holds
+ * rcu_read_lock and must not use the object after releasing it
+ */
+struct rfs_object* rfs_find_object_by_system_object_rcu(
+    struct rfs_object_table *rfs_object_table,
+    const void              *system_object);
+
 #else
 
+/*
+ * the tree needs no initialization, the object types define one table
+ * pointer for either backend so their code has no backend #ifdefs
+ */
+static inline int rfs_object_table_init(
+    struct rfs_radix_tree   *radix_tree)
+{
+    return 0;
+}
+
+static inline void rfs_object_table_destroy(
+    struct rfs_radix_tree   *radix_tree)
+{
+}
+
 /* inserts an object in a tree, the object is retained by the tree */
 int rfs_insert_object(
     struct rfs_radix_tree   *radix_tree,
@@ -196,6 +255,11 @@ struct rfs_object* rfs_get_object_by_system_object(
     struct rfs_radix_tree   *radix_tree,
     const void              *system_object);
 
+/* the same as above for the tree */
+struct rfs_object* rfs_find_object_by_system_object_rcu(
+    struct rfs_radix_tree   *radix_tree,
+    const void              *system_object);
+
 #endif
 
 /* removes object from a table and releases a reference */
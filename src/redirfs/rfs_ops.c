@@ -48,7 +48,7 @@ struct rfs_ops *rfs_ops_alloc(void)
 
     atomic_inc(&ops_allocations_count);
 
-    memset(rops->arr, 0, sizeof(rops->arr)) ;
+    memset(rops->bits, 0, sizeof(rops->bits));
     atomic_set(&rops->count, 1);
 
     return rops;
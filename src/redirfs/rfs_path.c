@@ -25,6 +25,8 @@
  */
 
 #include "rfs.h"
+#include <linux/hashtable.h>
+#include <linux/idr.h>
 
 #ifdef RFS_DBG
     #pragma GCC push_options
@@ -33,6 +35,9 @@
 
 static LIST_HEAD(rfs_path_list);
 RFS_DEFINE_MUTEX(rfs_path_mutex);
+/* paths indexed by dentry and by id, both protected by rfs_path_mutex */
+static DEFINE_HASHTABLE(rfs_path_table, 10);
+static DEFINE_IDR(rfs_path_idr);
 
 static struct rfs_path *rfs_path_alloc(struct vfsmount *mnt,
         struct dentry *dentry)
@@ -124,10 +129,10 @@ void rfs_path_put(struct rfs_path *rpath)
 struct rfs_path *rfs_path_find(struct vfsmount *mnt,
         struct dentry *dentry)
 {
-    struct rfs_path *rpath = NULL;
-    struct rfs_path *found = NULL;
+    struct rfs_path *rpath;
 
-    list_for_each_entry(rpath, &rfs_path_list, list) {
+    hash_for_each_possible(rfs_path_table, rpath, hnode,
+            (unsigned long)dentry) {
 #ifdef RFS_PATH_WITH_MNT
         if (rpath->mnt != mnt) 
             continue;
@@ -136,27 +141,18 @@ struct rfs_path *rfs_path_find(struct vfsmount *mnt,
         if (rpath->dentry != dentry)
             continue;
 
-        found = rfs_path_get(rpath);
-        break;
+        return rfs_path_get(rpath);
     }
 
-    return found;
+    return NULL;
 }
 
 struct rfs_path *rfs_path_find_id(int id)
 {
-    struct rfs_path *rpath = NULL;
-    struct rfs_path *found = NULL;
-
-    list_for_each_entry(rpath, &rfs_path_list, list) {
-        if (rpath->id != id)
-            continue;
-
-        found = rfs_path_get(rpath);
-        break;
-    }
+    if (id < 0)
+        return NULL;
 
-    return found;
+    return rfs_path_get(idr_find(&rfs_path_idr, id));
 }
 
 static int rfs_path_add_rroot(struct rfs_path *rpath)
@@ -183,32 +179,35 @@ static void rfs_path_rem_rroot(struct rfs_path *rpath)
 static void rfs_path_list_add(struct rfs_path *rpath)
 {
     list_add_tail(&rpath->list, &rfs_path_list);
+    hash_add(rfs_path_table, &rpath->hnode, (unsigned long)rpath->dentry);
     rfs_path_get(rpath);
 }
 
 static void rfs_path_list_rem(struct rfs_path *rpath)
 {
     list_del_init(&rpath->list);
+    hash_del(&rpath->hnode);
+    idr_remove(&rfs_path_idr, rpath->id);
     rfs_path_put(rpath);
 }
 
-static int rfs_path_get_id(void)
+static int rfs_path_get_id(struct rfs_path *rpath)
 {
-    struct rfs_path *rpath = NULL;
-    int i = 0;
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(3,9,0))
+    return idr_alloc(&rfs_path_idr, rpath, 0, 0, GFP_KERNEL);
+#else
+    int id;
+    int rv;
 
-mainloop:
-    while (i < INT_MAX) {
-        list_for_each_entry(rpath, &rfs_path_list, list) {
-            if (rpath->id == i) {
-                i++;
-                goto mainloop;
-            }
-        }
-        return i;
-    }
+    do {
+        if (!idr_pre_get(&rfs_path_idr, GFP_KERNEL))
+            return -ENOMEM;
 
-    return -1;
+        rv = idr_get_new(&rfs_path_idr, rpath, &id);
+    } while (rv == -EAGAIN);
+
+    return rv ? rv : id;
+#endif
 }
 
 static struct rfs_path *rfs_path_add(struct vfsmount *mnt,
@@ -222,18 +221,21 @@ static struct rfs_path *rfs_path_add(struct vfsmount *mnt,
     if (rpath)
         return rpath;
 
-    id = rfs_path_get_id();
-    if (id < 0)
-        return ERR_PTR(-EBUSY);
-
     rpath = rfs_path_alloc(mnt, dentry);
     if (IS_ERR(rpath))
         return rpath;
 
+    id = rfs_path_get_id(rpath);
+    if (id < 0) {
+        rfs_path_put(rpath);
+        return ERR_PTR(id == -ENOSPC ? -EBUSY : id);
+    }
+
     rpath->id = id;
 
     rv = rfs_path_add_rroot(rpath);
     if (rv) {
+        idr_remove(&rfs_path_idr, id);
         rfs_path_put(rpath);
         return ERR_PTR(rv);
     }
@@ -252,7 +254,7 @@ static void rfs_path_rem(struct rfs_path *rpath)
     rfs_path_list_rem(rpath);
 }
 
-static int rfs_path_add_dirs(struct dentry *dentry)
+static int rfs_path_add_dirs(struct dentry *dentry, int lazy)
 {
     struct rfs_inode *rinode;
 
@@ -262,7 +264,10 @@ static int rfs_path_add_dirs(struct dentry *dentry)
         return 0;
     }
 
-    return rfs_dcache_walk(dentry, rfs_dcache_add_dir, NULL);
+    if (lazy)
+        return rfs_dcache_add_dir_lazy(dentry);
+
+    return rfs_dcache_walk_parallel(dentry, rfs_dcache_add_dir, NULL);
 }
 
 static int rfs_path_check_fs(struct file_system_type *type)
@@ -291,7 +296,8 @@ static int rfs_path_add_include(struct rfs_path *rpath, struct rfs_flt *rflt)
     if (rfs_chain_find(rpath->rexch, rflt) != -1)
         return -EEXIST;
 
-    rv = rfs_path_add_dirs(rpath->dentry->d_sb->s_root);
+    rv = rfs_path_add_dirs(rpath->dentry->d_sb->s_root,
+            rpath->rroot->flags & RFS_ROOT_LAZY);
     if (rv)
         return rv;
 
@@ -312,6 +318,30 @@ static int rfs_path_add_include(struct rfs_path *rpath, struct rfs_flt *rflt)
     return 0;
 }
     
+static int rfs_path_add_include_lazy(struct rfs_path *rpath,
+        struct rfs_flt *rflt)
+{
+#ifdef RFS_LAZY_ATTACH
+    struct rfs_root *rroot = rpath->rroot;
+    int lazy = rroot->flags & RFS_ROOT_LAZY;
+    int rv;
+
+    /* a root with filters attached to its whole subtree stays eager */
+    if (!lazy && (rroot->rinch || rroot->rexch))
+        return rfs_path_add_include(rpath, rflt);
+
+    /* the root stays lazy, later walks over it attach only what is attached */
+    rroot->flags |= RFS_ROOT_LAZY;
+    rv = rfs_path_add_include(rpath, rflt);
+    if (rv && !lazy)
+        rroot->flags &= ~RFS_ROOT_LAZY;
+
+    return rv;
+#else
+    return -EOPNOTSUPP;
+#endif
+}
+
 static int rfs_path_add_exclude(struct rfs_path *rpath, struct rfs_flt *rflt)
 {
     struct rfs_chain *rexch;
@@ -417,6 +447,9 @@ redirfs_path redirfs_add_path(redirfs_filter filter,
     if (info->flags == REDIRFS_PATH_INCLUDE)
         rv = rfs_path_add_include(rpath, filter);
 
+    else if (info->flags == (REDIRFS_PATH_INCLUDE | REDIRFS_PATH_LAZY))
+        rv = rfs_path_add_include_lazy(rpath, filter);
+
     else if (info->flags == REDIRFS_PATH_EXCLUDE)
         rv = rfs_path_add_exclude(rpath, filter);
 
@@ -498,6 +531,14 @@ void redirfs_put_path(redirfs_path path)
     rfs_path_put(path);
 }
 
+static int rfs_path_has_flt(struct rfs_path *rpath, struct rfs_flt *rflt)
+{
+    if (rfs_chain_find(rpath->rinch, rflt) != -1)
+        return 1;
+
+    return rfs_chain_find(rpath->rexch, rflt) != -1;
+}
+
 redirfs_path* redirfs_get_paths_root(redirfs_filter filter, redirfs_root root)
 {
     struct rfs_root *rroot = (struct rfs_root *)root;
@@ -556,10 +597,7 @@ redirfs_path* redirfs_get_paths(redirfs_filter filter)
     }
 
     list_for_each_entry(rpath, &rfs_path_list, list) {
-        if (rfs_chain_find(rpath->rinch, filter) != -1)
-            paths[i++] = rfs_path_get(rpath);
-
-        else if (rfs_chain_find(rpath->rexch, filter) != -1)
+        if (rfs_path_has_flt(rpath, rflt))
             paths[i++] = rfs_path_get(rpath);
     }
 
@@ -569,6 +607,83 @@ redirfs_path* redirfs_get_paths(redirfs_filter filter)
     return paths;
 }
 
+/*
+ * iterator form of redirfs_get_paths, the reference to prev is dropped and
+ * the next path is returned referenced, NULL ends the walk, the walk
+ * continues by id so it survives prev being removed meanwhile
+ */
+redirfs_path redirfs_next_path(redirfs_filter filter, redirfs_path prev)
+{
+    struct rfs_flt *rflt = filter;
+    struct rfs_path *rpath;
+    struct rfs_path *found = NULL;
+    int id;
+
+    DBG_BUG_ON(!rfs_preemptible());
+    might_sleep();
+
+    if (!filter || IS_ERR(filter))
+        return ERR_PTR(-EINVAL);
+
+    id = prev ? ((struct rfs_path *)prev)->id + 1 : 0;
+
+    rfs_mutex_lock(&rfs_path_mutex);
+
+    while ((rpath = idr_get_next(&rfs_path_idr, &id))) {
+        if (rfs_path_has_flt(rpath, rflt)) {
+            found = rfs_path_get(rpath);
+            break;
+        }
+        id++;
+    }
+
+    rfs_mutex_unlock(&rfs_path_mutex);
+    rfs_path_put(prev);
+
+    return found;
+}
+
+/*
+ * iterator form of redirfs_get_paths_root, -EAGAIN is returned if prev was
+ * removed from the root meanwhile and the walk has to be restarted
+ */
+redirfs_path redirfs_next_path_root(redirfs_filter filter, redirfs_root root,
+        redirfs_path prev)
+{
+    struct rfs_root *rroot = (struct rfs_root *)root;
+    struct rfs_path *rpath = prev;
+    struct rfs_path *found = NULL;
+
+    DBG_BUG_ON(!rfs_preemptible());
+    might_sleep();
+
+    if (!filter || IS_ERR(filter) || !root)
+        return ERR_PTR(-EINVAL);
+
+    rfs_mutex_lock(&rfs_path_mutex);
+
+    if (rpath && rpath->rroot != rroot) {
+        found = ERR_PTR(-EAGAIN);
+        goto exit;
+    }
+
+    if (rfs_chain_find(rroot->rinch, filter) == -1 &&
+        rfs_chain_find(rroot->rexch, filter) == -1)
+        goto exit;
+
+    rpath = list_prepare_entry(rpath, &rroot->rpaths, rroot_list);
+    list_for_each_entry_continue(rpath, &rroot->rpaths, rroot_list) {
+        found = rfs_path_get(rpath);
+        break;
+    }
+
+exit:
+    rfs_mutex_unlock(&rfs_path_mutex);
+    rfs_path_put(prev);
+
+    return found;
+}
+
 void redirfs_put_paths(redirfs_path *paths)
 {
     int i = 0;
@@ -877,7 +992,7 @@ static int rfs_fsrename_add_dentry(struct rfs_root *rroot,
 
     rdentry = rfs_dentry_find(dentry);
     if (rdentry)
-        rchadd = rfs_chain_get(rdentry->rinfo->rchain);
+        rchadd = rfs_chain_get(rfs_info_slot(rdentry->rinfo)->rchain);
 
     for (i = 0; i < rchain->rflts_nr; i++) {
         rchnew = rfs_chain_add(rchadd, rchain->rflts[i]);
@@ -954,7 +1069,7 @@ static int rfs_fsrename_set(struct rfs_root *rroot_src,
     if (!rdentry)
         return 0;
 
-    rchain_src = rdentry->rinfo->rchain;
+    rchain_src = rfs_info_slot(rdentry->rinfo)->rchain;
     rchain_dst = rroot_dst->rinfo->rchain;
 
     for (i = 0; i < rchain_src->rflts_nr; i++) {
@@ -1042,6 +1157,8 @@ EXPORT_SYMBOL(redirfs_put_path);
 EXPORT_SYMBOL(redirfs_get_paths);
 EXPORT_SYMBOL(redirfs_get_paths_root);
 EXPORT_SYMBOL(redirfs_put_paths);
+EXPORT_SYMBOL(redirfs_next_path);
+EXPORT_SYMBOL(redirfs_next_path_root);
 EXPORT_SYMBOL(redirfs_get_path_info);
 EXPORT_SYMBOL(redirfs_put_path_info);
 EXPORT_SYMBOL(redirfs_add_path);
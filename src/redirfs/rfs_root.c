@@ -25,6 +25,7 @@
  */
 
 #include "rfs.h"
+#include <linux/hashtable.h>
 
 #ifdef RFS_DBG
     #pragma GCC push_options
@@ -33,6 +34,10 @@
 
 LIST_HEAD(rfs_root_list);
 LIST_HEAD(rfs_root_walk_list);
+/* roots indexed by dentry, rfs_path_mutex */
+static DEFINE_HASHTABLE(rfs_root_table, 8);
+/* rfs_root_add_walk is called from the parallel dcache walks */
+static DEFINE_SPINLOCK(rfs_root_walk_lock);
 
 static struct rfs_root *rfs_root_alloc(struct dentry *dentry)
 {
@@ -47,7 +52,7 @@ static struct rfs_root *rfs_root_alloc(struct dentry *dentry)
     INIT_LIST_HEAD(&rroot->list);
     INIT_LIST_HEAD(&rroot->walk_list);
     INIT_LIST_HEAD(&rroot->rpaths);
-    INIT_LIST_HEAD(&rroot->data);
+    rfs_data_head_init(&rroot->data);
     rroot->dentry = dentry;
     rroot->paths_nr = 0;
     spin_lock_init(&rroot->lock);
@@ -78,35 +83,34 @@ void rfs_root_put(struct rfs_root *rroot)
 
     rfs_chain_put(rroot->rinch);
     rfs_chain_put(rroot->rexch);
-    rfs_data_remove(&rroot->data);
+    rfs_data_head_remove(&rroot->data);
     kfree(rroot);
 }
 
 static struct rfs_root *rfs_root_find(struct dentry *dentry)
 {
-    struct rfs_root *rroot = NULL;
-    struct rfs_root *found = NULL;
-
-    list_for_each_entry(rroot, &rfs_root_list, list) {
-        if (rroot->dentry != dentry)
-            continue;
+    struct rfs_root *rroot;
 
-        found = rfs_root_get(rroot);
-        break;
+    hash_for_each_possible(rfs_root_table, rroot, hnode,
+            (unsigned long)dentry) {
+        if (rroot->dentry == dentry)
+            return rfs_root_get(rroot);
     }
 
-    return found;
+    return NULL;
 }
 
 static void rfs_root_list_add(struct rfs_root *rroot)
 {
     list_add_tail(&rroot->list, &rfs_root_list);
+    hash_add(rfs_root_table, &rroot->hnode, (unsigned long)rroot->dentry);
     rfs_root_get(rroot);
 }
 
 static void rfs_root_list_rem(struct rfs_root *rroot)
 {
     list_del_init(&rroot->list);
+    hash_del(&rroot->hnode);
     rfs_root_put(rroot);
 }
 
@@ -305,6 +309,15 @@ int rfs_root_add_flt(struct rfs_root *rroot, void *data)
     if (IS_ERR(rchain))
         return PTR_ERR(rchain);
 
+    rv = rfs_info_switch(rroot, rchain);
+    if (!rv) {
+        rfs_root_add_walk_subroots(rroot->dentry);
+        goto exit;
+    }
+    if (rv != -EAGAIN)
+        goto exit;
+    rv = 0;
+
     rinfo = rfs_info_alloc(rroot, rchain);
     if (IS_ERR(rinfo)) {
         rv = PTR_ERR(rinfo);
@@ -317,7 +330,7 @@ int rfs_root_add_flt(struct rfs_root *rroot, void *data)
         goto exit;
     }
 
-    rv = rfs_dcache_walk(rroot->dentry, rfs_dcache_add, rdata);
+    rv = rfs_dcache_walk_add(rdata);
     if (rv)
         goto exit;
 
@@ -350,6 +363,15 @@ int rfs_root_rem_flt(struct rfs_root *rroot, void *data)
     if (IS_ERR(rchain))
         return PTR_ERR(rchain);
 
+    rv = rfs_info_switch(rroot, rchain);
+    if (!rv) {
+        rfs_root_add_walk_subroots(rroot->dentry);
+        goto exit;
+    }
+    if (rv != -EAGAIN)
+        goto exit;
+    rv = 0;
+
     rinfo = rfs_info_alloc(rroot, rchain);
     if (IS_ERR(rinfo)) {
         rv = PTR_ERR(rinfo);
@@ -362,7 +384,7 @@ int rfs_root_rem_flt(struct rfs_root *rroot, void *data)
         goto exit;
     }
 
-    rv = rfs_dcache_walk(rroot->dentry, rfs_dcache_rem, rdata);
+    rv = rfs_dcache_walk_parallel(rroot->dentry, rfs_dcache_rem, rdata);
     if (rv)
         goto exit;
 
@@ -411,20 +433,58 @@ void rfs_root_add_walk(struct dentry *dentry)
     if (rdentry->rinfo->rroot->dentry != dentry)
         goto error;
 
-    list_add_tail(&rdentry->rinfo->rroot->walk_list, &rfs_root_walk_list);
+    spin_lock(&rfs_root_walk_lock);
+    if (list_empty(&rdentry->rinfo->rroot->walk_list))
+        list_add_tail(&rdentry->rinfo->rroot->walk_list, &rfs_root_walk_list);
+    spin_unlock(&rfs_root_walk_lock);
 
 error:
     rfs_dentry_put(rdentry);
     return;
 }
 
+/*
+ * queues the roots nested below the dentry which are not below another
+ * nested root, the lazy dcache walk does not reach them through the
+ * directories that are not attached yet
+ */
+void rfs_root_add_walk_subroots(struct dentry *dentry)
+{
+    struct rfs_root *rroot;
+    struct rfs_root *rparent;
+    bool nested;
+
+    list_for_each_entry(rroot, &rfs_root_list, list) {
+        if (rroot->dentry == dentry || !list_empty(&rroot->walk_list))
+            continue;
+
+        if (!is_subdir(rroot->dentry, dentry))
+            continue;
+
+        nested = false;
+        list_for_each_entry(rparent, &rfs_root_list, list) {
+            if (rparent == rroot || rparent->dentry == dentry)
+                continue;
+
+            if (is_subdir(rparent->dentry, dentry) &&
+                is_subdir(rroot->dentry, rparent->dentry)) {
+                nested = true;
+                break;
+            }
+        }
+
+        if (!nested)
+            rfs_root_add_walk(rroot->dentry);
+    }
+}
+
 static struct rfs_root *rfs_get_root_flt(struct rfs_flt *rflt,
         struct rfs_info *rinfo_start)
 {
     struct rfs_root *rroot = NULL;
     struct rfs_info *rinfo;
 
-    rinfo = rfs_info_get(rinfo_start);
+    rinfo = rfs_info_get_slot(rinfo_start);
 
     while (rinfo) {
         if (rfs_chain_find(rinfo->rchain, rflt) == -1)
@@ -542,10 +602,27 @@ void redirfs_put_root(redirfs_root root)
     rfs_root_put(root);
 }
 
+/*
+ * also publishes the info in the root's slot, the objects below the root
+ * see it at once, called with rfs_path_mutex
+ */
 void rfs_root_set_rinfo(struct rfs_root *rroot, struct rfs_info *rinfo)
 {
-    rfs_info_put(rroot->rinfo);
+    struct rfs_info *rinfo_old;
+    struct rfs_info *rinfo_slot;
+
+    rinfo_old = rroot->rinfo;
     rroot->rinfo = rfs_info_get(rinfo);
+
+    spin_lock(&rroot->lock);
+    {
+        rinfo_slot = rroot->rslot;
+        rcu_assign_pointer(rroot->rslot, rfs_info_get(rinfo));
+    }
+    spin_unlock(&rroot->lock);
+
+    rfs_info_put(rinfo_slot);
+    rfs_info_put(rinfo_old);
 }
 
 EXPORT_SYMBOL(redirfs_get_root_file);
@@ -173,6 +173,9 @@ static int rfs_flt_paths_add(redirfs_filter filter, const char *buf,
     if (type == 'i')
         info.flags = REDIRFS_PATH_INCLUDE;
 
+    else if (type == 'l')
+        info.flags = REDIRFS_PATH_INCLUDE | REDIRFS_PATH_LAZY;
+
     else if (type == 'e')
         info.flags = REDIRFS_PATH_EXCLUDE;
 
@@ -400,6 +403,12 @@ static ssize_t rfs_flt_unregister_store(redirfs_filter filter,
     return count;
 }
             
+static ssize_t rfs_flt_stats_show(redirfs_filter filter,
+        struct redirfs_filter_attribute *attr, char *buf)
+{
+    return rfs_lat_flt_show(filter, buf, PAGE_SIZE);
+}
+
 static struct redirfs_filter_attribute rfs_flt_priority_attr =
     REDIRFS_FILTER_ATTRIBUTE(priority, 0444, rfs_flt_priority_show, NULL);
 
@@ -415,11 +424,15 @@ static struct redirfs_filter_attribute rfs_flt_unregister_attr =
     REDIRFS_FILTER_ATTRIBUTE(unregister, 0200, NULL,
             rfs_flt_unregister_store);
 
+static struct redirfs_filter_attribute rfs_flt_stats_attr =
+    REDIRFS_FILTER_ATTRIBUTE(stats, 0444, rfs_flt_stats_show, NULL);
+
 static struct attribute *rfs_flt_attrs[] = {
     &rfs_flt_priority_attr.attr,
     &rfs_flt_active_attr.attr,
     &rfs_flt_paths_attr.attr,
     &rfs_flt_unregister_attr.attr,
+    &rfs_flt_stats_attr.attr,
     NULL
 };
 
@@ -651,6 +664,43 @@ static struct kobject *rfs_info_kobj;
 static const struct kobj_attribute stat_attr =
     __ATTR(stat, S_IRUGO, rfs_stat_show, NULL);
 
+static ssize_t rfs_walk_show(struct kobject *s, struct kobj_attribute *attr,
+        char *buf)
+{
+    return rfs_dcache_walk_show(buf, PAGE_SIZE);
+}
+
+static const struct kobj_attribute walk_attr =
+    __ATTR(walk, S_IRUGO, rfs_walk_show, NULL);
+
+static ssize_t rfs_latency_show(struct kobject *s, struct kobj_attribute *attr,
+        char *buf)
+{
+    return rfs_lat_ops_show(buf, PAGE_SIZE);
+}
+
+static ssize_t rfs_latency_store(struct kobject *s,
+        struct kobj_attribute *attr, const char *buf, size_t count)
+{
+    int on;
+    int rv;
+
+    if (sscanf(buf, "%d", &on) != 1)
+        return -EINVAL;
+
+    if (on != 0 && on != 1)
+        return -EINVAL;
+
+    rv = rfs_flt_set_lat(on);
+    if (rv)
+        return rv;
+
+    return count;
+}
+
+static const struct kobj_attribute latency_attr =
+    __ATTR(latency, S_IRUGO | S_IWUSR, rfs_latency_show, rfs_latency_store);
+
 int rfs_sysfs_create(void)
 {
     int err;
@@ -677,6 +727,14 @@ int rfs_sysfs_create(void)
     if (err)
         goto error;
 
+    err = sysfs_create_file(rfs_info_kobj, &walk_attr.attr);
+    if (err)
+        goto error;
+
+    err = sysfs_create_file(rfs_info_kobj, &latency_attr.attr);
+    if (err)
+        goto error;
+
     return 0;
 
 error:
@@ -808,7 +866,27 @@ rfs_stat_show(
     struct kobj_attribute *attr,
     char *buf)
 {
-    return rfs_get_stat(buf, PAGE_SIZE);
+    ssize_t bytes;
+
+    bytes = rfs_get_stat(buf, PAGE_SIZE);
+
+    bytes += snprintf(buf + bytes, PAGE_SIZE - bytes,
+                "unique chains = %d\n"
+                "unique infos = %d\n"
+                "iocb fallbacks = %ld\n",
+                rfs_chain_unique_nr(),
+                rfs_info_unique_nr(),
+                rfs_iocb_fallback_nr());
+
+    /* the per object footprint, the slab caches round it up */
+    bytes += snprintf(buf + bytes, PAGE_SIZE - bytes,
+                "sizeof(rfs_inode) = %zu\n"
+                "sizeof(rfs_dentry) = %zu\n"
+                "sizeof(rfs_file) = %zu\n",
+                sizeof(struct rfs_inode),
+                sizeof(struct rfs_dentry),
+                sizeof(struct rfs_file));
+    return bytes;
 }
 #endif
 
@@ -0,0 +1,129 @@
+/*
+ * RedirFS: Redirecting File System
+ *
+ * This file is part of RedirFS.
+ *
+ * RedirFS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * RedirFS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with RedirFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Tracepoints of the filter calls, the events are under
+ * /sys/kernel/debug/tracing/events/redirfs. Only rfs.c includes this file
+ * after rfs.h, it defines CREATE_TRACE_POINTS.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM redirfs
+
+#if !defined(_RFS_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _RFS_TRACE_H
+
+#include <linux/tracepoint.h>
+#include <linux/fs.h>
+
+#define RFS_TRACE_NAME_LEN 32
+
+/*
+ * a hooked operation with subscribed filters was entered, the inode and the
+ * file are taken from the objects the hook resolved into the context
+ */
+TRACE_EVENT(redirfs_hook,
+
+    TP_PROTO(unsigned int idc, struct rfs_context *rcont),
+
+    TP_ARGS(idc, rcont),
+
+    TP_STRUCT__entry(
+        __field(unsigned int, idc)
+        __field(dev_t, dev)
+        __field(unsigned long, ino)
+        __field(const void *, file)
+    ),
+
+    TP_fast_assign(
+        struct inode *inode = rfs_context_inode(rcont);
+
+        __entry->idc = idc;
+        __entry->dev = inode ? inode->i_sb->s_dev : 0;
+        __entry->ino = inode ? inode->i_ino : 0;
+        __entry->file = rcont->rfile ? rcont->rfile->file : NULL;
+    ),
+
+    TP_printk("idc=0x%05x dev=%d:%d ino=%lu file=%p",
+        __entry->idc, MAJOR(__entry->dev), MINOR(__entry->dev),
+        __entry->ino, __entry->file)
+);
+
+/* a filter's pre or post callback returned */
+TRACE_EVENT(redirfs_filter,
+
+    TP_PROTO(const char *name, unsigned int idc, bool pre, bool stop),
+
+    TP_ARGS(name, idc, pre, stop),
+
+    TP_STRUCT__entry(
+        __array(char, name, RFS_TRACE_NAME_LEN)
+        __field(unsigned int, idc)
+        __field(bool, pre)
+        __field(bool, stop)
+    ),
+
+    TP_fast_assign(
+        strncpy(__entry->name, name, RFS_TRACE_NAME_LEN - 1);
+        __entry->name[RFS_TRACE_NAME_LEN - 1] = '\0';
+        __entry->idc = idc;
+        __entry->pre = pre;
+        __entry->stop = stop;
+    ),
+
+    TP_printk("filter=%s idc=0x%05x call=%s rv=%s",
+        __entry->name, __entry->idc,
+        __entry->pre ? "pre" : "post",
+        __entry->stop ? "stop" : "continue")
+);
+
+/*
+ * the original operation returned or a filter stopped it, the type of the
+ * return value depends on the operation so it is recorded both as a long
+ * and as an int
+ */
+TRACE_EVENT(redirfs_op_exit,
+
+    TP_PROTO(unsigned int idc, long rv, int rv_int),
+
+    TP_ARGS(idc, rv, rv_int),
+
+    TP_STRUCT__entry(
+        __field(unsigned int, idc)
+        __field(long, rv)
+        __field(int, rv_int)
+    ),
+
+    TP_fast_assign(
+        __entry->idc = idc;
+        __entry->rv = rv;
+        __entry->rv_int = rv_int;
+    ),
+
+    TP_printk("idc=0x%05x rv=%ld rv_int=%d", __entry->idc, __entry->rv,
+        __entry->rv_int)
+);
+
+#endif /* _RFS_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE rfs_trace
+#include <trace/define_trace.h>
@@ -0,0 +1,259 @@
+/*
+ * RfsBench: no-op filters for measuring the RedirFS hook overhead
+ *
+ * This file is part of RedirFS.
+ *
+ * RedirFS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * RedirFS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with RedirFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The module registers depth filters named rfsbench0 .. rfsbench<depth - 1>
+ * whose callbacks only return REDIRFS_CONTINUE, and includes path for all of
+ * them. The ops mask selects the operations the filters subscribe to, see
+ * the RFSBENCH_OPS_* bits. Build it like the other filters with
+ *
+ *  $ make -C /lib/modules/`uname -r`/build M=`pwd` \
+ *      EXTRA_CFLAGS=-I<full path to the redirfs dir> modules
+ *
+ * The filters hold the module until they are unregistered through
+ * /sys/fs/redirfs/filters/rfsbench<n>/unregister, rfsbenchctl does that
+ * before it removes the module.
+ */
+
+#include <redirfs.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(3,6,0))
+    #include <linux/mount.h>
+#endif
+
+#define RFSBENCH_VERSION "0.1"
+#define RFSBENCH_MAX_DEPTH 16
+#define RFSBENCH_PRIORITY 600000000
+
+#define RFSBENCH_OPS_OPEN    0x01 /* open, release */
+#define RFSBENCH_OPS_LOOKUP  0x02 /* lookup, revalidate, permission */
+#define RFSBENCH_OPS_RW      0x04 /* read, write */
+#define RFSBENCH_OPS_READDIR 0x08 /* readdir, iterate */
+#define RFSBENCH_OPS_NAME    0x10 /* create, unlink, rename */
+#define RFSBENCH_OPS_MMAP    0x20 /* mmap, page reads */
+#define RFSBENCH_OPS_ALL     0x3f
+
+static unsigned int depth = 1;
+module_param(depth, uint, 0444);
+MODULE_PARM_DESC(depth, "the number of filters, 1..16");
+
+static unsigned int ops = RFSBENCH_OPS_ALL;
+module_param(ops, uint, 0444);
+MODULE_PARM_DESC(ops, "the operations mask, 0x01 open, 0x02 lookup, "
+        "0x04 read/write, 0x08 readdir, 0x10 create/unlink/rename, "
+        "0x20 mmap");
+
+static char *path = "/mnt/rfsbench";
+module_param(path, charp, 0444);
+MODULE_PARM_DESC(path, "the directory included for the filters");
+
+static bool nonblock = true;
+module_param(nonblock, bool, 0444);
+MODULE_PARM_DESC(nonblock, "flag the callbacks REDIRFS_OP_NONBLOCK");
+
+static redirfs_filter rfsbench_flts[RFSBENCH_MAX_DEPTH];
+static char rfsbench_names[RFSBENCH_MAX_DEPTH][16];
+
+static enum redirfs_rv rfsbench_cb(redirfs_context context,
+        struct redirfs_args *args)
+{
+    return REDIRFS_CONTINUE;
+}
+
+struct rfsbench_op {
+    enum redirfs_op_idc op_id;
+    unsigned int mask;
+};
+
+static const struct rfsbench_op rfsbench_ops[] = {
+    {REDIRFS_REG_FOP_OPEN, RFSBENCH_OPS_OPEN},
+    {REDIRFS_REG_FOP_RELEASE, RFSBENCH_OPS_OPEN},
+    {REDIRFS_DIR_FOP_OPEN, RFSBENCH_OPS_OPEN},
+    {REDIRFS_DIR_FOP_RELEASE, RFSBENCH_OPS_OPEN},
+    {REDIRFS_DIR_IOP_LOOKUP, RFSBENCH_OPS_LOOKUP},
+    {REDIRFS_REG_DOP_D_REVALIDATE, RFSBENCH_OPS_LOOKUP},
+    {REDIRFS_DIR_DOP_D_REVALIDATE, RFSBENCH_OPS_LOOKUP},
+    {REDIRFS_REG_IOP_PERMISSION, RFSBENCH_OPS_LOOKUP},
+    {REDIRFS_DIR_IOP_PERMISSION, RFSBENCH_OPS_LOOKUP},
+    {REDIRFS_REG_FOP_READ, RFSBENCH_OPS_RW},
+    {REDIRFS_REG_FOP_WRITE, RFSBENCH_OPS_RW},
+#if (LINUX_VERSION_CODE > KERNEL_VERSION(3,14,0))
+    {REDIRFS_REG_FOP_READ_ITER, RFSBENCH_OPS_RW},
+    {REDIRFS_REG_FOP_WRITE_ITER, RFSBENCH_OPS_RW},
+#endif
+    {REDIRFS_DIR_FOP_READDIR, RFSBENCH_OPS_READDIR},
+    {REDIRFS_REG_FOP_DIR_ITERATE, RFSBENCH_OPS_READDIR},
+    {REDIRFS_REG_FOP_DIR_ITERATE_SHARED, RFSBENCH_OPS_READDIR},
+    {REDIRFS_DIR_IOP_CREATE, RFSBENCH_OPS_NAME},
+    {REDIRFS_DIR_IOP_UNLINK, RFSBENCH_OPS_NAME},
+    {REDIRFS_DIR_IOP_RENAME, RFSBENCH_OPS_NAME},
+    {REDIRFS_REG_FOP_MMAP, RFSBENCH_OPS_MMAP},
+    {REDIRFS_REG_AOP_READPAGE, RFSBENCH_OPS_MMAP},
+    {REDIRFS_REG_AOP_READPAGES, RFSBENCH_OPS_MMAP},
+    {REDIRFS_REG_AOP_READ_FOLIO, RFSBENCH_OPS_MMAP},
+    {REDIRFS_REG_AOP_READAHEAD, RFSBENCH_OPS_MMAP},
+};
+
+static struct redirfs_op_info rfsbench_op_info[ARRAY_SIZE(rfsbench_ops) + 1];
+
+static void rfsbench_set_op_info(void)
+{
+    unsigned int flags = nonblock ? REDIRFS_OP_NONBLOCK : 0;
+    int i, n = 0;
+
+    for (i = 0; i < ARRAY_SIZE(rfsbench_ops); i++) {
+        if (!(ops & rfsbench_ops[i].mask))
+            continue;
+
+        rfsbench_op_info[n].op_id = rfsbench_ops[i].op_id;
+        rfsbench_op_info[n].pre_cb = rfsbench_cb;
+        rfsbench_op_info[n].post_cb = rfsbench_cb;
+        rfsbench_op_info[n].flags = flags;
+        n++;
+    }
+
+    rfsbench_op_info[n].op_id = REDIRFS_OP_END;
+}
+
+static int rfsbench_add_path(redirfs_filter filter)
+{
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(2,6,39))
+    struct nameidata nd;
+#else
+    struct path spath;
+#endif
+    struct redirfs_path_info info;
+    redirfs_path rpath;
+    int rv;
+
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(2,6,39))
+    rv = path_lookup(path, LOOKUP_FOLLOW, &nd);
+    if (rv)
+        return rv;
+
+    info.dentry = nd.path.dentry;
+    info.mnt = nd.path.mnt;
+#else
+    rv = kern_path(path, LOOKUP_FOLLOW, &spath);
+    if (rv)
+        return rv;
+
+    info.dentry = spath.dentry;
+    info.mnt = spath.mnt;
+#endif
+    info.flags = REDIRFS_PATH_INCLUDE;
+
+    rpath = redirfs_add_path(filter, &info);
+
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(2,6,39))
+    path_put(&nd.path);
+#else
+    path_put(&spath);
+#endif
+
+    if (IS_ERR(rpath))
+        return PTR_ERR(rpath);
+
+    redirfs_put_path(rpath);
+    return 0;
+}
+
+static void rfsbench_unregister(unsigned int nr)
+{
+    int rv;
+
+    while (nr--) {
+        rv = redirfs_unregister_filter(rfsbench_flts[nr]);
+        if (rv) {
+            printk(KERN_ERR "rfsbench: unregister filter failed(%d)\n", rv);
+            continue;
+        }
+        redirfs_delete_filter(rfsbench_flts[nr]);
+        rfsbench_flts[nr] = NULL;
+    }
+}
+
+static int __init rfsbench_init(void)
+{
+    struct redirfs_filter_info info = {
+        .owner = THIS_MODULE,
+        .active = 1
+    };
+    unsigned int i;
+    int rv;
+
+    if (!depth || depth > RFSBENCH_MAX_DEPTH)
+        return -EINVAL;
+
+    rfsbench_set_op_info();
+
+    for (i = 0; i < depth; i++) {
+        snprintf(rfsbench_names[i], sizeof(rfsbench_names[i]),
+                "rfsbench%u", i);
+        info.name = rfsbench_names[i];
+        info.priority = RFSBENCH_PRIORITY + i;
+
+        rfsbench_flts[i] = redirfs_register_filter(&info);
+        if (IS_ERR(rfsbench_flts[i])) {
+            rv = PTR_ERR(rfsbench_flts[i]);
+            printk(KERN_ERR "rfsbench: register filter failed(%d)\n", rv);
+            goto error;
+        }
+
+        rv = redirfs_set_operations(rfsbench_flts[i], rfsbench_op_info);
+        if (rv) {
+            printk(KERN_ERR "rfsbench: set operations failed(%d)\n", rv);
+            i++;
+            goto error;
+        }
+
+        rv = rfsbench_add_path(rfsbench_flts[i]);
+        if (rv) {
+            printk(KERN_ERR "rfsbench: add path %s failed(%d)\n", path, rv);
+            i++;
+            goto error;
+        }
+    }
+
+    printk(KERN_INFO "rfsbench: %u filters, ops 0x%x, path %s\n", depth, ops,
+            path);
+    return 0;
+
+error:
+    rfsbench_unregister(i);
+    return rv;
+}
+
+static void __exit rfsbench_exit(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < depth; i++) {
+        if (rfsbench_flts[i])
+            redirfs_delete_filter(rfsbench_flts[i]);
+    }
+}
+
+module_init(rfsbench_init);
+module_exit(rfsbench_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("RedirFS hook overhead benchmark filters Version "
+        RFSBENCH_VERSION);
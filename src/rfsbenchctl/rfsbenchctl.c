@@ -0,0 +1,519 @@
+/*
+ * RfsBenchCtl: drives the RedirFS hook overhead benchmark
+ *
+ * This file is part of RedirFS.
+ *
+ * RedirFS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * RedirFS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with RedirFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Runs file system workloads from 1, 2, 4 .. threads in a directory, first
+ * without filters and then with rfsbench.ko loaded with each chain depth,
+ * and prints ns/op, ops/s and the overhead against the run without filters.
+ * The directory should be on a dedicated mount, e.g.
+ *
+ *  # mount -t tmpfs none /mnt/rfsbench
+ *
+ * or an ext4 image mounted with -o loop. Example:
+ *
+ *  # rfsbenchctl -p /mnt/rfsbench -m rfsbench.ko -d 0,1,4,16 -t 8
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <limits.h>
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+
+#define MAX_THREADS 256
+#define MAX_DEPTHS 16
+#define FILE_PAGES 16
+#define DIR_ENTRIES 64
+#define IO_SIZE 512
+/* the paths in the worker's directory under the benchmark directory */
+#define DIR_LEN (PATH_MAX + 32)
+#define NAME_LEN (PATH_MAX + 64)
+
+static const char *version = "0.1";
+
+struct worker {
+    pthread_t thread;
+    char dir[DIR_LEN];
+    char file[NAME_LEN];
+    char entries[NAME_LEN];
+    char name0[NAME_LEN];
+    char name1[NAME_LEN];
+    unsigned long ops;
+    unsigned long long ns;
+    int err;
+};
+
+struct workload {
+    const char *name;
+    /* returns the number of operations done by one iteration, -1 on error */
+    int (*run)(struct worker *w);
+};
+
+static char bench_dir[PATH_MAX];
+static const char *module;
+static unsigned int ops_mask = 0x3f;
+static unsigned long iterations = 100000;
+static unsigned int max_threads;
+static const struct workload *current;
+static pthread_barrier_t barrier;
+static long page_size;
+
+static unsigned long long now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int run_open(struct worker *w)
+{
+    int fd = open(w->file, O_RDONLY);
+
+    if (fd < 0)
+        return -1;
+
+    close(fd);
+    return 1;
+}
+
+static int run_stat(struct worker *w)
+{
+    struct stat st;
+
+    return stat(w->file, &st) ? -1 : 1;
+}
+
+static int run_read(struct worker *w)
+{
+    char buf[IO_SIZE];
+    int fd = open(w->file, O_RDONLY);
+    unsigned int i;
+
+    if (fd < 0)
+        return -1;
+
+    for (i = 0; i < FILE_PAGES; i++) {
+        if (pread(fd, buf, IO_SIZE, i * page_size) != IO_SIZE) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    close(fd);
+    return FILE_PAGES;
+}
+
+static int run_write(struct worker *w)
+{
+    char buf[IO_SIZE];
+    int fd = open(w->file, O_WRONLY);
+    unsigned int i;
+
+    if (fd < 0)
+        return -1;
+
+    memset(buf, 'w', IO_SIZE);
+
+    for (i = 0; i < FILE_PAGES; i++) {
+        if (pwrite(fd, buf, IO_SIZE, i * page_size) != IO_SIZE) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    close(fd);
+    return FILE_PAGES;
+}
+
+static int run_readdir(struct worker *w)
+{
+    DIR *dir = opendir(w->entries);
+    int nr = 0;
+
+    if (!dir)
+        return -1;
+
+    while (readdir(dir))
+        nr++;
+
+    closedir(dir);
+    return nr ? 1 : -1;
+}
+
+static int run_rename(struct worker *w)
+{
+    if (rename(w->name0, w->name1))
+        return -1;
+
+    if (rename(w->name1, w->name0))
+        return -1;
+
+    return 2;
+}
+
+static int run_mmap(struct worker *w)
+{
+    volatile char *map;
+    unsigned int i;
+    int fd = open(w->file, O_RDONLY);
+
+    if (fd < 0)
+        return -1;
+
+    map = mmap(NULL, FILE_PAGES * page_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -1;
+
+    /* a fault for each page unless the kernel maps the pages around */
+    for (i = 0; i < FILE_PAGES; i++)
+        (void)map[i * page_size];
+
+    munmap((void *)map, FILE_PAGES * page_size);
+    return FILE_PAGES;
+}
+
+static const struct workload workloads[] = {
+    {"open", run_open},
+    {"stat", run_stat},
+    {"read", run_read},
+    {"write", run_write},
+    {"readdir", run_readdir},
+    {"rename", run_rename},
+    {"mmap", run_mmap},
+    {NULL, NULL}
+};
+
+#define WORKLOADS_NR (sizeof(workloads) / sizeof(workloads[0]) - 1)
+
+static int create_file(const char *name, size_t size)
+{
+    char *buf;
+    int fd;
+    int rv = 0;
+
+    fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+
+    buf = calloc(1, size);
+    if (!buf || write(fd, buf, size) != (ssize_t)size)
+        rv = -1;
+
+    free(buf);
+    close(fd);
+    return rv;
+}
+
+static int setup_worker(struct worker *w, unsigned int idx)
+{
+    char name[NAME_LEN + 16];
+    unsigned int i;
+
+    snprintf(w->dir, DIR_LEN, "%s/rfsbench.%u", bench_dir, idx);
+    snprintf(w->file, NAME_LEN, "%s/file", w->dir);
+    snprintf(w->entries, NAME_LEN, "%s/entries", w->dir);
+    snprintf(w->name0, NAME_LEN, "%s/name0", w->dir);
+    snprintf(w->name1, NAME_LEN, "%s/name1", w->dir);
+
+    if (mkdir(w->dir, 0755) && errno != EEXIST)
+        return -1;
+
+    if (mkdir(w->entries, 0755) && errno != EEXIST)
+        return -1;
+
+    if (create_file(w->file, FILE_PAGES * page_size))
+        return -1;
+
+    unlink(w->name1);
+    if (create_file(w->name0, 0))
+        return -1;
+
+    for (i = 0; i < DIR_ENTRIES; i++) {
+        snprintf(name, sizeof(name), "%s/e%u", w->entries, i);
+        if (create_file(name, 0))
+            return -1;
+    }
+
+    return 0;
+}
+
+static void *worker_thread(void *data)
+{
+    struct worker *w = data;
+    unsigned long long start;
+    unsigned long i;
+    int rv;
+
+    w->ops = 0;
+    w->err = 0;
+
+    pthread_barrier_wait(&barrier);
+
+    start = now_ns();
+
+    for (i = 0; i < iterations; i++) {
+        rv = current->run(w);
+        if (rv < 0) {
+            w->err = errno;
+            break;
+        }
+        w->ops += rv;
+    }
+
+    w->ns = now_ns() - start;
+
+    return NULL;
+}
+
+struct result {
+    double ns_per_op;
+    double ops_per_sec;
+};
+
+static int run(const struct workload *wl, struct worker *workers,
+        unsigned int threads, struct result *res)
+{
+    unsigned long long max_ns = 0;
+    unsigned long total = 0;
+    double ns_per_op = 0;
+    unsigned int i;
+    int rv = 0;
+
+    current = wl;
+    pthread_barrier_init(&barrier, NULL, threads);
+
+    for (i = 0; i < threads; i++) {
+        rv = pthread_create(&workers[i].thread, NULL, worker_thread,
+                &workers[i]);
+        if (rv) {
+            fprintf(stderr, "pthread_create failed: %d\n", rv);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (i = 0; i < threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+        if (workers[i].err) {
+            fprintf(stderr, "%s failed: %s\n", wl->name,
+                    strerror(workers[i].err));
+            rv = -1;
+        }
+        if (workers[i].ns > max_ns)
+            max_ns = workers[i].ns;
+        total += workers[i].ops;
+        if (workers[i].ops)
+            ns_per_op += (double)workers[i].ns / workers[i].ops;
+    }
+
+    pthread_barrier_destroy(&barrier);
+
+    res->ns_per_op = ns_per_op / threads;
+    res->ops_per_sec = max_ns ? total * 1e9 / max_ns : 0;
+
+    return rv;
+}
+
+static int module_load(unsigned int depth)
+{
+    char cmd[PATH_MAX * 2];
+
+    snprintf(cmd, sizeof(cmd), "insmod %s depth=%u ops=%u path=%s", module,
+            depth, ops_mask, bench_dir);
+
+    return system(cmd) ? -1 : 0;
+}
+
+static int module_unload(unsigned int depth)
+{
+    char name[PATH_MAX];
+    unsigned int i;
+    FILE *f;
+
+    for (i = 0; i < depth; i++) {
+        snprintf(name, PATH_MAX,
+                "/sys/fs/redirfs/filters/rfsbench%u/unregister", i);
+        f = fopen(name, "w");
+        if (!f) {
+            perror(name);
+            continue;
+        }
+        fputs("1", f);
+        fclose(f);
+    }
+
+    return system("rmmod rfsbench") ? -1 : 0;
+}
+
+static int parse_list(const char *str, unsigned int *list, int max)
+{
+    char *copy = strdup(str);
+    char *tok, *save = NULL;
+    int nr = 0;
+
+    for (tok = strtok_r(copy, ",", &save); tok && nr < max;
+            tok = strtok_r(NULL, ",", &save))
+        list[nr++] = strtoul(tok, NULL, 0);
+
+    free(copy);
+    return nr;
+}
+
+/* 1, 2, 4 .. and max_threads, 0 at the end */
+static unsigned int next_threads(unsigned int threads)
+{
+    if (threads >= max_threads)
+        return 0;
+
+    if (threads * 2 > max_threads)
+        return max_threads;
+
+    return threads * 2;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: rfsbenchctl -p <dir> [-m <rfsbench.ko>] "
+            "[-d <depth,..>] [-t <max threads>]\n"
+            "                   [-n <iterations>] [-o <ops mask>] "
+            "[-w <workload,..>]\n"
+            "  depth 0 runs without the module, other depths need -m\n"
+            "  workloads: open, stat, read, write, readdir, rename, mmap\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+    static struct result base[WORKLOADS_NR][MAX_THREADS + 1];
+    static struct worker workers[MAX_THREADS];
+    unsigned int depths[MAX_DEPTHS] = {0, 1};
+    int depths_nr = 2;
+    const char *only = NULL;
+    struct result res;
+    unsigned int threads;
+    unsigned int i;
+    int d, opt;
+
+    printf("rfsbenchctl: version %s\n", version);
+
+    page_size = sysconf(_SC_PAGESIZE);
+    max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+    while ((opt = getopt(argc, argv, "p:m:d:t:n:o:w:")) != -1) {
+        switch (opt) {
+        case 'p':
+            if (!realpath(optarg, bench_dir)) {
+                perror(optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'm':
+            module = optarg;
+            break;
+        case 'd':
+            depths_nr = parse_list(optarg, depths, MAX_DEPTHS);
+            break;
+        case 't':
+            max_threads = strtoul(optarg, NULL, 0);
+            break;
+        case 'n':
+            iterations = strtoul(optarg, NULL, 0);
+            break;
+        case 'o':
+            ops_mask = strtoul(optarg, NULL, 0);
+            break;
+        case 'w':
+            only = optarg;
+            break;
+        default:
+            usage();
+        }
+    }
+
+    if (!bench_dir[0] || !depths_nr)
+        usage();
+
+    if (!max_threads)
+        max_threads = 1;
+    if (max_threads > MAX_THREADS)
+        max_threads = MAX_THREADS;
+
+    for (d = 0; d < depths_nr; d++) {
+        if (depths[d] && !module) {
+            fprintf(stderr, "depth %u needs the module, use -m\n",
+                    depths[d]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (i = 0; i < max_threads; i++) {
+        if (setup_worker(&workers[i], i)) {
+            perror("setup failed");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    printf("%-8s %5s %7s %10s %12s %9s\n", "workload", "depth", "threads",
+            "ns/op", "ops/s", "overhead");
+
+    for (d = 0; d < depths_nr; d++) {
+        if (depths[d] && module_load(depths[d])) {
+            fprintf(stderr, "loading %s failed\n", module);
+            exit(EXIT_FAILURE);
+        }
+
+        for (i = 0; i < WORKLOADS_NR; i++) {
+            if (only && !strstr(only, workloads[i].name))
+                continue;
+
+            for (threads = 1; threads; threads = next_threads(threads)) {
+                if (run(&workloads[i], workers, threads, &res))
+                    continue;
+
+                if (!depths[d])
+                    base[i][threads] = res;
+
+                printf("%-8s %5u %7u %10.1f %12.0f", workloads[i].name,
+                        depths[d], threads, res.ns_per_op, res.ops_per_sec);
+
+                if (depths[d] && base[i][threads].ns_per_op)
+                    printf(" %8.1f%%", (res.ns_per_op /
+                            base[i][threads].ns_per_op - 1) * 100);
+
+                printf("\n");
+                fflush(stdout);
+            }
+        }
+
+        if (depths[d] && module_unload(depths[d]))
+            fprintf(stderr, "unloading rfsbench failed\n");
+    }
+
+    exit(EXIT_SUCCESS);
+}
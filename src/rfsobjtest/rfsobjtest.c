@@ -0,0 +1,721 @@
+/*
+ * RfsObjTest: a load test for the RedirFS object table and filter chains
+ *
+ * This file is part of RedirFS.
+ *
+ * RedirFS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * RedirFS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with RedirFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A KUnit suite, the object table and chain functions are not exported by
+ * redirfs so the implementation is compiled into the test. Run it with
+ * kunit.py from a kernel tree the src directory is linked into, e.g. as
+ * drivers/redirfs with "source drivers/redirfs/rfsobjtest/Kconfig" in
+ * drivers/Kconfig and "obj-y += redirfs/rfsobjtest/" in drivers/Makefile
+ *
+ *  $ ./tools/testing/kunit/kunit.py run \
+ *      --kunitconfig=drivers/redirfs/rfsobjtest
+ *
+ * or build it as a module with "make objtest" in the src directory against
+ * a kernel with CONFIG_KUNIT and load it. Add -DRFS_USE_RADIX_TREE to
+ * compare with the radix tree.
+ *
+ * The chain_ops case checks rfs_chain_add/rem/join/diff/cmp on fake
+ * filters, whose references are stubbed below, and the duplicate case
+ * checks that inserting an object for a system object which is already in
+ * the table replaces the stale object.
+ *
+ * The timing cases only check the results and report the latencies: the
+ * chain operations for 1 .. 32 filters, the lookups from the readers
+ * threads at once in 10^4 .. 10^max_order objects and the object life
+ * cycle of an open/close, allocate, insert, look up, remove and release
+ * with the peak number of objects waiting for the RCU grace period.
+ */
+
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/ktime.h>
+#include <linux/sched.h>
+#include <linux/kthread.h>
+#include <linux/completion.h>
+#include <kunit/test.h>
+#include "rfs_object.c"
+#include "rfs_chain.c"
+
+static unsigned int max_order = 7;
+module_param(max_order, uint, 0444);
+MODULE_PARM_DESC(max_order, "test up to 10^max_order objects, 4..7");
+
+static unsigned int lookups = 1000000;
+module_param(lookups, uint, 0444);
+MODULE_PARM_DESC(lookups, "the number of lookups for each table size");
+
+static unsigned int readers = 4;
+module_param(readers, uint, 0444);
+MODULE_PARM_DESC(readers, "the number of concurrent lookup threads, 1..64");
+
+static unsigned int churn = 1000000;
+module_param(churn, uint, 0444);
+MODULE_PARM_DESC(churn, "the number of object life cycles, 0 to skip");
+
+static unsigned int chains = 100000;
+module_param(chains, uint, 0444);
+MODULE_PARM_DESC(chains, "chain operations for each size, 0 to skip");
+
+struct rfsobjtest_object {
+    struct rfs_object robject;
+    /* the address is used as a unique system object */
+    char system_object;
+};
+
+static struct kmem_cache *rfsobjtest_cache;
+
+static void rfsobjtest_free(struct rfs_object *robject)
+{
+    kmem_cache_free(rfsobjtest_cache,
+            container_of(robject, struct rfsobjtest_object, robject));
+}
+
+static struct rfs_object_type rfsobjtest_type = {
+    .type = RFS_TYPE_UNKNOWN,
+    .size = sizeof(struct rfsobjtest_object),
+    .free = rfsobjtest_free,
+};
+
+#ifdef RFS_USE_HASHTABLE
+static struct rfs_object_table rfsobjtest_table = {
+    .rfs_type = RFS_TYPE_UNKNOWN,
+};
+#else
+static struct rfs_radix_tree rfsobjtest_table = {
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(4,0,0))
+    .root = RADIX_TREE_INIT(GFP_ATOMIC),
+#else
+    .root = RADIX_TREE_INIT(0, GFP_ATOMIC),
+#endif
+    .lock = __SPIN_LOCK_INITIALIZER(rfsobjtest_table.lock),
+    .rfs_type = RFS_TYPE_UNKNOWN,
+};
+#endif
+
+/*
+ * the chains only take and put references of their filters, the filters
+ * below are never registered and the references are just counted
+ */
+#define RFSOBJTEST_FLTS 32
+
+static struct rfs_flt *rfsobjtest_flts;
+
+#ifdef RFS_INFO_SRCU
+struct srcu_struct rfs_info_srcu;
+#endif
+
+struct rfs_flt *rfs_flt_get(struct rfs_flt *rflt)
+{
+    if (!rflt || IS_ERR(rflt))
+        return NULL;
+
+    BUG_ON(!atomic_read(&rflt->count));
+    atomic_inc(&rflt->count);
+
+    return rflt;
+}
+
+void rfs_flt_put(struct rfs_flt *rflt)
+{
+    if (!rflt || IS_ERR(rflt))
+        return;
+
+    BUG_ON(atomic_dec_and_test(&rflt->count));
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * every case gets the fake filters, the object cache and an empty table
+ */
+static int rfsobjtest_init(struct kunit *test)
+{
+    int rv;
+    int i;
+
+    rfsobjtest_flts = vzalloc(sizeof(struct rfs_flt) * RFSOBJTEST_FLTS);
+    if (!rfsobjtest_flts)
+        return -ENOMEM;
+
+    for (i = 0; i < RFSOBJTEST_FLTS; i++) {
+        rfsobjtest_flts[i].priority = i * 10;
+        atomic_set(&rfsobjtest_flts[i].active, 1);
+        atomic_set(&rfsobjtest_flts[i].count, 1);
+    }
+
+#ifdef RFS_INFO_SRCU
+    rv = init_srcu_struct(&rfs_info_srcu);
+    if (rv)
+        goto err_srcu;
+#endif
+
+    rfs_object_susbsystem_init();
+
+    rfsobjtest_cache = kmem_cache_create("rfsobjtest_cache",
+            sizeof(struct rfsobjtest_object), 0, 0, NULL);
+    if (!rfsobjtest_cache) {
+        rv = -ENOMEM;
+        goto err_cache;
+    }
+
+#ifdef RFS_USE_HASHTABLE
+    rv = rfs_object_table_init(&rfsobjtest_table);
+    if (rv)
+        goto err_table;
+#endif
+
+    return 0;
+
+#ifdef RFS_USE_HASHTABLE
+err_table:
+    kmem_cache_destroy(rfsobjtest_cache);
+#endif
+err_cache:
+#ifdef RFS_INFO_SRCU
+    cleanup_srcu_struct(&rfs_info_srcu);
+err_srcu:
+#endif
+    vfree(rfsobjtest_flts);
+    return rv;
+}
+
+/*
+ * all chains are released and the filter references are back whatever
+ * the case did
+ */
+static void rfsobjtest_exit(struct kunit *test)
+{
+    int i;
+
+    KUNIT_EXPECT_EQ(test, rfs_chain_unique_nr(), 0);
+    for (i = 0; i < RFSOBJTEST_FLTS; i++)
+        KUNIT_EXPECT_EQ(test, atomic_read(&rfsobjtest_flts[i].count), 1);
+
+#ifdef RFS_USE_HASHTABLE
+    rfs_object_table_destroy(&rfsobjtest_table);
+#endif
+    kmem_cache_destroy(rfsobjtest_cache);
+#ifdef RFS_INFO_SRCU
+    /* the callbacks vectors of the released chains */
+    srcu_barrier(&rfs_info_srcu);
+    cleanup_srcu_struct(&rfs_info_srcu);
+#endif
+    vfree(rfsobjtest_flts);
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * builds the chain by adding the filters in the given order
+ */
+static struct rfs_chain *rfsobjtest_chain(const int *flts, int nr)
+{
+    struct rfs_chain *rchain = NULL;
+    struct rfs_chain *rchain_new;
+    int i;
+
+    for (i = 0; i < nr; i++) {
+        rchain_new = rfs_chain_add(rchain, &rfsobjtest_flts[flts[i]]);
+        rfs_chain_put(rchain);
+        if (IS_ERR(rchain_new))
+            return rchain_new;
+        rchain = rchain_new;
+    }
+
+    return rchain;
+}
+
+/*
+ * the chain has to have the filters in the given order, the filters are
+ * given in the priority order, the chain is released
+ */
+static void rfsobjtest_chain_expect(struct kunit *test,
+        struct rfs_chain *rchain, const int *flts, int nr)
+{
+    int i;
+
+    KUNIT_EXPECT_FALSE(test, IS_ERR(rchain));
+    if (IS_ERR(rchain))
+        return;
+
+    KUNIT_EXPECT_EQ(test, rchain ? rchain->rflts_nr : 0, nr);
+    for (i = 0; rchain && i < nr && i < rchain->rflts_nr; i++)
+        KUNIT_EXPECT_PTR_EQ(test, rchain->rflts[i],
+                &rfsobjtest_flts[flts[i]]);
+
+    rfs_chain_put(rchain);
+}
+
+/*
+ * the chains are interned, an operation resulting in the filters of an
+ * existing chain has to return that chain, the result is released
+ */
+static void rfsobjtest_chain_same(struct kunit *test,
+        struct rfs_chain *rchain, struct rfs_chain *expected)
+{
+    KUNIT_EXPECT_PTR_EQ(test, rchain, expected);
+    rfs_chain_put(rchain);
+}
+
+static void rfsobjtest_chain_ops(struct kunit *test)
+{
+    static const int shuffled[] = {3, 0, 4, 2, 1};
+    static const int all[] = {0, 1, 2, 3, 4};
+    static const int no2[] = {0, 1, 3, 4};
+    static const int no3[] = {0, 1, 2, 4};
+    static const int even[] = {0, 2, 4};
+    static const int odd[] = {1, 3};
+    static const int low[] = {0, 1, 2};
+    struct rfs_chain *rall, *reven, *rodd, *rlow, *rone;
+
+    rall = rfsobjtest_chain(shuffled, ARRAY_SIZE(shuffled));
+    reven = rfsobjtest_chain(even, ARRAY_SIZE(even));
+    rodd = rfsobjtest_chain(odd, ARRAY_SIZE(odd));
+    rlow = rfsobjtest_chain(low, ARRAY_SIZE(low));
+    rone = rfsobjtest_chain(odd, 1);
+    if (IS_ERR(rall) || IS_ERR(reven) || IS_ERR(rodd) || IS_ERR(rlow) ||
+        IS_ERR(rone)) {
+        KUNIT_FAIL(test, "cannot build the chains");
+        goto exit;
+    }
+
+    /* the filters are in the priority order whatever the add order is */
+    rfsobjtest_chain_expect(test, rfs_chain_get(rall), all, ARRAY_SIZE(all));
+    rfsobjtest_chain_same(test, rfsobjtest_chain(all, ARRAY_SIZE(all)),
+            rall);
+    rfsobjtest_chain_same(test, rfs_chain_add(rall, &rfsobjtest_flts[2]),
+            rall);
+
+    rfsobjtest_chain_expect(test, rfs_chain_rem(rall, &rfsobjtest_flts[2]),
+            no2, ARRAY_SIZE(no2));
+    rfsobjtest_chain_same(test, rfs_chain_rem(rodd, &rfsobjtest_flts[2]),
+            rodd);
+    rfsobjtest_chain_expect(test,
+            rfs_chain_rem(rone, &rfsobjtest_flts[odd[0]]), NULL, 0);
+
+    /* the chains are merged by the priorities, common filters once */
+    rfsobjtest_chain_same(test, rfs_chain_join(reven, rodd), rall);
+    rfsobjtest_chain_same(test, rfs_chain_join(rodd, reven), rall);
+    rfsobjtest_chain_expect(test, rfs_chain_join(rlow, reven), no3,
+            ARRAY_SIZE(no3));
+    rfsobjtest_chain_same(test, rfs_chain_join(reven, reven), reven);
+    rfsobjtest_chain_same(test, rfs_chain_join(NULL, rodd), rodd);
+    rfsobjtest_chain_expect(test, rfs_chain_join(NULL, NULL), NULL, 0);
+
+    rfsobjtest_chain_same(test, rfs_chain_diff(rall, rodd), reven);
+    rfsobjtest_chain_same(test, rfs_chain_diff(reven, rodd), reven);
+    rfsobjtest_chain_expect(test, rfs_chain_diff(reven, rlow), &even[2], 1);
+    rfsobjtest_chain_expect(test, rfs_chain_diff(rlow, rall), NULL, 0);
+    rfsobjtest_chain_same(test, rfs_chain_diff(rall, NULL), rall);
+
+    KUNIT_EXPECT_NE(test, rfs_chain_cmp(reven, rodd), 0);
+    KUNIT_EXPECT_EQ(test, rfs_chain_cmp(rall, rall), 0);
+
+exit:
+    rfs_chain_put(rone);
+    rfs_chain_put(rlow);
+    rfs_chain_put(rodd);
+    rfs_chain_put(reven);
+    rfs_chain_put(rall);
+}
+
+/*
+ * all chains exist before the timing so the add and join measure the
+ * interned lookup, which is what the path and info code mostly hits
+ */
+static void rfsobjtest_chain_bench(struct kunit *test)
+{
+    struct rfs_chain *rchain, *rfirst, *rrest, *rch;
+    int flts[RFSOBJTEST_FLTS];
+    u64 start, add, join, find;
+    unsigned int i;
+    int nr;
+    bool ok = true;
+
+    if (!chains)
+        kunit_skip(test, "chains=0");
+
+    for (nr = 0; nr < RFSOBJTEST_FLTS; nr++)
+        flts[nr] = nr;
+
+    for (nr = 1; ok && nr <= RFSOBJTEST_FLTS; nr *= 2) {
+        /* the first filter alone and the chain without it */
+        rchain = rfsobjtest_chain(flts, nr);
+        rfirst = rfsobjtest_chain(flts, 1);
+        rrest = IS_ERR(rchain) ? NULL :
+            rfs_chain_rem(rchain, &rfsobjtest_flts[0]);
+        ok = !IS_ERR(rchain) && !IS_ERR(rfirst) && !IS_ERR(rrest);
+        KUNIT_EXPECT_TRUE_MSG(test, ok, "cannot build the chains");
+
+        start = ktime_to_ns(ktime_get());
+        for (i = 0; ok && i < chains; i++) {
+            rch = rfs_chain_add(rrest, &rfsobjtest_flts[0]);
+            ok = rch == rchain;
+            rfs_chain_put(rch);
+
+            if (!(i % 1024))
+                cond_resched();
+        }
+        add = ktime_to_ns(ktime_get()) - start;
+        KUNIT_EXPECT_TRUE_MSG(test, ok, "add filters=%d", nr);
+
+        start = ktime_to_ns(ktime_get());
+        for (i = 0; ok && i < chains; i++) {
+            rch = rfs_chain_join(rfirst, rrest);
+            ok = rch == rchain;
+            rfs_chain_put(rch);
+
+            if (!(i % 1024))
+                cond_resched();
+        }
+        join = ktime_to_ns(ktime_get()) - start;
+        KUNIT_EXPECT_TRUE_MSG(test, ok, "join filters=%d", nr);
+
+        start = ktime_to_ns(ktime_get());
+        for (i = 0; ok && i < chains; i++)
+            ok = rfs_chain_find(rchain, &rfsobjtest_flts[nr - 1]) == nr - 1;
+        find = ktime_to_ns(ktime_get()) - start;
+        KUNIT_EXPECT_TRUE_MSG(test, ok, "find filters=%d", nr);
+
+        rfs_chain_put(rrest);
+        rfs_chain_put(rfirst);
+        rfs_chain_put(rchain);
+
+        if (ok)
+            kunit_info(test, "chain filters=%d add=%llu ns join=%llu ns "
+                    "find=%llu ns\n", nr,
+                    div_u64(add, chains), div_u64(join, chains),
+                    div_u64(find, chains));
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * a system object whose stale object was not removed is inserted again,
+ * the new object has to replace the stale one
+ */
+static void rfsobjtest_duplicate(struct kunit *test)
+{
+    struct rfsobjtest_object *stale, *obj;
+    struct rfs_object *robject;
+    int rv;
+
+    stale = kmem_cache_zalloc(rfsobjtest_cache, GFP_KERNEL);
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, stale);
+
+    obj = kmem_cache_zalloc(rfsobjtest_cache, GFP_KERNEL);
+    if (!obj) {
+        kmem_cache_free(rfsobjtest_cache, stale);
+        KUNIT_FAIL(test, "cannot allocate the object");
+        return;
+    }
+
+    rfs_object_init(&stale->robject, &rfsobjtest_type, &stale->system_object);
+    rfs_object_init(&obj->robject, &rfsobjtest_type, &stale->system_object);
+
+    rv = rfs_insert_object(&rfsobjtest_table, &stale->robject, false);
+    KUNIT_EXPECT_EQ(test, rv, 0);
+    if (rv)
+        goto exit;
+
+    rv = rfs_insert_object(&rfsobjtest_table, &obj->robject, true);
+    KUNIT_EXPECT_EQ(test, rv, 0);
+    if (rv) {
+        rfs_remove_object(&stale->robject);
+        goto exit;
+    }
+
+    robject = rfs_get_object_by_system_object(&rfsobjtest_table,
+            &stale->system_object);
+    KUNIT_EXPECT_PTR_EQ(test, robject, &obj->robject);
+    KUNIT_EXPECT_PTR_EQ(test, stale->robject.object_table, NULL);
+    if (robject)
+        rfs_object_put(robject);
+
+    rfs_remove_object(&obj->robject);
+    if (stale->robject.object_table)
+        rfs_remove_object(&stale->robject);
+
+exit:
+    rfs_object_put(&obj->robject);
+    rfs_object_put(&stale->robject);
+    rfs_object_free_flush();
+}
+
+static void rfsobjtest_remove(struct rfsobjtest_object **objs,
+        unsigned long nr)
+{
+    unsigned long i;
+
+    for (i = 0; i < nr; i++) {
+        rfs_remove_object(&objs[i]->robject);
+        rfs_object_put(&objs[i]->robject);
+        cond_resched();
+    }
+
+    /* the objects are freed by batched RCU callbacks */
+    rfs_object_free_flush();
+}
+
+struct rfsobjtest_reader {
+    struct rfsobjtest_object **objs;
+    unsigned long nr;
+    unsigned long idx;
+    u64 elapsed;
+    int rv;
+    struct completion done;
+};
+
+static int rfsobjtest_reader_fn(void *data)
+{
+    struct rfsobjtest_reader *reader = data;
+    struct rfsobjtest_object **objs = reader->objs;
+    struct rfs_object *robject;
+    unsigned long idx = reader->idx;
+    unsigned int i;
+    u64 start;
+
+    /* a stride coprime with 10^n scatters the lookups over the table */
+    start = ktime_to_ns(ktime_get());
+    for (i = 0; i < lookups; i++) {
+        idx = (idx + 7919) % reader->nr;
+        robject = rfs_get_object_by_system_object(&rfsobjtest_table,
+                &objs[idx]->system_object);
+        if (unlikely(robject != &objs[idx]->robject)) {
+            reader->rv = -EINVAL;
+            if (robject)
+                rfs_object_put(robject);
+            break;
+        }
+        rfs_object_put(robject);
+
+        if (!(i % 4096))
+            cond_resched();
+    }
+    reader->elapsed = ktime_to_ns(ktime_get()) - start;
+
+    complete(&reader->done);
+    return 0;
+}
+
+/*
+ * the readers start at different objects, the lookups of the same objects
+ * from all CPUs at once would measure the reference counter cache line
+ */
+static void rfsobjtest_read(struct kunit *test,
+        struct rfsobjtest_object **objs, unsigned long nr)
+{
+    struct rfsobjtest_reader *rdrs;
+    struct task_struct *task;
+    u64 elapsed = 0;
+    unsigned int started = 0;
+    unsigned int i;
+    int rv = 0;
+
+    rdrs = kcalloc(readers, sizeof(*rdrs), GFP_KERNEL);
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, rdrs);
+
+    for (i = 0; i < readers; i++) {
+        rdrs[i].objs = objs;
+        rdrs[i].nr = nr;
+        rdrs[i].idx = i * (nr / readers);
+        init_completion(&rdrs[i].done);
+
+        task = kthread_run(rfsobjtest_reader_fn, &rdrs[i], "rfsobjtest/%u",
+                i);
+        if (IS_ERR(task)) {
+            rv = PTR_ERR(task);
+            break;
+        }
+        started++;
+    }
+
+    for (i = 0; i < started; i++) {
+        wait_for_completion(&rdrs[i].done);
+        if (rdrs[i].rv)
+            rv = rdrs[i].rv;
+        elapsed += rdrs[i].elapsed;
+    }
+
+    kfree(rdrs);
+
+    KUNIT_EXPECT_EQ_MSG(test, rv, 0, "objects=%lu", nr);
+    if (rv)
+        return;
+
+    kunit_info(test, "%s objects=%lu readers=%u lookups=%u avg=%llu ns\n",
+#ifdef RFS_USE_HASHTABLE
+            "hashtable",
+#else
+            "radix_tree",
+#endif
+            nr, readers, lookups,
+            div_u64(elapsed, (lookups ? lookups : 1) * readers));
+}
+
+static void rfsobjtest_lookup(struct kunit *test)
+{
+    struct rfsobjtest_object **objs;
+    struct rfsobjtest_object *obj;
+    unsigned long inserted;
+    unsigned long max_nr = 1;
+    unsigned long nr, i;
+    unsigned int order;
+    int rv = 0;
+
+    KUNIT_ASSERT_TRUE_MSG(test, max_order >= 4 && max_order <= 7,
+            "max_order=%u", max_order);
+    KUNIT_ASSERT_TRUE_MSG(test, readers && readers <= 64,
+            "readers=%u", readers);
+
+    for (order = 0; order < max_order; order++)
+        max_nr *= 10;
+
+    objs = vmalloc(max_nr * sizeof(*objs));
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, objs);
+
+    for (nr = 10000; !rv && nr <= max_nr; nr *= 10) {
+        for (inserted = 0, i = 0; i < nr; i++) {
+            obj = kmem_cache_zalloc(rfsobjtest_cache, GFP_KERNEL);
+            if (!obj) {
+                rv = -ENOMEM;
+                break;
+            }
+
+            rfs_object_init(&obj->robject, &rfsobjtest_type,
+                    &obj->system_object);
+            objs[i] = obj;
+
+            rv = rfs_insert_object(&rfsobjtest_table, &obj->robject, false);
+            if (rv) {
+                rfs_object_put(&obj->robject);
+                break;
+            }
+
+            inserted++;
+            cond_resched();
+        }
+        KUNIT_EXPECT_EQ_MSG(test, rv, 0, "insert objects=%lu", nr);
+
+        if (!rv)
+            rfsobjtest_read(test, objs, nr);
+
+        rfsobjtest_remove(objs, inserted);
+    }
+
+    vfree(objs);
+}
+
+static void rfsobjtest_churn(struct kunit *test)
+{
+    struct rfs_object_stat sum;
+    struct rfsobjtest_object *obj;
+    struct rfs_object *robject;
+    unsigned long peak = 0;
+    unsigned long live;
+    unsigned int i;
+    u64 start, elapsed;
+    int rv = 0;
+
+    if (!churn)
+        kunit_skip(test, "churn=0");
+
+    start = ktime_to_ns(ktime_get());
+    for (i = 0; i < churn; i++) {
+        obj = kmem_cache_zalloc(rfsobjtest_cache, GFP_KERNEL);
+        if (!obj) {
+            rv = -ENOMEM;
+            break;
+        }
+
+        rfs_object_init(&obj->robject, &rfsobjtest_type,
+                &obj->system_object);
+
+        rv = rfs_insert_object(&rfsobjtest_table, &obj->robject, false);
+        if (rv) {
+            rfs_object_put(&obj->robject);
+            break;
+        }
+
+        robject = rfs_get_object_by_system_object(&rfsobjtest_table,
+                &obj->system_object);
+        KUNIT_EXPECT_PTR_EQ(test, robject, &obj->robject);
+        if (robject)
+            rfs_object_put(robject);
+
+        rfs_remove_object(&obj->robject);
+        rfs_object_put(&obj->robject);
+
+        /* summing the per cpu statistics is not cheap, sample them */
+        if (!(i % 64)) {
+            rfs_object_stat_sum(RFS_TYPE_UNKNOWN, &sum);
+            live = sum.allocs - sum.frees;
+            if (live > peak)
+                peak = live;
+        }
+
+        if (!(i % 1024))
+            cond_resched();
+    }
+    elapsed = ktime_to_ns(ktime_get()) - start;
+
+    rfs_object_free_flush();
+
+    KUNIT_EXPECT_EQ_MSG(test, rv, 0, "cycle=%u", i);
+    if (rv)
+        return;
+
+    kunit_info(test, "churn cycles=%u avg=%llu ns peak objects=%lu "
+            "peak slab=%lu KB\n",
+            churn, div_u64(elapsed, churn), peak,
+            peak * kmem_cache_size(rfsobjtest_cache) / 1024);
+}
+
+/*---------------------------------------------------------------------------*/
+
+/* the timing cases take seconds to minutes, kunit.py can filter them out */
+#ifdef KUNIT_CASE_SLOW
+#define RFSOBJTEST_CASE_SLOW(test_name) KUNIT_CASE_SLOW(test_name)
+#else
+#define RFSOBJTEST_CASE_SLOW(test_name) KUNIT_CASE(test_name)
+#endif
+
+static struct kunit_case rfsobjtest_cases[] = {
+    KUNIT_CASE(rfsobjtest_chain_ops),
+    KUNIT_CASE(rfsobjtest_duplicate),
+    RFSOBJTEST_CASE_SLOW(rfsobjtest_chain_bench),
+    RFSOBJTEST_CASE_SLOW(rfsobjtest_lookup),
+    RFSOBJTEST_CASE_SLOW(rfsobjtest_churn),
+    {}
+};
+
+static struct kunit_suite rfsobjtest_suite = {
+    .name = "rfsobjtest",
+    .init = rfsobjtest_init,
+    .exit = rfsobjtest_exit,
+    .test_cases = rfsobjtest_cases,
+};
+
+kunit_test_suite(rfsobjtest_suite);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("RedirFS object table and chain test");